@@ -37,7 +37,7 @@ int main(int argc, char *argv[]) {
     parser.add_option("-s", "mcmc_steps", "Number of MCMC steps", "1E7");
     parser.add_option("-S", "seed", "The seed for the Ising model and in the acceptance criteria, by default the time is used");
     parser.add_option("-W", "weight_scheme", "The Muninn weight scheme (multicanonical|invk)", "multicanonical");
-    parser.add_option("-E", "estimator", "The Muninn estimator (MLE)", "MLE");
+    parser.add_option("-E", "estimator", "The Muninn estimator (MLE|WHAM)", "MLE");
     parser.add_option("-w", "bin_width", "The Muninn bin width", "4.0");
     parser.add_option("-l", "statistics_log", "The Muninn statistics log file", "muninn.txt");
     parser.add_option("-L", "log_mode", "The mode for the logger (options are ALL or CURRENT)", "all");
@@ -24,6 +24,7 @@
 #ifndef MUNINN_BINNER_H_
 #define MUNINN_BINNER_H_
 
+#include <cstddef>
 #include <vector>
 #include <utility>
 
@@ -31,6 +32,7 @@
 #include "muninn/utils/TArray.h"
 #include "muninn/Estimate.h"
 #include "muninn/History.h"
+#include "muninn/InitialObservations.h"
 #include "muninn/utils/StatisticsLogger.h"
 
 namespace Muninn {
@@ -57,6 +59,23 @@ public:
     ///             The initial weight are assumed to be of the form \f$ w(E) = \exp(-\beta E) \f$.
     virtual void initialize(std::vector<double> &values, double beta=0.0) = 0;
 
+    /// Initialize the binner from a collection of initial observations,
+    /// which uses bounded memory. The default implementation requires that
+    /// all observations are buffered, and calls initialize() with the
+    /// buffered energies.
+    ///
+    /// \param observations The initial observations.
+    /// \param beta The beta values for the canonical weights used when collecting the initial samples.
+    ///             The initial weight are assumed to be of the form \f$ w(E) = \exp(-\beta E) \f$.
+    virtual void initialize(InitialObservations &observations, double beta=0.0) {
+        if (!observations.is_buffered()) {
+            throw MessageException("The binner can only be initialized from initial observations that are all buffered.");
+        }
+
+        std::vector<double> values(observations.get_buffer());
+        initialize(values, beta);
+    }
+
     /// Function for calculate the bin index for an energy value.
     ///
     /// \param value The energy value, which may or may not be outside the
@@ -68,6 +87,18 @@ public:
     ///         The is utilized in the function Binner::calc_bin_validated().
     virtual int calc_bin(double value) const = 0;
 
+    /// Function for calculating the bin indices for a block of energy values.
+    /// The default implementation calls calc_bin() for each value, but derived
+    /// classes may override the function to avoid a virtual call per value.
+    ///
+    /// \param values Pointer to the energy values.
+    /// \param bins Pointer to the output array for the bin indices (see calc_bin()).
+    /// \param n The number of values.
+    virtual void calc_bins(const double *values, int *bins, size_t n) const {
+        for (size_t i=0; i<n; ++i)
+            bins[i] = calc_bin(values[i]);
+    }
+
     // TODO: Replace the pair with a class in return value
     ///  Function for extending the binned region to include a new energy value.
     ///
@@ -93,6 +124,15 @@ public:
     ///         the total number of bins (Binner#nbins).
     virtual DArray get_binning_centered() const = 0;
 
+    /// Function that returns the center value of a single bin, with the same
+    /// value as the corresponding entry in get_binning_centered().
+    ///
+    /// \param bin The index of the bin.
+    /// \return The center value of the bin.
+    virtual double get_bin_center(unsigned int bin) const {
+        return get_binning_centered()(bin);
+    }
+
     /// Function that returns the width of the bins. If the edges of bin
     /// \f$ i \f$ are \f$ E_{i} \f$ and \f$ E_{i+1} \f$ then the bin width for
     /// bin \f$ i \f$ is \f$ E_{i+1}-E_{i} \f$.
@@ -28,6 +28,7 @@
 
 #include "muninn/common.h"
 #include "muninn/Binner.h"
+#include "muninn/utils/BinLookupIndex.h"
 
 namespace Muninn {
 
@@ -45,10 +46,12 @@ public:
     NonUniformBinner(const DArray &binning) :
         Binner(binning.get_asize()-1, false, true), binning(binning) {
         assert(binning.get_shape().size() == 1);
+        update_lookup_index();
     }
 
-    /// Function for calculate the bin index for an energy value. Note that
-    /// this call takes log(nbins) time.
+    /// Function for calculate the bin index for an energy value. The bin is
+    /// found using the lookup index (see BinLookupIndex), which takes
+    /// constant time for bins of comparable widths.
     ///
     /// \param value The energy value, which may or may not be outside the
     ///              binned region
@@ -59,8 +62,14 @@ public:
     ///         The is utilized in the function Binner::calc_bin_validated().
     virtual int calc_bin(double value) const {
         // The array is accessed directly, which is not very clean but very fast
-        const double* it = std::upper_bound(binning.get_array(), binning.get_array()+binning.get_asize(), value);
-        return static_cast<int>(it-binning.get_array()) - 1;
+        return lookup_index.lookup(binning.get_array(), value);
+    }
+
+    // Implementation of Binner interface (see base class for documentation).
+    virtual void calc_bins(const double *values, int *bins, size_t n) const {
+        const double *edges = binning.get_array();
+        for (size_t i=0; i<n; ++i)
+            bins[i] = lookup_index.lookup(edges, values[i]);
     }
 
     // Implementation of Binner interface (see base class for documentation).
@@ -68,6 +77,11 @@ public:
         assert(false);
     }
 
+    // Implementation of Binner interface (see base class for documentation).
+    virtual void initialize(InitialObservations &observations, double beta=0.0) {
+        assert(false);
+    }
+
     // Implementation of Binner interface (see base class for documentation).
     virtual std::pair<std::vector<unsigned int>, std::vector<unsigned int> > extend(double value, const Estimate &estimate, const History &history, const DArray &lnw) {
         assert(false);
@@ -88,6 +102,11 @@ public:
         return centered;
     }
 
+    // Implementation of Binner interface (see base class for documentation).
+    virtual double get_bin_center(unsigned int bin) const {
+        return binning(bin) + 0.5*(binning(bin+1)-binning(bin));
+    }
+
     // Implementation of Binner interface (see base class for documentation).
     virtual DArray get_bin_widths() const {
         DArray bin_widths(nbins);
@@ -100,11 +119,21 @@ public:
 protected:
     DArray binning; ///< The current edges of the binned region.
 
+    /// Rebuild the lookup index used by calc_bin(). This function must be
+    /// called by derived classes whenever the binning has been changed.
+    void update_lookup_index() {
+        lookup_index.build(binning);
+    }
+
     /// Default constructor that creates a uninitialized binner
     NonUniformBinner() :
         Binner(0, false, false), binning(0) {
         assert(binning.get_shape().size() == 1);
+        update_lookup_index();
     }
+
+private:
+    BinLookupIndex lookup_index; ///< Index for looking up the bin of an energy value in the binning.
 };
 
 } // namespace Muninn
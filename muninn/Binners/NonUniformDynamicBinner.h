@@ -33,7 +33,6 @@
 #include "muninn/Histories/MultiHistogramHistory.h"
 #include "muninn/Exceptions/MaximalNumberOfBinsExceed.h"
 
-#include "muninn/utils/polation/SupportBoundaries.h"
 #include "muninn/utils/polation/AverageSlope.h"
 #include "muninn/utils/BaseConverter.h"
 
@@ -100,34 +99,45 @@ public:
 
     // Implementation of Binner interface (see base class for documentation).
     virtual void initialize(std::vector<double> &initial_values, double beta=0.0) {
+        InitialObservations observations(initial_values.size());
+        for (std::vector<double>::const_iterator it=initial_values.begin(); it!=initial_values.end(); ++it)
+            observations.add(*it);
+
+        initialize(observations, beta);
+    }
+
+    // Implementation of Binner interface (see base class for documentation).
+    virtual void initialize(InitialObservations &observations, double beta=0.0) {
+        // Check that all the energies are finite
+        if (observations.has_nonfinite()) {
+            throw MessageException("An initial binning could not be estimate since a non finite energy has been added to Muninn.");
+        }
+
         // If the initial sampling was done a beta=0, we will use the beta one std away
         // from the mean, as the initial beta
         if (std::abs(beta)<1E-6) {
             // Find the quantiles corresponding to +/- a standard deviation
-            std::vector<double> fractiles = calculate_fractiles(initial_values, newvector(0.1586553, 0.8413447));
+            double lower, upper;
+            observations.get_fractiles(lower, upper);
 
             // Check that the quantiles differ
-            if (!(fractiles[1]-fractiles[0]>0)) {
+            if (!(upper-lower>0)) {
                 throw MessageException("An initial binning could not be estimate since the 16% and 84% fractiles for the sampled energies have the same value. This means that 68% of the sampled energies have the same value.");
             }
 
             // Find the standard deviation and the bin width
-            double sigma = 0.5*(fractiles[1]-fractiles[0]);
+            double sigma = 0.5*(upper-lower);
 
             // Set the beta calculate one std away
             beta = 1.0/sigma;
         }
-        else {
-            // Else just sort the values (this is done implicit by calculate_fractiles)
-            std::sort(initial_values.begin(), initial_values.end());
-        }
 
         // Calculate the initial bin width
         initial_bin_width = std::abs(resolution/beta);
 
         // Find the min and max values among the reported values
-        double min_value = initial_values[0] - initial_bin_width/2.0;
-        double max_value = initial_values[initial_values.size() - 1] + initial_bin_width/2.0;
+        double min_value = observations.get_min() - initial_bin_width/2.0;
+        double max_value = observations.get_max() + initial_bin_width/2.0;
 
         // Check that the minimal and maximal value are finite
         if (!std::isfinite(min_value) || !std::isfinite(max_value)) {
@@ -150,6 +160,8 @@ public:
             binning(i) = min_value + i*initial_bin_width;
         }
 
+        update_lookup_index();
+
         // Print info and update initialized state
         MessageLogger::get().info("Setting initial bin width to: "+to_string(initial_bin_width));
         initialized = true;
@@ -167,7 +179,7 @@ public:
 
         if (bin < 0) {
             // Find the average slope on the left bound of the weights
-            unsigned int bin_left = MLEutils::SupportBoundaries1D::find_left_bound(estimate.get_lnG_support());
+            unsigned int bin_left = estimate.get_lnG_support_index().get_left_bound();
             double slope = use_preset_slopes ? preset_slope_left_bound : MLEutils::AverageSlope1d<DArray>::get_slope(bin_left, lnw, estimate.get_lnG_support(), history.get_sum_N(), this->get_binning_centered(), sigma);
 
             // Calculate the new bin width
@@ -188,11 +200,13 @@ public:
 
             // Updated the number of bins and the binning array
             nbins += to_add;
-            binning = binning.extended(to_add, 0u);
+            binning.extend(to_add, 0u);
             for (unsigned int index=0; index<to_add; ++index) {
                 binning(index) = binning(to_add) - (to_add-index)*bin_width;
             }
 
+            update_lookup_index();
+
             // Updated the extension vector
             extension.first = newvector(to_add);
 
@@ -201,7 +215,7 @@ public:
         }
         else if (bin >= static_cast<int>(nbins) ) {
             // Find the average slope on the right bound of the weights
-            unsigned int bin_right = MLEutils::SupportBoundaries1D::find_right_bound(estimate.get_lnG_support());
+            unsigned int bin_right = estimate.get_lnG_support_index().get_right_bound();
             double slope = use_preset_slopes ? preset_slope_right_bound : MLEutils::AverageSlope1d<DArray>::get_slope(bin_right, lnw, estimate.get_lnG_support(), history.get_sum_N(), this->get_binning_centered(), sigma);
 
             // Calculate the new bin width
@@ -223,12 +237,14 @@ public:
 
             // Updated the number of bins and the binning array
             nbins += to_add;
-            binning = binning.extended(0u, to_add);
+            binning.extend(0u, to_add);
 
             for (unsigned int index=prev_nbins+1; index<=nbins; ++index) {
                 binning(index) = binning(prev_nbins) + (index-prev_nbins)*bin_width;
             }
 
+            update_lookup_index();
+
             // Updated the extension vector
             extension.second = newvector(to_add);
 
@@ -81,38 +81,60 @@ public:
     /// \param beta The beta values for the canonical weights used when collecting the initial samples.
     ///             The initial weight are assumed to be of the form \f$ w(E) = \exp(-\beta E) \f$.
     virtual void initialize(std::vector<double> &initial_values, double beta=0.0) {
+        InitialObservations observations(initial_values.size());
+        for (std::vector<double>::const_iterator it=initial_values.begin(); it!=initial_values.end(); ++it)
+            observations.add(*it);
+
+        initialize(observations, beta);
+    }
+
+    /// Initialize the binner from a collection of initial observations (see
+    /// the vector version of initialize()).
+    ///
+    /// \param observations The initial observations.
+    /// \param beta The beta values for the canonical weights used when collecting the initial samples.
+    ///             The initial weight are assumed to be of the form \f$ w(E) = \exp(-\beta E) \f$.
+    virtual void initialize(InitialObservations &observations, double beta=0.0) {
+        // Check that all the energies are finite
+        if (observations.has_nonfinite()) {
+            throw MessageException("An initial binning could not be estimate since a non finite energy has been added to Muninn.");
+        }
+
         // If the number of bins has not been set, calculate the number of bins from the initial value
         if (nbins==0) {
 
             // If the bin width has not been set, it must be estimated using the resolution
             if (bin_width == 0) {
                 // Find the quantiles corresponding to +/- a standard deviation
-                std::vector<double> quantiles = calculate_fractiles(initial_values, newvector(0.1586553, 0.8413447));
-                assert(quantiles[1]-quantiles[0]>0); // TODO: Raise an exception instead of an assert
+                double lower, upper;
+                observations.get_fractiles(lower, upper);
+                assert(upper-lower>0); // TODO: Raise an exception instead of an assert
 
                 // Find the standard deviation and the bin width
-                double sigma = 0.5*(quantiles[1]-quantiles[0]);
+                double sigma = 0.5*(upper-lower);
                 bin_width = sigma/static_cast<double>(std_bins);
             }
-            // Else, we just need to sort the values (this is done implicit by calculate_fractiles)
-            else {
-                std::sort(initial_values.begin(), initial_values.end());
-            }
 
             // Find the number of bins
-            min_value = initial_values.front() - bin_width/2.0;
-            max_value = initial_values.back() + bin_width/2.0;
+            min_value = observations.get_min() - bin_width/2.0;
+            max_value = observations.get_max() + bin_width/2.0;
 
             nbins = static_cast<unsigned int>((max_value - min_value) / bin_width + 1);
         }
         // If everything has been set up, we just need to make sure
         // that the binning covers the initial samples
-        else {
+        else if (observations.is_buffered()) {
             // Simply call extend on each observation to ensure that it is included in the binning.
-            for(std::vector<double>::iterator it = initial_values.begin(); it < initial_values.end(); it++) {
+            const std::vector<double> &initial_values = observations.get_buffer();
+            for(std::vector<double>::const_iterator it = initial_values.begin(); it < initial_values.end(); it++) {
                 extend(*it);
             }
         }
+        // If only a summary of the observations is available, extending by the extreme values suffice
+        else {
+            extend(observations.get_min());
+            extend(observations.get_max());
+        }
 
         // Print info and update initialized state
         MessageLogger::get().info("Setting bin width to: "+to_string(bin_width));
@@ -130,7 +152,13 @@ public:
     ///         depending on which side of the binned region the values falls.
     ///         The is utilized in the function Binner::calc_bin_validated().
     virtual int calc_bin(double value) const {
-        return int( (value-min_value)/bin_width );
+        return floor_to_int( (value-min_value)/bin_width );
+    }
+
+    // Implementation of Binner interface (see base class for documentation).
+    virtual void calc_bins(const double *values, int *bins, size_t n) const {
+        for (size_t i=0; i<n; ++i)
+            bins[i] = floor_to_int( (values[i]-min_value)/bin_width );
     }
 
     // Implementation of Binner interface (see base class for documentation).
@@ -156,6 +184,11 @@ public:
         return bins;
     }
 
+    // Implementation of Binner interface (see base class for documentation).
+    virtual double get_bin_center(unsigned int bin) const {
+        return min_value + bin*bin_width + 0.5*bin_width;
+    }
+
     // Implementation of Binner interface (see base class for documentation).
     virtual DArray get_bin_widths() const {
         DArray bin_widths(nbins);
@@ -164,6 +197,17 @@ public:
     }
 
 private:
+    /// Round a value down to an integer. Conversion to int rounds towards
+    /// zero, which would put values less than one bin below the binned
+    /// region into the first bin.
+    ///
+    /// \param x The value to round.
+    /// \return The largest integer not greater than x.
+    static inline int floor_to_int(double x) {
+        int i = int(x);
+        return (x < i) ? i-1 : i;
+    }
+
     unsigned int std_bins;     ///< The number of bins used to describe +/- one standard deviation (only set if the corresponding constructure is used).
     unsigned int extend_nbins; ///< The number of bins used as additional padding when extending the binned region.
 
@@ -23,10 +23,22 @@
 
 #include "muninn/CGE.h"
 #include <algorithm>
+#include <limits>
 
 namespace Muninn {
 
+const std::string CGE::OutOfRangePolicyNames[] = {"reject", "clamp"};
+const size_t CGE::LNWEIGHTS_BLOCK_SIZE;
+
 void CGE::estimate_new_weights(){
+    if (get_estimation_state() != ESTIMATION_IDLE) {
+        throw MessageException("New weights cannot be estimated while a background estimation is in progress.");
+    }
+
+    // Include the observations of the walkers in the multi-walker mode
+    if (!walker_shards.empty())
+        merge_walkers();
+
     if (initial_collection) {
         // Initialize the binner with the collected observations
         if (!binner->is_initialized()) {
@@ -45,13 +57,34 @@ void CGE::estimate_new_weights(){
 
         delete ge.current;
         ge.current = ge.estimator->new_histogram(lnw);
+        ge.update_countdown = 0;
+
+        // Count the buffered observations
+        CArray counts(nbins);
+        const std::vector<double> &buffer = initial_observations.get_buffer();
+        int last_bin = static_cast<int>(nbins)-1;
+
+        if (!buffer.empty()) {
+            bin_buffer.resize(buffer.size());
+            binner->calc_bins(&buffer[0], &bin_buffer[0], buffer.size());
+
+            for (std::vector<int>::const_iterator it=bin_buffer.begin(); it!=bin_buffer.end(); ++it)
+                counts(std::min(std::max(*it, 0), last_bin))++;
+        }
 
-        // Add the observations to the histogram
-        for(std::vector<double>::iterator it = initial_observations.begin(); it < initial_observations.end(); it++) {
-            unsigned int bin = binner->calc_bin(*it);
-            ge.add_observation(bin);
+        // Count the observations in the grid used when the buffer was full
+        for (size_t i=0; i<initial_observations.get_grid_size(); ++i) {
+            Count count = initial_observations.get_grid_count(i);
+            if (count>0) {
+                int bin = binner->calc_bin(initial_observations.get_grid_energy(i));
+                counts(std::min(std::max(bin, 0), last_bin)) += count;
+            }
         }
 
+        // Add the observations to the histogram and release the memory used for collecting them
+        ge.add_counts(counts);
+        initial_observations.clear();
+
         // And update the entropy estimate
         ge.estimate_new_weights(binner);
 
@@ -61,6 +94,321 @@ void CGE::estimate_new_weights(){
     else {
         ge.estimate_new_weights(binner);
     }
+
+    report_out_of_range();
+
+    weights_changed();
+
+    // Resize the shards to the (possibly) new binning and weights
+    reset_walker_shards();
+}
+
+void CGE::begin_estimate_new_weights() {
+    if (get_estimation_state() != ESTIMATION_IDLE) {
+        throw MessageException("A background estimation of new weights is already in progress.");
+    }
+
+    // The first estimation sets up the binning, and is done synchronously
+    if (initial_collection) {
+        estimate_new_weights();
+        set_estimation_state(ESTIMATION_DONE);
+        return;
+    }
+
+    // The weights outside the binned area must be available without
+    // accessing the estimate and the history used by compute_new_weights()
+    if (!extrapolation_linear) {
+        throw MessageException("Estimating new weights in the background requires a weight scheme that extrapolates the weights linearly (see ExtrapolatedWeightScheme::get_linear_extrapolation()).");
+    }
+
+    if (!walker_shards.empty())
+        merge_walkers();
+
+    ge.begin_estimate_new_weights();
+    set_estimation_state(ESTIMATION_STARTED);
+}
+
+void CGE::compute_new_weights() {
+    if (get_estimation_state() == ESTIMATION_STARTED) {
+        ge.compute_new_estimate(binner);
+        set_estimation_state(ESTIMATION_COMPUTED);
+    }
+}
+
+void CGE::finish_estimate_new_weights() {
+    if (get_estimation_state() == ESTIMATION_IDLE)
+        return;
+
+    if (get_estimation_state() == ESTIMATION_STARTED) {
+        throw MessageException("The background estimation must be computed before it can be finished.");
+    }
+
+    // Merge the walkers while the binning is unchanged
+    if (!walker_shards.empty())
+        merge_walkers();
+
+    if (get_estimation_state() == ESTIMATION_COMPUTED)
+        ge.finish_estimate_new_weights(binner);
+
+    set_estimation_state(ESTIMATION_IDLE);
+
+    report_out_of_range();
+
+    // Add the deferred observations, which may extend the binning
+    if (!deferred_observations.empty()) {
+        std::vector<double> observations;
+        observations.swap(deferred_observations);
+        add_observations(&observations[0], observations.size());
+    }
+
+    weights_changed();
+
+    reset_walker_shards();
+}
+
+void CGE::report_out_of_range() {
+    Count total = out_of_range_counters.underflow + out_of_range_counters.overflow;
+
+    if (total > out_of_range_counters.reported) {
+        MessageLogger::get().warning(to_string(total-out_of_range_counters.reported) + " observations outside the binned region were handled by the " +
+                                     OutOfRangePolicyNames[out_of_range_policy] + " policy, since the binning could not be extended.");
+        out_of_range_counters.reported = total;
+    }
+
+    // The new weights may allow the binning to be extended further
+    extension_blocked_lower = false;
+    extension_blocked_upper = false;
+}
+
+void CGE::enable_weight_snapshots() {
+    weight_snapshots_enabled = true;
+    weight_snapshots.publish(new WeightSnapshot(get_weight_table()));
+}
+
+void CGE::update_weight_table() {
+    // Use Boltzmann weights for the initial collection
+    if (initial_collection) {
+        weight_table = WeightTable(initial_beta, weight_table.get_version()+1);
+    }
+    else {
+        weight_table = WeightTable(binner->get_binning(), ge.get_current_histogram().get_lnw(),
+                                   extrapolation_linear, extrapolation_lower, extrapolation_upper, weight_table.get_version()+1);
+    }
+
+    weight_table_stale = false;
+}
+
+void CGE::update_extrapolation() {
+    extrapolation_linear = !initial_collection && extrapolated_weightscheme &&
+                           extrapolated_weightscheme->get_linear_extrapolation(ge.get_current_histogram().get_lnw(), extrapolation_lower, extrapolation_upper);
+}
+
+void CGE::weights_changed() {
+    update_extrapolation();
+    weight_table_stale = true;
+
+    if (weight_snapshots_enabled)
+        weight_snapshots.publish(new WeightSnapshot(get_weight_table()));
+}
+
+void CGE::set_number_of_walkers(unsigned int nwalkers) {
+    if (nwalkers>0 && !extrapolated_weightscheme) {
+        throw MessageException("The multi-walker mode of CGE requires a weight scheme that implements the ExtrapolatedWeightScheme interface.");
+    }
+
+    if (!walker_shards.empty())
+        merge_walkers();
+
+    // The walkers get their weights from the weight snapshots
+    if (nwalkers>0 && !weight_snapshots_enabled)
+        enable_weight_snapshots();
+
+    for (std::vector<WalkerShard>::iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it)
+        WeightSnapshotPublisher::release(it->snapshot);
+
+    walker_shards.assign(nwalkers, WalkerShard());
+    reset_walker_shards();
+}
+
+bool CGE::merge_walkers() {
+    // Collect the energies that could not be binned by the walkers
+    std::vector<double> energies;
+    for (std::vector<WalkerShard>::iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it)
+        energies.insert(energies.end(), it->energies.begin(), it->energies.end());
+
+    // Merge the observations collected by the walkers during the initial collection
+    if (initial_collection) {
+        for (std::vector<WalkerShard>::const_iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it)
+            initial_observations.merge(it->initial_observations);
+    }
+
+    // Add the counts of the walkers to the current histogram
+    bool new_weights_required = new_weights();
+
+    if (!initial_collection && !walker_shards.empty()) {
+        // The binning may have been extended since the shards were reset, so
+        // the counts of each shard are moved by the number of bins added below
+        CArray sum_N(binner->get_nbins());
+        for (std::vector<WalkerShard>::iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it) {
+            unsigned int offset = nbins_added_under - it->nbins_added_under;
+            const Count *N = it->N.get_array();
+            for (unsigned int bin=0; bin<it->N.get_asize(); ++bin)
+                sum_N(offset+bin) += N[bin];
+        }
+
+        new_weights_required = ge.add_counts(sum_N);
+    }
+
+    // Add the remaining energies, which may extend the binning
+    reset_walker_shards();
+
+    if (!energies.empty()) {
+        new_weights_required = add_observations(&energies[0], energies.size());
+        reset_walker_shards();
+    }
+
+    return new_weights_required && get_estimation_state() == ESTIMATION_IDLE;
+}
+
+void CGE::reset_walker_shards() {
+    unsigned int nbins = initial_collection ? 0 : binner->get_nbins();
+
+    for (std::vector<WalkerShard>::iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it) {
+        if (it->N.get_asize()==nbins)
+            it->N = 0;
+        else
+            it->N = CArray(nbins);
+
+        it->nbins_added_under = nbins_added_under;
+        it->energies.clear();
+        it->initial_observations.clear();
+
+        // Give the walker the latest weights
+        if (it->snapshot==NULL || it->snapshot->get_version() != weight_snapshots.get_version()) {
+            WeightSnapshotPublisher::release(it->snapshot);
+            it->snapshot = weight_snapshots.acquire();
+        }
+    }
+}
+
+bool CGE::add_observations(const double *energies, size_t n) {
+    if (initial_collection) {
+        for (size_t i=0; i<n; ++i)
+            initial_observations.add(energies[i]);
+        return initial_new_weights();
+    }
+
+    if (n==0)
+        return ge.new_weights();
+
+    calc_bins_with_extention(energies, n);
+
+    // Only add the observations that fall within the binned region
+    int nbins = static_cast<int>(binner->get_nbins());
+    valid_bin_buffer.resize(n);
+    size_t nvalid = 0;
+
+    for (size_t i=0; i<n; ++i) {
+        if (0<=bin_buffer[i] && bin_buffer[i]<nbins) {
+            valid_bin_buffer[nvalid++] = static_cast<unsigned int>(bin_buffer[i]);
+        }
+        else if (get_estimation_state() != ESTIMATION_IDLE) {
+            deferred_observations.push_back(energies[i]);
+        }
+        else {
+            // Handle the observation by the out-of-range policy
+            int edge_bin = count_out_of_range(bin_buffer[i]);
+            if (edge_bin >= 0)
+                valid_bin_buffer[nvalid++] = static_cast<unsigned int>(edge_bin);
+        }
+    }
+
+    return ge.add_observations(&valid_bin_buffer[0], nvalid) && get_estimation_state() == ESTIMATION_IDLE;
+}
+
+void CGE::get_lnweights(const double *energies, double *lnw, size_t n) {
+    // Use Boltzmann weights for the initial collection
+    if (initial_collection) {
+        for (size_t i=0; i<n; ++i)
+            lnw[i] = -initial_beta * energies[i];
+        return;
+    }
+
+    if (n==0)
+        return;
+
+    // If the weightscheme is extrapolated, the weight outside the binning can
+    // be calculated without extension. The bins are then calculated in blocks
+    // using a local buffer instead of the shared bin_buffer, such that walkers
+    // can call the function concurrently.
+    if (extrapolated_weightscheme) {
+        const DArray &current_lnw = ge.get_current_histogram().get_lnw();
+        int nbins = static_cast<int>(binner->get_nbins());
+        int bins[LNWEIGHTS_BLOCK_SIZE];
+
+        for (size_t start=0; start<n; start+=LNWEIGHTS_BLOCK_SIZE) {
+            size_t size = std::min(n-start, LNWEIGHTS_BLOCK_SIZE);
+            binner->calc_bins(energies+start, bins, size);
+
+            for (size_t i=0; i<size; ++i) {
+                if (0<=bins[i] && bins[i]<nbins)
+                    lnw[start+i] = current_lnw(bins[i]);
+                else
+                    lnw[start+i] = get_extrapolated_lnweights(energies[start+i], bins[i]);
+            }
+        }
+    }
+    else {
+        calc_bins_with_extention(energies, n);
+
+        const DArray &current_lnw = ge.get_current_histogram().get_lnw();
+        int nbins = static_cast<int>(binner->get_nbins());
+
+        for (size_t i=0; i<n; ++i) {
+            if (0<=bin_buffer[i] && bin_buffer[i]<nbins)
+                lnw[i] = current_lnw(bin_buffer[i]);
+            else
+                lnw[i] = get_out_of_range_lnweights(bin_buffer[i]);
+        }
+    }
+}
+
+void CGE::calc_bins_with_extention(const double *energies, size_t n) {
+    bin_buffer.resize(n);
+    binner->calc_bins(energies, &bin_buffer[0], n);
+
+    // Find the lowest and highest energies outside the binned region
+    int nbins = static_cast<int>(binner->get_nbins());
+    size_t lowest = n;
+    size_t highest = n;
+
+    for (size_t i=0; i<n; ++i) {
+        if (bin_buffer[i] < 0) {
+            if (lowest==n || energies[i] < energies[lowest])
+                lowest = i;
+        }
+        else if (bin_buffer[i] >= nbins) {
+            if (highest==n || energies[i] > energies[highest])
+                highest = i;
+        }
+    }
+
+    // The binning cannot be extended while new weights are estimated
+    if ((lowest==n && highest==n) || get_estimation_state() != ESTIMATION_IDLE)
+        return;
+
+    // Extend the binning on each side, and recalculate the bins
+    size_t extremes[2] = {lowest, highest};
+
+    for (unsigned int j=0; j<2; ++j) {
+        if (extremes[j]==n)
+            continue;
+
+        int bin = bin_buffer[extremes[j]];
+        extend_binning(energies[extremes[j]], bin);
+    }
+
+    binner->calc_bins(energies, &bin_buffer[0], n);
 }
 
 } // namespace Muninn
@@ -26,6 +26,8 @@
 
 #include <cassert>
 #include <deque>
+#include <limits>
+#include <string>
 #include <vector>
 
 #include "muninn/utils/TArray.h"
@@ -35,7 +37,11 @@
 #include "muninn/WeightScheme.h"
 #include "muninn/ExtrapolatedWeightScheme.h"
 #include "muninn/Binner.h"
+#include "muninn/WeightTable.h"
+#include "muninn/WeightSnapshot.h"
+#include "muninn/utils/Loggable.h"
 #include "muninn/utils/StatisticsLogger.h"
+#include "muninn/utils/threads.h"
 #include "muninn/Exceptions/MaximalNumberOfBinsExceed.h"
 
 namespace Muninn {
@@ -48,6 +54,18 @@ namespace Muninn {
 class CGE {
 public:
 
+    /// The policies for observations outside the binned region, which cannot
+    /// be included by extending the binning, because the maximal number of
+    /// bins has been reached. In all cases the observations are counted in an
+    /// underflow or an overflow counter, which is written to the statistics
+    /// log.
+    enum OutOfRangePolicy {OUT_OF_RANGE_REJECT=0,   ///< The observations are not added to the histogram, and the log weight is minus infinity, so a move to the energy is never accepted.
+                           OUT_OF_RANGE_CLAMP,      ///< The observations are added to the bin at the edge of the binned region, whose weight is used.
+                           OUT_OF_RANGE_SIZE};      ///< The number of policies.
+
+    /// String representation of the out-of-range policies (OutOfRangePolicy).
+    static const std::string OutOfRangePolicyNames[];
+
     /// Constructor based on pointers to the Estimator, UpdateScheme,
     /// WeighScheme and Binner objects. The class can take ownership of these
     /// objects and delete them upon destruction of the CGE object.
@@ -76,7 +94,16 @@ public:
             has_ownership(receives_ownership),
             initial_max(updatescheme->get_initial_max()),
             initial_collection(true),
-            initial_beta(initial_beta) {
+            initial_beta(initial_beta),
+            estimation_state(ESTIMATION_IDLE),
+            extrapolation_linear(false),
+            weight_table(initial_beta),
+            weight_table_stale(false),
+            weight_snapshots_enabled(false),
+            out_of_range_policy(OUT_OF_RANGE_REJECT),
+            extension_blocked_lower(false),
+            extension_blocked_upper(false),
+            nbins_added_under(0) {
         add_loggables(statisticslogger);
     }
 
@@ -115,13 +142,22 @@ public:
             has_ownership(receives_ownership),
             initial_max(updatescheme->get_initial_max()),
             initial_collection(false),
-            initial_beta(0.0) {
+            initial_beta(0.0),
+            estimation_state(ESTIMATION_IDLE),
+            extrapolation_linear(false),
+            weight_table_stale(true),
+            weight_snapshots_enabled(false),
+            out_of_range_policy(OUT_OF_RANGE_REJECT),
+            extension_blocked_lower(false),
+            extension_blocked_upper(false),
+            nbins_added_under(0) {
 
         // Check the shape of the binner
     	if(!(history->get_shape().size()==1 && history->get_shape()[0]==binner->get_nbins())) {
     		throw MessageException("The shape of the history given to the GE constructor must match the number of bins represented in the binner.");
     	}
 
+    	update_extrapolation();
     	add_loggables(statisticslogger);
     }
 
@@ -147,7 +183,16 @@ public:
             has_ownership(false),
             initial_max(updatescheme.get_initial_max()),
             initial_collection(true),
-            initial_beta(initial_beta) {
+            initial_beta(initial_beta),
+            estimation_state(ESTIMATION_IDLE),
+            extrapolation_linear(false),
+            weight_table(initial_beta),
+            weight_table_stale(false),
+            weight_snapshots_enabled(false),
+            out_of_range_policy(OUT_OF_RANGE_REJECT),
+            extension_blocked_lower(false),
+            extension_blocked_upper(false),
+            nbins_added_under(0) {
         add_loggables(statisticslogger);
     }
 
@@ -157,6 +202,9 @@ public:
     /// for deleting the Binner object, the remaining object are deleted by
     /// the GE class.
     virtual ~CGE() {
+        for (std::vector<WalkerShard>::iterator it=walker_shards.begin(); it!=walker_shards.end(); ++it)
+            WeightSnapshotPublisher::release(it->snapshot);
+
         if (has_ownership) {
             delete binner;
         }
@@ -168,19 +216,26 @@ public:
     /// \return Returns true if new weights should be estimated.
     inline bool add_observation(double energy) {
         if (initial_collection) {
-            initial_observations.push_back(energy);
+            initial_observations.add(energy);
             return initial_new_weights();
         }
         else {
-            unsigned int bin;
-            try {
-                bin = calc_bin_with_extention(energy);
-            }
-            catch (MaximalNumberOfBinsExceed& exception) {
-                MessageLogger::get().warning(exception.what());
-                return ge.new_weights();
+            std::pair<int, bool> bin = binner->calc_bin_validated(energy);
+
+            if (!bin.second) {
+                // The binning cannot be extended while new weights are estimated
+                if (get_estimation_state() != ESTIMATION_IDLE) {
+                    deferred_observations.push_back(energy);
+                    return false;
+                }
+
+                // Handle the observation by the out-of-range policy, if the binning cannot be extended
+                if (!extend_binning(energy, bin.first)) {
+                    int edge_bin = count_out_of_range(bin.first);
+                    return (edge_bin >= 0) ? ge.add_observation(edge_bin) : ge.new_weights();
+                }
             }
-            return ge.add_observation(bin);
+            return ge.add_observation(bin.first) && get_estimation_state() == ESTIMATION_IDLE;
         }
     }
 
@@ -202,7 +257,7 @@ public:
 
                 // If we are outside the range, return the extrapolated weight
                 if (!bin.second) {
-                    return extrapolated_weightscheme->get_extrapolated_weight(energy, ge.get_current_histogram().get_lnw(), ge.get_estimate(), ge.get_history(), *binner);
+                    return get_extrapolated_lnweights(energy, bin.first);
                 }
                 // If we are inside the range, return the weight
                 else {
@@ -211,25 +266,183 @@ public:
             }
             // With a normal weightscheme, the binning has the be extended in order to get a weight
             else {
-                unsigned int bin;
-                try {
-                    bin = calc_bin_with_extention(energy);
-                }
-                catch (MaximalNumberOfBinsExceed& exception) {
-                    MessageLogger::get().warning(exception.what());
-                    return std::numeric_limits<double>::infinity();
+                std::pair<int, bool> bin = binner->calc_bin_validated(energy);
+
+                if (!bin.second && !extend_binning(energy, bin.first)) {
+                    return get_out_of_range_lnweights(bin.first);
                 }
-                return ge.get_lnweights(bin);
+                return ge.get_lnweights(bin.first);
             }
         }
     }
 
+    /// Add a block of energy observations. The energies are binned in one
+    /// pass, and if some energies fall outside the binned region, the binning
+    /// is extended once to include the lowest and once to include the
+    /// highest of these. The update scheme is only consulted at the end of
+    /// the block, so all observations in the block are added to the current
+    /// histogram, even if new weights are required before the last one.
+    ///
+    /// \param energies Pointer to the energies to be added.
+    /// \param n The number of energies.
+    /// \return Returns true if new weights should be estimated.
+    bool add_observations(const double *energies, size_t n);
+
+    /// Get the log weighs for a block of energies. The energies are binned
+    /// in one pass, and the binning is extended as in add_observations() if
+    /// required. With an extrapolated weight scheme the binning is never
+    /// extended and no shared buffers are used. Walkers in the multi-walker
+    /// mode should use get_walker_lnweights() instead.
+    ///
+    /// \param energies Pointer to the energies to get weighs for.
+    /// \param lnw Pointer to the output array for the log weights.
+    /// \param n The number of energies.
+    void get_lnweights(const double *energies, double *lnw, size_t n);
+
+    /// Set the number of walkers for the multi-walker mode. In this mode each
+    /// walker (typically one per thread) records its observations in a
+    /// private shard using add_walker_observation(), and the shards are
+    /// merged into the current histogram by merge_walkers(). The walkers get
+    /// their weights with get_walker_lnweights(). Each shard holds a
+    /// reference to a published weight snapshot (see
+    /// enable_weight_snapshots(), which this mode enables), and the walkers
+    /// only read their shard and its snapshot. Their weights and binning are
+    /// therefore not affected if the binning is extended or new weights are
+    /// swapped in, before the walkers are given the new weights when the
+    /// shards are merged. The mode requires an extrapolated weight scheme,
+    /// such that the weights of the walkers are defined outside the binned
+    /// area. Note that add_observations() uses shared buffers and must not be
+    /// called concurrently.
+    ///
+    /// Any observations in the current shards are merged before the number
+    /// of walkers is changed. Setting the number of walkers to zero disables
+    /// the multi-walker mode.
+    ///
+    /// \param nwalkers The number of walkers.
+    void set_number_of_walkers(unsigned int nwalkers);
+
+    /// Get the number of walkers in the multi-walker mode.
+    ///
+    /// \return The number of walkers (zero if the mode is disabled).
+    inline unsigned int get_number_of_walkers() const {
+        return walker_shards.size();
+    }
+
+    /// Add an observation of an energy to the shard of a walker. Different
+    /// walkers can call this function concurrently, but calls must not
+    /// overlap with merge_walkers() or estimate_new_weights(), which merge
+    /// the shards.
+    ///
+    /// The energies are binned with the binning of the shard's snapshot.
+    /// Energies outside the binned region are stored in the shard and are
+    /// first binned (and the binning extended) when the shards are merged.
+    /// During the initial collection, each shard collects its energies in its
+    /// own InitialObservations, which bounds the memory used by the shards.
+    ///
+    /// \param energy The energy to be added.
+    /// \param walker The index of the walker.
+    inline void add_walker_observation(double energy, unsigned int walker) {
+        assert(walker < walker_shards.size());
+        WalkerShard &shard = walker_shards[walker];
+
+        if (initial_collection) {
+            shard.initial_observations.add(energy);
+            return;
+        }
+
+        int bin = shard.snapshot->get_weight_table().calc_bin(energy);
+
+        if (0<=bin && bin<static_cast<int>(shard.N.get_asize()))
+            shard.N(bin)++;
+        else
+            shard.energies.push_back(energy);
+    }
+
+    /// Get the log weight for an energy for a walker in the multi-walker
+    /// mode. The weight is taken from the snapshot of the walker's shard,
+    /// which is replaced by the latest weights when the shards are merged.
+    /// Different walkers can call this function concurrently, also while
+    /// other threads add observations or estimate new weights.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \param walker The index of the walker.
+    /// \return The log weight for the energy.
+    inline double get_walker_lnweights(double energy, unsigned int walker) const {
+        assert(walker < walker_shards.size());
+        return walker_shards[walker].snapshot->get_lnweights(energy);
+    }
+
+    /// Get the log weights for a block of energies for a walker in the
+    /// multi-walker mode (see get_walker_lnweights()).
+    ///
+    /// \param energies Pointer to the energies to get weighs for.
+    /// \param lnw Pointer to the output array for the log weights.
+    /// \param n The number of energies.
+    /// \param walker The index of the walker.
+    inline void get_walker_lnweights(const double *energies, double *lnw, size_t n, unsigned int walker) const {
+        assert(walker < walker_shards.size());
+        const WeightTable &table = walker_shards[walker].snapshot->get_weight_table();
+        for (size_t i=0; i<n; ++i)
+            lnw[i] = table.get_lnweights(energies[i]);
+    }
+
+    /// Merge the shards of all walkers into the current histogram. This
+    /// function must be called by a single thread, when no walker is adding
+    /// observations (e.g. after a barrier). If new weights should be
+    /// estimated, estimate_new_weights() should then be called before the
+    /// walkers continue.
+    ///
+    /// \return Returns true if new weights should be estimated.
+    bool merge_walkers();
+
+    /// Get a flat table of the current weights. The table is rebuilt lazily
+    /// by the first call after the weights or the binning have changed, so
+    /// the table is not maintained if it is not used. The table gives the
+    /// same weights as get_lnweights(), except that the binning is never
+    /// extended; outside the binned area the weights are extrapolated if the
+    /// weight scheme extrapolates linearly, and are otherwise minus infinity,
+    /// so moves out of the binned area are rejected.
+    ///
+    /// Since the table may be rebuilt, the function must not be called
+    /// concurrently; concurrent readers should use weight snapshots (see
+    /// enable_weight_snapshots()).
+    ///
+    /// \return The weight table.
+    inline const WeightTable& get_weight_table() {
+        if (weight_table_stale)
+            update_weight_table();
+        return weight_table;
+    }
+
+    /// Enable publishing of weight snapshots. When enabled, an immutable
+    /// snapshot of the weights is published each time the weights change,
+    /// and any number of threads can get weights concurrently by reading the
+    /// snapshots with a WeightSnapshotReader each, e.g.
+    /// \code
+    /// Muninn::WeightSnapshotReader reader(cge.get_weight_snapshots());
+    /// double lnw = reader.get_lnweights(energy);
+    /// \endcode
+    /// Outside the binned area the snapshot extrapolates the weights if the
+    /// weight scheme extrapolates linearly, and otherwise returns a log
+    /// weight of minus infinity, since the binning cannot be extended by a
+    /// reader.
+    void enable_weight_snapshots();
+
+    /// Get the publisher of the weight snapshots (see enable_weight_snapshots()).
+    ///
+    /// \return The publisher of the weight snapshots.
+    inline const WeightSnapshotPublisher& get_weight_snapshots() const {
+        return weight_snapshots;
+    }
+
     /// Function for determining if it time to estimate new weights. Note that
     /// the method returns a cached values, and accordingly it is cheap to call.
     ///
     /// \return Returns true if new weights should be estimated.
     inline bool new_weights() {
-        if (initial_collection)
+        if (get_estimation_state() != ESTIMATION_IDLE)
+            return false;
+        else if (initial_collection)
             return initial_new_weights();
         else
             return ge.new_weights();
@@ -239,6 +452,55 @@ public:
     /// when the function new_weights returns true.
     void estimate_new_weights();
 
+    /// Start estimating new weights in the background. The current histogram
+    /// is put into the history and sampling continues with the old weights
+    /// into a new histogram, while the new estimate is calculated by
+    /// compute_new_weights(), which may run on another thread (e.g. in an
+    /// OpenMP section). When new_weights_computed() returns true, the sampling
+    /// thread should call finish_estimate_new_weights() to swap in the new
+    /// weights. For example
+    /// \code
+    /// if (cge.new_weights()) cge.begin_estimate_new_weights();
+    /// #pragma omp parallel sections num_threads(2)
+    /// {
+    ///     #pragma omp section
+    ///     cge.compute_new_weights();
+    ///     #pragma omp section
+    ///     while (!cge.new_weights_computed()) { /* sample */ }
+    /// }
+    /// cge.finish_estimate_new_weights();
+    /// \endcode
+    ///
+    /// While the estimation is in progress, new_weights() returns false and
+    /// observations outside the binned region are deferred until
+    /// finish_estimate_new_weights(), since the binning cannot be extended.
+    /// Until then the history belongs to compute_new_weights(), so the update
+    /// scheme is not consulted, and the weights outside the binned area are
+    /// taken from the linear extrapolation of the weight scheme, which the
+    /// mode therefore requires. The first estimation, which sets up the
+    /// binning, is always done synchronously by this call.
+    void begin_estimate_new_weights();
+
+    /// Calculate the new estimate for an estimation started by
+    /// begin_estimate_new_weights(). The function can be called concurrently
+    /// with the functions for getting weights and adding observations.
+    void compute_new_weights();
+
+    /// Check whether the estimate started by begin_estimate_new_weights()
+    /// has been computed. Note that the function can be called concurrently
+    /// with compute_new_weights().
+    ///
+    /// \return Returns true if finish_estimate_new_weights() can be called.
+    inline bool new_weights_computed() const {
+        EstimationState state = get_estimation_state();
+        return state == ESTIMATION_COMPUTED || state == ESTIMATION_DONE;
+    }
+
+    /// Swap in the new weights from the estimation started by
+    /// begin_estimate_new_weights(), and add the deferred observations. This
+    /// function must be called after compute_new_weights() has returned.
+    void finish_estimate_new_weights();
+
     /// Force the current statistics to be logged with the logger.
     inline void force_statistics_log() {
         ge.force_statistics_log();
@@ -268,7 +530,39 @@ public:
     /// \return The discrete GE objected used by the CGE object.
     inline const GE & get_ge() const {return ge;}
 
-private:
+    /// Set the policy for observations outside the binned region, which
+    /// cannot be included by extending the binning (see OutOfRangePolicy).
+    ///
+    /// \param policy The new policy.
+    inline void set_out_of_range_policy(OutOfRangePolicy policy) {
+        out_of_range_policy = policy;
+    }
+
+    /// Get the policy for observations outside the binned region (see
+    /// OutOfRangePolicy).
+    ///
+    /// \return The current policy.
+    inline OutOfRangePolicy get_out_of_range_policy() const {
+        return out_of_range_policy;
+    }
+
+    /// Get the number of observations below the binned region, which could
+    /// not be included by extending the binning.
+    ///
+    /// \return The underflow count.
+    inline Count get_underflow_count() const {
+        return out_of_range_counters.underflow;
+    }
+
+    /// Get the number of observations above the binned region, which could
+    /// not be included by extending the binning.
+    ///
+    /// \return The overflow count.
+    inline Count get_overflow_count() const {
+        return out_of_range_counters.overflow;
+    }
+
+protected:
     // General variables
     GE ge;                                               ///< The discrete GE object used by this class.
     Binner *binner;                                      ///< The binner in use.
@@ -278,9 +572,77 @@ private:
     // Variables for the initial collection of data points
     unsigned int initial_max;                            ///< The number of energy observation to be collected for the initial histogram.
     bool initial_collection;                             ///< Whether energies currently are been collected for the initial histogram.
-    std::vector<double> initial_observations;            ///< The collected initial observed energies.
+    InitialObservations initial_observations;            ///< The collected initial observed energies.
     double initial_beta;                                 ///< The beta used in Boltzmann weights for the initial observations.
 
+    /// The private observations of a walker in the multi-walker mode.
+    struct WalkerShard {
+        /// Constructor.
+        WalkerShard() : snapshot(NULL), nbins_added_under(0) {}
+
+        const WeightSnapshot *snapshot;                  ///< The weights and the binning used by the walker (a reference to a published snapshot).
+        unsigned int nbins_added_under;                  ///< The value of CGE::nbins_added_under for the binning of the shard.
+        CArray N;                                        ///< The counts of the observations within the binning of the shard.
+        std::vector<double> energies;                    ///< The observed energies that could not be binned when they were added.
+        InitialObservations initial_observations;        ///< The energies observed during the initial collection.
+    };
+
+    std::vector<WalkerShard> walker_shards;              ///< The shards of the walkers in the multi-walker mode.
+
+    /// The states of an estimation started by begin_estimate_new_weights().
+    enum EstimationState {ESTIMATION_IDLE,                 ///< No estimation is in progress.
+                          ESTIMATION_STARTED,              ///< The estimation has been started, but not computed.
+                          ESTIMATION_COMPUTED,             ///< The estimate has been computed, but the new weights are not in use.
+                          ESTIMATION_DONE};                ///< The new weights are in use, but the deferred observations have not been added.
+
+    unsigned int estimation_state;                       ///< The EstimationState of the estimation started by begin_estimate_new_weights() (accessed atomically).
+    std::vector<double> deferred_observations;           ///< Observations outside the binned region added while new weights were estimated.
+
+    bool extrapolation_linear;                           ///< Whether the current weights are extrapolated linearly outside the binned area.
+    ExtrapolatedWeightScheme::LinearExtrapolation extrapolation_lower;  ///< The extrapolation of the current weights below the binned area.
+    ExtrapolatedWeightScheme::LinearExtrapolation extrapolation_upper;  ///< The extrapolation of the current weights above the binned area.
+
+    WeightTable weight_table;                            ///< A flat table of the current weights.
+    bool weight_table_stale;                             ///< Whether the weights or the binning have changed since weight_table was built.
+
+    // Variables for publishing weight snapshots
+    bool weight_snapshots_enabled;                       ///< Whether a weight snapshot is published each time the weights change.
+    WeightSnapshotPublisher weight_snapshots;            ///< The publisher of the weight snapshots.
+
+    /// Counters for the observations handled by the out-of-range policy,
+    /// which are written to the statistics log as the entry "out_of_range".
+    class OutOfRangeCounters : public Loggable {
+    public:
+        /// Constructor setting all counters to zero.
+        OutOfRangeCounters() : underflow(0), overflow(0), reported(0) {}
+
+        Count underflow;                                 ///< The number of observations below the binned region.
+        Count overflow;                                  ///< The number of observations above the binned region.
+        Count reported;                                  ///< The total number of observations reported by the latest warning.
+
+        // Implementation of Loggable interface (see base class for documentation).
+        virtual void add_statistics_to_log(StatisticsLogger& statistics_logger) const {
+            CArray counts(2);
+            counts(0) = underflow;
+            counts(1) = overflow;
+            statistics_logger.add_entry("out_of_range", counts);
+        }
+    };
+
+    // Variables for observations outside the binning that cannot be extended
+    OutOfRangePolicy out_of_range_policy;                ///< The policy for observations outside the binned region, which cannot be included by extending the binning.
+    bool extension_blocked_lower;                        ///< Whether extending the binning downwards has failed since new weights were last estimated.
+    bool extension_blocked_upper;                        ///< Whether extending the binning upwards has failed since new weights were last estimated.
+    unsigned int nbins_added_under;                      ///< The total number of bins added below the binned area by extending the binning.
+    OutOfRangeCounters out_of_range_counters;            ///< The counters for the observations handled by the out-of-range policy.
+
+    // Buffers used for blocks of observations
+    std::vector<int> bin_buffer;                         ///< The bins of the latest block of energies.
+    std::vector<unsigned int> valid_bin_buffer;          ///< The bins of the latest block of energies that fall within the binned region.
+
+    /// The number of energies binned at a time by the thread safe block version of get_lnweights().
+    static const size_t LNWEIGHTS_BLOCK_SIZE = 256;
+
     // Private methods
 
     /// Method for determining if new weights should be estimated in the
@@ -288,7 +650,7 @@ private:
     ///
     /// \return Returns true if new weight should be estimated.
     inline bool initial_new_weights() {
-        return initial_observations.size() > initial_max;
+        return initial_observations.get_n() > initial_max;
     }
 
     /// Calculate the bin number corresponding to an energy,
@@ -306,6 +668,8 @@ private:
 
             // Extend the binner and the GE object
             ge.extend(extension.first, extension.second, binner);
+            nbins_added_under += extension.first[0];
+            weights_changed();
 
             // Recalculate the bin value
             bin = binner->calc_bin_validated(energy);
@@ -313,12 +677,136 @@ private:
         return static_cast<unsigned int>(bin.first);
     }
 
+    /// Try to extend the binned area to include an energy outside the binned
+    /// region. If the extension fails because the maximal number of bins has
+    /// been reached, extensions in the same direction are not attempted again
+    /// until new weights are estimated. Accordingly, the exception raised by
+    /// the binner is not raised for every observation outside the binned
+    /// region.
+    ///
+    /// \param energy The energy to include.
+    /// \param bin The bin of the energy, which is updated if the binning is extended.
+    /// \return True if the energy is inside the binned region.
+    inline bool extend_binning(double energy, int &bin) {
+        if ((bin < 0) ? extension_blocked_lower : extension_blocked_upper)
+            return false;
+
+        try {
+            bin = static_cast<int>(calc_bin_with_extention(energy));
+            return true;
+        }
+        catch (MaximalNumberOfBinsExceed& exception) {
+            if (bin < 0)
+                extension_blocked_lower = true;
+            else
+                extension_blocked_upper = true;
+
+            MessageLogger::get().warning(exception.what());
+            return false;
+        }
+    }
+
+    /// Count an observation outside the binned region, which could not be
+    /// included by extending the binning.
+    ///
+    /// \param bin The bin of the observation (see Binner::calc_bin()).
+    /// \return The bin at the edge of the binned region if the observation
+    ///         should be added to it, and otherwise -1.
+    inline int count_out_of_range(int bin) {
+        if (bin < 0)
+            out_of_range_counters.underflow++;
+        else
+            out_of_range_counters.overflow++;
+
+        if (out_of_range_policy == OUT_OF_RANGE_CLAMP)
+            return (bin < 0) ? 0 : static_cast<int>(binner->get_nbins())-1;
+        else
+            return -1;
+    }
+
+    /// Get the log weight for an energy outside the binned region, which
+    /// could not be included by extending the binning.
+    ///
+    /// \param bin The bin of the energy (see Binner::calc_bin()).
+    /// \return The log weight according to the out-of-range policy.
+    inline double get_out_of_range_lnweights(int bin) {
+        if (out_of_range_policy == OUT_OF_RANGE_REJECT)
+            return -std::numeric_limits<double>::infinity();
+        else
+            return ge.get_lnweights((bin < 0) ? 0 : static_cast<int>(binner->get_nbins())-1);
+    }
+
+    /// Report the observations handled by the out-of-range policy since the
+    /// last report in a single warning, and allow the binning to be extended
+    /// again. This function is called each time new weights have been
+    /// estimated.
+    void report_out_of_range();
+
+    /// Calculate the bin numbers for a block of energies and store them in
+    /// bin_buffer. The binned area is extended to include the lowest and the
+    /// highest energy outside the binned region. If an extension fails, the
+    /// corresponding bins are left outside the binned region.
+    ///
+    /// \param energies Pointer to the energies to calculate the bins for.
+    /// \param n The number of energies.
+    void calc_bins_with_extention(const double *energies, size_t n);
+
+    /// Get the state of the estimation. Since compute_new_weights() may set
+    /// the state on another thread, the state is read atomically, and the
+    /// results of that thread are visible after the read.
+    ///
+    /// \return The state of the estimation.
+    inline EstimationState get_estimation_state() const {
+        return static_cast<EstimationState>(atomic_read(estimation_state));
+    }
+
+    /// Set the state of the estimation, and make it visible to other threads
+    /// together with all changes made before the call.
+    ///
+    /// \param state The new state.
+    inline void set_estimation_state(EstimationState state) {
+        atomic_write(estimation_state, state);
+    }
+
+    /// Get the log weight of an energy outside the binned area. If the weight
+    /// scheme extrapolates linearly, the extrapolation stored when the weights
+    /// were changed is used, so neither the weight scheme, the estimate nor
+    /// the history is accessed.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \param bin The bin of the energy, which is outside the binned area.
+    /// \return The log weight for the energy.
+    inline double get_extrapolated_lnweights(double energy, int bin) {
+        if (extrapolation_linear) {
+            const ExtrapolatedWeightScheme::LinearExtrapolation &extrapolation = (bin < 0) ? extrapolation_lower : extrapolation_upper;
+            return extrapolation.lnw + extrapolation.slope*(energy - extrapolation.center);
+        }
+        return extrapolated_weightscheme->get_extrapolated_weight(energy, ge.get_current_histogram().get_lnw(), ge.get_estimate(), ge.get_history(), *binner);
+    }
+
+    /// Store the linear extrapolation of the current weights, if the weight
+    /// scheme extrapolates linearly.
+    void update_extrapolation();
+
+    /// Rebuild the weight table from the current weights.
+    void update_weight_table();
+
+    /// Mark the weight table as stale, and publish a snapshot of the current
+    /// weights if publishing is enabled. This function must be called each
+    /// time the weights or the binning have changed.
+    void weights_changed();
+
+    /// Reset the shards of the walkers to be empty and have the same shape as
+    /// the current binning.
+    void reset_walker_shards();
+
     /// Private function adding loggable classes to the statisticslogger.
     ///
     /// \param statisticslogger A pointer to the StatisticsLogger (may be NULL).
     void add_loggables(StatisticsLogger *statisticslogger=NULL) {
         if (statisticslogger!=NULL) {
             statisticslogger->add_loggable(binner);
+            statisticslogger->add_loggable(&out_of_range_counters);
         }
     }
 };
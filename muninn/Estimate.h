@@ -24,11 +24,15 @@
 #ifndef MUNINN_ESTIMATE_H_
 #define MUNINN_ESTIMATE_H_
 
+#include <vector>
+#include <algorithm>
+
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
 #include "muninn/utils/TArrayUtils.h"
 #include "muninn/utils/utils.h"
 #include "muninn/utils/StatisticsLogger.h"
+#include "muninn/SupportIndex.h"
 
 namespace Muninn {
 
@@ -45,7 +49,7 @@ public:
     /// \param x0 The reference bin used for the estimate. The estimated
     ///           entropy should have a fixed reference value in this bin.
     Estimate(const DArray &lnG, const BArray &lnG_support, const std::vector<Index> x0) :
-        lnG(lnG), lnG_support(lnG_support), x0(x0), shape(lnG.get_shape()) {
+        lnG(lnG), lnG_support(lnG_support), lnG_support_index(lnG_support), lnG_support_version(0), x0(x0), shape(lnG.get_shape()) {
         assert(lnG.same_shape(lnG_support));
         assert(x0.size()==0 || x0.size()==lnG.get_ndims());
         assert(lnG.valid_coord(x0));                           // Note that an empty vector also is a valid coordinate
@@ -54,7 +58,7 @@ public:
     /// Construct an empty estimate with a given shape.
     ///
     /// \param shape The shape of the empty estimate.
-    Estimate(const std::vector<Index> &shape) : lnG(shape), lnG_support(shape), shape(shape) {}
+    Estimate(const std::vector<Index> &shape) : lnG(shape), lnG_support(shape), lnG_support_index(), lnG_support_version(0), shape(shape) {}
 
     /// Empty virtual destructor
     virtual ~Estimate() {}
@@ -71,6 +75,19 @@ public:
     /// \return The support.
     inline const BArray& get_lnG_support() const {return lnG_support;}
 
+    /// Getter for the index of the support, which is updated together with
+    /// the support. This should be used instead of scanning the support.
+    ///
+    /// \return The index of the support.
+    inline const SupportIndex& get_lnG_support_index() const {return lnG_support_index;}
+
+    /// Getter for the version of the support, which is incremented every
+    /// time the support is set or extended. This can be used to determine if
+    /// values derived from the support must be recalculated.
+    ///
+    /// \return The version of the support.
+    inline unsigned int get_lnG_support_version() const {return lnG_support_version;}
+
     /// Getter for the reference bin. A zero-size vector means that the
     /// reference bin is undefined.
     ///
@@ -106,6 +123,8 @@ public:
     inline void set_lnG_support(const BArray &new_lnG_support) {
         assert(new_lnG_support.has_shape(shape));
         lnG_support = new_lnG_support;
+        lnG_support_index.update(lnG_support);
+        ++lnG_support_version;
     }
 
     /// Setter for the support of the estimated entropy.
@@ -113,6 +132,8 @@ public:
     /// \param new_lnG_support All entries in the support will get this value.
     inline void set_lnG_support(bool new_lnG_support) {
         lnG_support = new_lnG_support;
+        lnG_support_index.update(lnG_support);
+        ++lnG_support_version;
     }
 
     /// Setter for the reference bin. A zero size vector means that the reference
@@ -130,13 +151,43 @@ public:
     /// \param add_under The number of bins to be added leftmost in all dimensions.
     /// \param add_over The number of bins to be added rightmost in all dimensions.
     virtual void extend(const std::vector<Index> &add_under, const std::vector<Index> &add_over) {
-        lnG = lnG.extended(add_under, add_over);
-        lnG_support = lnG_support.extended(add_under, add_over);
+        lnG.extend(add_under, add_over);
+        lnG_support.extend(add_under, add_over);
+
+        // The added bins have no support, so a one-dimensional index only needs to be moved
+        if (shape.size()==1)
+            lnG_support_index.shift(add_under[0]);
+        else
+            lnG_support_index.update(lnG_support);
+        ++lnG_support_version;
+
         if (x0.size()>0)
             x0 = add_vectors(add_under, x0);
         shape = lnG.get_shape();
     }
 
+    /// Make a copy of the estimate with the same type as this estimate.
+    ///
+    /// \return A pointer to the new estimate, which the caller owns.
+    virtual Estimate* clone() const {
+        return new Estimate(*this);
+    }
+
+    /// Exchange the contents of this estimate with an other estimate of the
+    /// same type. This allows an estimate calculated in a copy (see clone())
+    /// to replace this estimate, while references to this estimate remain
+    /// valid.
+    ///
+    /// \param other The estimate to exchange contents with.
+    virtual void swap(Estimate &other) {
+        std::swap(lnG, other.lnG);
+        std::swap(lnG_support, other.lnG_support);
+        std::swap(lnG_support_index, other.lnG_support_index);
+        std::swap(lnG_support_version, other.lnG_support_version);
+        x0.swap(other.x0);
+        shape.swap(other.shape);
+    }
+
     /// Add an entries to the statistics log. This function implements the
     /// Loggable interface.
     ///
@@ -150,6 +201,8 @@ public:
 private:
     DArray lnG;                ///< The estimated entropy.
     BArray lnG_support;        ///< The support for the estimate of the entropy.
+    SupportIndex lnG_support_index;    ///< The index of the bins in lnG_support with support.
+    unsigned int lnG_support_version;  ///< Incremented every time lnG_support is changed.
     std::vector<Index> x0;     ///< The index of the reference bin for the entropy (the entropy has a fixed value in this bin). A zero size vector means that the reference bin is undefined.
     std::vector<Index> shape;  ///< The shape of the estimate.
 };
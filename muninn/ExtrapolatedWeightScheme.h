@@ -54,6 +54,27 @@ public:
     /// \param binner The binner describing the current binning.
     /// \return The weight corresponding to the given value.
     virtual double get_extrapolated_weight(double value, const DArray &lnw, const Estimate &estimate, const History &history, const Binner &binner) = 0;
+
+    /// A linear extrapolation of the weights on one side of the binned area,
+    /// given by \f$ \ln w(E) = \ln w_0 + \alpha (E - E_0) \f$.
+    struct LinearExtrapolation {
+        double center;  ///< The energy \f$ E_0 \f$ the extrapolation is made from.
+        double lnw;     ///< The log weight \f$ \ln w_0 \f$ in \f$ E_0 \f$.
+        double slope;   ///< The slope \f$ \alpha \f$ of the extrapolation.
+    };
+
+    /// Get the parameters of the extrapolation, if the scheme extrapolates
+    /// the weights linearly. This allows the extrapolated weights to be
+    /// calculated without calling get_extrapolated_weight().
+    ///
+    /// \param lnw The current weights.
+    /// \param left The extrapolation below the binned area.
+    /// \param right The extrapolation above the binned area.
+    /// \return True if the scheme extrapolates linearly and the parameters
+    ///         have been set.
+    virtual bool get_linear_extrapolation(const DArray &lnw, LinearExtrapolation &left, LinearExtrapolation &right) const {
+        return false;
+    }
 };
 
 } // namespace Muninn
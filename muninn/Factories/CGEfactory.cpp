@@ -24,6 +24,7 @@
 #include "muninn/Factories/CGEfactory.h"
 #include "muninn/CGE.h"
 #include "muninn/MLE/MLE.h"
+#include "muninn/MLE/WHAM.h"
 #include "muninn/Binners/UniformBinner.h"
 #include "muninn/Binners/NonUniformDynamicBinner.h"
 #include "muninn/UpdateSchemes/IncreaseFactorScheme.h"
@@ -40,7 +41,7 @@
 
 namespace Muninn {
 
-CGE* CGEfactory::new_CGE(const Settings& settings) {
+CGE* CGEfactory::new_CGE(const Settings& settings, bool specialized) {
     // Set the Muninn debug level
     MessageLogger::get().set_verbose(settings.verbose);
 
@@ -105,7 +106,12 @@ CGE* CGEfactory::new_CGE(const Settings& settings) {
 
     switch (settings.estimator) {
     case ESTIMATOR_MLE :
-        estimator = new MLE(settings.min_count, settings.memory, settings.restricted_individual_support);
+        estimator = new MLE(settings.min_count, settings.memory, settings.restricted_individual_support,
+                            MultiHistogramHistory::DROP_OLDEST, 20, settings.estimator_threads);
+        break;
+    case ESTIMATOR_WHAM :
+        estimator = new WHAM(settings.min_count, settings.memory, settings.restricted_individual_support,
+                             MultiHistogramHistory::DROP_OLDEST, 20, settings.estimator_threads, 5, settings.estimator_time_budget);
         break;
     default :
         throw(CGEfactorySettingsException("Estimator not set correctly."));
@@ -221,7 +227,12 @@ CGE* CGEfactory::new_CGE(const Settings& settings) {
     CGE* cge = NULL;
 
     if (statistics_log_reader==NULL) {
-    	cge = new CGE(estimator, update_scheme, weight_scheme, binner, statistics_logger, settings.initial_beta, true);
+        if (!specialized)
+            cge = new CGE(estimator, update_scheme, weight_scheme, binner, statistics_logger, settings.initial_beta, true);
+        else if (settings.use_dynamic_binning)
+            cge = new SpecializedCGE<NonUniformDynamicBinner, IncreaseFactorScheme>(estimator, update_scheme, weight_scheme, static_cast<NonUniformDynamicBinner*>(binner), statistics_logger, settings.initial_beta, true);
+        else
+            cge = new SpecializedCGE<UniformBinner, IncreaseFactorScheme>(estimator, update_scheme, weight_scheme, static_cast<UniformBinner*>(binner), statistics_logger, settings.initial_beta, true);
     }
     else {
         unsigned int number_of_free_energies = statistics_log_reader->get_free_energies().back().second.get_shape().at(0);
@@ -261,9 +272,16 @@ CGE* CGEfactory::new_CGE(const Settings& settings) {
                                                          *history, binner, true);
 
     	// Construct the CGE object
-    	cge = new CGE(estimate, history, estimator, update_scheme, weight_scheme, binner, statistics_logger, true);
+        if (!specialized)
+            cge = new CGE(estimate, history, estimator, update_scheme, weight_scheme, binner, statistics_logger, true);
+        else if (settings.use_dynamic_binning)
+            cge = new SpecializedCGE<NonUniformDynamicBinner, IncreaseFactorScheme>(estimate, history, estimator, update_scheme, weight_scheme, static_cast<NonUniformDynamicBinner*>(binner), statistics_logger, true);
+        else
+            cge = new SpecializedCGE<UniformBinner, IncreaseFactorScheme>(estimate, history, estimator, update_scheme, weight_scheme, static_cast<UniformBinner*>(binner), statistics_logger, true);
     }
 
+    cge->set_out_of_range_policy(settings.out_of_range_policy);
+
     return cge;
 }
 
@@ -287,6 +305,16 @@ std::ostream &operator<<(std::ostream &output, const EstimatorEnum &e) {
     return output_operator<EstimatorEnum>(output, e, ESTIMATOR_ENUM_SIZE, EstimatorEnumNames);
 }
 
+/// Input operator of a CGE::OutOfRangePolicy from string.
+std::istream &operator>>(std::istream &input, CGE::OutOfRangePolicy &p) {
+    return input_operator<CGE::OutOfRangePolicy>(input, p, CGE::OUT_OF_RANGE_SIZE, CGE::OutOfRangePolicyNames);
+}
+
+/// Output operator for a CGE::OutOfRangePolicy
+std::ostream &operator<<(std::ostream &output, const CGE::OutOfRangePolicy &p) {
+    return output_operator<CGE::OutOfRangePolicy>(output, p, CGE::OUT_OF_RANGE_SIZE, CGE::OutOfRangePolicyNames);
+}
+
 /// Input operator of a StatisticsLogger::Mode from string.
 std::istream &operator>>(std::istream &input, StatisticsLogger::Mode &m) {
     return input_operator<StatisticsLogger::Mode>(input, m, StatisticsLogger::SIZE, StatisticsLogger::ModeNames);
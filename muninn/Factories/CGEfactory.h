@@ -26,6 +26,8 @@
 
 #include "muninn/common.h"
 #include "muninn/CGE.h"
+#include "muninn/SpecializedCGE.h"
+#include "muninn/UpdateSchemes/IncreaseFactorScheme.h"
 #include "muninn/Factories/CGEfactorySettingsException.h"
 
 namespace Muninn {
@@ -37,10 +39,10 @@ enum GeEnum {GE_MULTICANONICAL=0, GE_INV_K, GE_INV_K_P, GE_ENUM_SIZE};
 static const std::string GeEnumNames[] = {"multicanonical", "invk", "invkp"};
 
 /// Define the different estimators
-enum EstimatorEnum {ESTIMATOR_MLE=0, ESTIMATOR_ENUM_SIZE};
+enum EstimatorEnum {ESTIMATOR_MLE=0, ESTIMATOR_WHAM, ESTIMATOR_ENUM_SIZE};
 
 /// Define the string names corresponding to the values of EstimatorEnum
-static const std::string EstimatorEnumNames[] = {"MLE"};
+static const std::string EstimatorEnumNames[] = {"MLE", "WHAM"};
 
 /// Input operator of a GeEnum from string.
 std::istream &operator>>(std::istream &input, GeEnum &g);
@@ -54,6 +56,12 @@ std::istream &operator>>(std::istream &input, EstimatorEnum &g);
 /// Output operator for a EstimatorEnum.
 std::ostream &operator<<(std::ostream &o, const EstimatorEnum &g);
 
+/// Input operator of a CGE::OutOfRangePolicy from string.
+std::istream &operator>>(std::istream &input, CGE::OutOfRangePolicy &p);
+
+/// Output operator for a CGE::OutOfRangePolicy.
+std::ostream &operator<<(std::ostream &o, const CGE::OutOfRangePolicy &p);
+
 /// Input operator of a StatisticsLogger::Mode from string.
 std::istream &operator>>(std::istream &input, StatisticsLogger::Mode &m);
 
@@ -71,7 +79,7 @@ public:
         /// Weight-scheme to use: invk|multicanonical|invkp
         GeEnum weight_scheme;
 
-        /// Estimator to use: MLE
+        /// Estimator to use: MLE|WHAM
         EstimatorEnum estimator;
 
         /// Slope factor used for the linear extrapolation of the weights, when the weights are increasing in the direction away from the main area of support.
@@ -163,6 +171,19 @@ public:
         /// The verbose level of Muninn.
         int verbose;
 
+        /// The number of threads used by the estimator. The estimates does
+        /// not depend on the number of threads.
+        unsigned int estimator_threads;
+
+        /// The maximal time in seconds used by the WHAM estimator for each
+        /// estimation. If zero, there is no time limit.
+        double estimator_time_budget;
+
+        /// The policy for observations outside the binned region, when the
+        /// maximal number of bins has been reached (reject|clamp).
+        /// See CGE::OutOfRangePolicy for details.
+        CGE::OutOfRangePolicy out_of_range_policy;
+
         /// Constructor that sets the default values for the settings.
         ///
         /// \param weight_scheme See documentation for Settings::weight_scheme.
@@ -193,6 +214,9 @@ public:
         /// \param bin_width See documentation for Settings::bin_width.
         /// \param separator See documentation for Settings::separator.
         /// \param verbose See documentation for Settings::verbose.
+        /// \param estimator_threads See documentation for Settings::estimator_threads.
+        /// \param estimator_time_budget See documentation for Settings::estimator_time_budget.
+        /// \param out_of_range_policy See documentation for Settings::out_of_range_policy.
         Settings(GeEnum weight_scheme=GE_MULTICANONICAL,
                  EstimatorEnum estimator=ESTIMATOR_MLE,
                  double slope_factor_up = 0.3,
@@ -220,7 +244,10 @@ public:
                  unsigned int max_number_of_bins=1000000,
                  double bin_width = 0.1,
                  std::string separator=":",
-                 int verbose=3)
+                 int verbose=3,
+                 unsigned int estimator_threads=1,
+                 double estimator_time_budget=0,
+                 CGE::OutOfRangePolicy out_of_range_policy=CGE::OUT_OF_RANGE_REJECT)
         : weight_scheme(weight_scheme),
           estimator(estimator),
           slope_factor_up(slope_factor_up),
@@ -248,7 +275,10 @@ public:
           max_number_of_bins(max_number_of_bins),
           bin_width(bin_width),
           separator(separator),
-          verbose(verbose) {}
+          verbose(verbose),
+          estimator_threads(estimator_threads),
+          estimator_time_budget(estimator_time_budget),
+          out_of_range_policy(out_of_range_policy) {}
 
         /// Function for setting the separator symbol.
         ///
@@ -288,14 +318,41 @@ public:
             o << "max_number_of_bins" << settings.separator << settings.max_number_of_bins << std::endl;
             o << "bin_width" << settings.separator << settings.bin_width << std::endl;
             o << "verbose" << settings.separator << settings.verbose << std::endl;
+            o << "estimator_threads" << settings.separator << settings.estimator_threads << std::endl;
+            o << "estimator_time_budget" << settings.separator << settings.estimator_time_budget << std::endl;
+            o << "out_of_range_policy" << settings.separator << settings.out_of_range_policy << std::endl;
             return o;
         }
     };
 
     /// Function for creating a new CGE class based on a setting object.
     /// \param settings A settings object described how to create a new CGE object.
+    /// \param specialized If true, the returned object is a SpecializedCGE for
+    ///                    the binner and update scheme given by the settings.
     /// \return A new CGE object.
-    static CGE* new_CGE(const Settings& settings = Settings());
+    static CGE* new_CGE(const Settings& settings = Settings(), bool specialized=false);
+
+    /// Function for creating a new CGE class specialized for the binner and
+    /// update scheme based on a setting object. The factory uses the
+    /// IncreaseFactorScheme, and the binner is a NonUniformDynamicBinner if
+    /// Settings::use_dynamic_binning is true and an UniformBinner otherwise.
+    ///
+    /// \param settings A settings object described how to create a new CGE object.
+    /// \return A new specialized CGE object.
+    ///
+    /// \tparam BinnerT The type of the binner, which must match the settings.
+    template <class BinnerT>
+    static SpecializedCGE<BinnerT, IncreaseFactorScheme>* new_specialized_CGE(const Settings& settings = Settings()) {
+        CGE *cge = new_CGE(settings, true);
+        SpecializedCGE<BinnerT, IncreaseFactorScheme> *specialized_cge = dynamic_cast<SpecializedCGE<BinnerT, IncreaseFactorScheme>*>(cge);
+
+        if (specialized_cge==NULL) {
+            delete cge;
+            throw(CGEfactorySettingsException("The binner type of the specialized CGE does not match the settings."));
+        }
+
+        return specialized_cge;
+    }
 };
 
 } // namespace Muninn
@@ -23,12 +23,19 @@
 
 #include <deque>
 #include <vector>
+#include <limits>
 
 #include "muninn/GE.h"
 
 namespace Muninn {
 
 void GE::estimate_new_weights(const Binner *binner) {
+    begin_estimate_new_weights();
+    compute_new_estimate(binner);
+    finish_estimate_new_weights(binner);
+}
+
+void GE::begin_estimate_new_weights() {
     // Inform that new weights will be estimated
     MessageLogger::get().info("Estimating new weights.");
     MessageLogger::get().debug("Histogram shape: " + to_string<std::vector<unsigned int> >(current->get_shape()));
@@ -40,36 +47,102 @@ void GE::estimate_new_weights(const Binner *binner) {
     // TODO: Find a more elegant way of doing this.
     updatescheme->updating_history(*current, *history);
 
-    // Put the current histogram into the history.
-    history->add_histogram(current);
-    current = NULL;
+    // Put a copy of the current histogram into the history, and continue
+    // with the current histogram emptied, which keeps the weights
+    history->add_histogram(*current);
+    current->clear();
+
+    // The new estimate is calculated in a copy, and the history is left to
+    // compute_new_estimate() until the estimation is finished. Observations
+    // are counted without consulting the update scheme in the meantime.
+    delete next_estimate;
+    next_estimate = estimate->clone();
+    estimation_in_progress = true;
+    new_weights_variable = false;
+    update_countdown = std::numeric_limits<Count>::max();
+
+    estimate_failed = false;
+    estimate_failure.clear();
+}
 
+void GE::compute_new_estimate(const Binner *binner) {
     try {
         // Estimate lnG from the data
-        estimator->estimate(*history, *estimate, binner);
-
-        // Log the current statistics
-        force_statistics_log();
-
-        // Make a new empty current histogram, with the newly estimated weights
-        DArray new_weights = weightscheme->get_weights(*estimate, *history, binner);
-        current = estimator->new_histogram(new_weights);
-
-        // TODO: Find a more elegant way of doing this.
-        updatescheme->reset_prolonging();
+        estimator->estimate(*history, *next_estimate, binner);
     }
     catch (EstimatorException &exception){
+        estimate_failed = true;
+        estimate_failure = exception.what();
+    }
+}
+
+void GE::finish_estimate_new_weights(const Binner *binner) {
+    // The observations added since begin_estimate_new_weights()
+    Histogram *collected = current;
+    current = NULL;
+    estimation_in_progress = false;
+
+    // Swap in the new estimate, keeping the old if the estimation failed
+    if (!estimate_failed)
+        estimate->swap(*next_estimate);
+    delete next_estimate;
+    next_estimate = NULL;
+
+    if (!estimate_failed) {
+        try {
+            // Log the current statistics
+            force_statistics_log();
+
+            // Make a new empty current histogram, with the newly estimated
+            // weights. If no observations were collected during the
+            // estimation, the collected histogram is reused.
+            DArray new_weights = weightscheme->get_weights(*estimate, *history, binner);
+            if (collected->get_n() == 0) {
+                collected->set_lnw(new_weights);
+                current = collected;
+                collected = NULL;
+            }
+            else {
+                current = estimator->new_histogram(new_weights);
+            }
+
+            // TODO: Find a more elegant way of doing this.
+            updatescheme->reset_prolonging();
+        }
+        catch (EstimatorException &exception){
+            estimate_failed = true;
+            estimate_failure = exception.what();
+        }
+    }
+
+    if (estimate_failed) {
         // Write warnings
-        MessageLogger::get().warning(exception.what());
+        MessageLogger::get().warning(estimate_failure);
         MessageLogger::get().warning("Keeping old weights.");
 
-        // Clean up the history and prolong the simulation time
+        // Clean up the history and prolong the simulation time. The collected
+        // histogram has the weights of the removed histogram, and the counts
+        // of the removed histogram are added to it.
         // TODO: Find a more elegant way of doing this.
-        current = history->remove_newest();
+        Histogram *newest = history->remove_newest();
+        collected->add_counts(*newest);
+        delete newest;
+        current = collected;
         updatescheme->prolong();
     }
+    else if (collected != NULL && collected->get_n() > 0) {
+        // The observations were collected with the old weights, so they are
+        // kept as a separate histogram. As for any histogram entering the
+        // history, the update scheme is told first.
+        total_iterations += collected->get_n();
+        updatescheme->updating_history(*collected, *history);
+        history->add_histogram(collected);
+    }
+    else {
+        delete collected;
+    }
 
-    new_weights_variable = updatescheme->update_required(*current, *history);
+    consult_updatescheme();
 }
 
 void GE::extend(const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over, const Binner *binner) {
@@ -82,8 +155,10 @@ void GE::extend(const std::vector<unsigned int> &add_under, const std::vector<un
     // Extend the estimate
     estimator->extend_estimate(*history, *estimate, add_under, add_over);
 
-    // Set the new weights based on the new estimate
-    current->set_lnw(weightscheme->get_weights(*estimate, *history, binner));
+    // Set the weights in the added bins, or recalculate all the weights
+    // based on the new estimate if the weight scheme does not support this
+    if (!weightscheme->extend_weights(current->lnw, add_under, add_over, *estimate, *history, binner))
+        current->set_lnw(weightscheme->get_weights(*estimate, *history, binner));
 }
 
 } // namespace Muninn
@@ -26,6 +26,7 @@
 
 #include <cassert>
 #include <deque>
+#include <string>
 #include <vector>
 
 #include "muninn/common.h"
@@ -188,6 +189,7 @@ public:
     /// also deleted.
     virtual ~GE() {
         delete current;
+        delete next_estimate;
 
         if (has_ownership_estimate_and_history) {
         	delete history;
@@ -208,7 +210,27 @@ public:
     /// \return Returns true if new weights should be estimated.
     inline bool add_observation(unsigned int bin) {
         current->add_observation(bin);
-        new_weights_variable = updatescheme->update_required(*current, *history);
+        return observation_added();
+    }
+
+    /// Function for adding a one dimensional observation, where the update
+    /// scheme is known to be of the type UpdateSchemeT. The update scheme is
+    /// called non-virtually, which allows the call to be inlined.
+    ///
+    /// \param bin The bin index of the observation.
+    /// \return Returns true if new weights should be estimated.
+    ///
+    /// \tparam UpdateSchemeT The type of the update scheme in use.
+    template <class UpdateSchemeT>
+    inline bool add_observation_specialized(unsigned int bin) {
+        current->add_observation(bin);
+        if (update_countdown > 0) {
+            --update_countdown;
+            return new_weights_variable;
+        }
+        UpdateSchemeT *scheme = static_cast<UpdateSchemeT*>(updatescheme);
+        new_weights_variable = scheme->UpdateSchemeT::update_required(*current, *history);
+        set_update_countdown(new_weights_variable ? 0 : scheme->UpdateSchemeT::observations_until_update(*current, *history));
         return new_weights_variable;
     }
 
@@ -219,8 +241,7 @@ public:
     /// \return Returns true if new weights should be estimated.
     inline bool add_observation(unsigned int bin1, unsigned int bin2) {
         current->add_observation(bin1, bin2);
-        new_weights_variable = updatescheme->update_required(*current, *history);
-        return new_weights_variable;
+        return observation_added();
     }
 
     /// Method for adding a multidimensional observation.
@@ -230,8 +251,31 @@ public:
     /// \return Returns true if new weights should be estimated.
     inline bool add_observation(std::vector<unsigned int> &bin) {
         current->add_observation(bin);
-        new_weights_variable = updatescheme->update_required(*current, *history);
-        return new_weights_variable;
+        return observation_added();
+    }
+
+    /// Function for adding a block of one dimensional observations. The
+    /// update scheme is only consulted once, after the whole block has been
+    /// added.
+    ///
+    /// \param bins Pointer to the bin indices of the observations.
+    /// \param n The number of observations.
+    /// \return Returns true if new weights should be estimated.
+    inline bool add_observations(const unsigned int *bins, size_t n) {
+        for (size_t i=0; i<n; ++i)
+            current->add_observation(bins[i]);
+        return consult_updatescheme();
+    }
+
+    /// Function for adding a histogram of counts. The update scheme is only
+    /// consulted once, after all counts have been added.
+    ///
+    /// \param counts The counts to add, which must have the same shape as
+    ///               the current histogram.
+    /// \return Returns true if new weights should be estimated.
+    inline bool add_counts(const CArray &counts) {
+        current->add_counts(counts);
+        return consult_updatescheme();
     }
 
     /// Get the weigh associated with a bin, using a one dimensional index.
@@ -274,6 +318,42 @@ public:
     ///               is non-uniform.
     void estimate_new_weights(const Binner *binner=NULL);
 
+    /// First step of estimating new weights in three steps, which allows the
+    /// estimation to run concurrently with the sampling. The current histogram
+    /// is put into the history, and a new empty histogram with the same
+    /// weights is made current, such that observations can be added while the
+    /// new estimate is calculated. Calling begin_estimate_new_weights(),
+    /// compute_new_estimate() and finish_estimate_new_weights() in turn is
+    /// equivalent to calling estimate_new_weights().
+    void begin_estimate_new_weights();
+
+    /// Second step of estimating new weights (see begin_estimate_new_weights()).
+    /// The function calculates the new estimate from the history into a copy
+    /// of the estimate, which is swapped in by finish_estimate_new_weights().
+    /// It may run on another thread while observations are added to the
+    /// current histogram, provided that the binning is not extended in the
+    /// meantime. Until the estimation is finished the history belongs to
+    /// this function, so the update scheme is not consulted, and the history
+    /// must not be accessed through get_history(). The old estimate is
+    /// unchanged and can still be read through get_estimate().
+    ///
+    /// \param binner A Binner should be passed if the binning of the histogram
+    ///               is non-uniform.
+    void compute_new_estimate(const Binner *binner=NULL);
+
+    /// Third step of estimating new weights (see begin_estimate_new_weights()).
+    /// The new weights are calculated from the new estimate and a new empty
+    /// current histogram is made with these. The observations collected with
+    /// the old weights during the estimation are kept as a separate histogram
+    /// in the history, after the update scheme has been informed through
+    /// UpdateScheme::updating_history(). If the estimation failed, these observations are
+    /// instead added to the histogram put into the history in the first step,
+    /// which then becomes the current histogram again.
+    ///
+    /// \param binner A Binner should be passed if the binning of the histogram
+    ///               is non-uniform.
+    void finish_estimate_new_weights(const Binner *binner=NULL);
+
     /// Force the GE class to write stastics to the log (using the
     /// StatisticsLogger). If a Binner is passed, the state of the binner
     /// is also logged.
@@ -337,6 +417,7 @@ private:
     Histogram *current;                 ///< The current histogram.
     History *history;                   ///< The history of histograms (has ownership unless it's null)
     Estimate *estimate;                 ///< The current estimate of the density of states.
+    Estimate *next_estimate;            ///< The copy of the estimate calculated by compute_new_estimate() (NULL when no estimation is in progress).
 
     Estimator *estimator;               ///< The Estimator in use.
     UpdateScheme *updatescheme;         ///< The UpdateScheme in use.
@@ -349,12 +430,59 @@ private:
 
     Count total_iterations;             ///< The total number of iterations recorded by the GE class, including observations dropped from the history.
     bool new_weights_variable;          ///< This variable is set to true, when the UpdateScheme says it is time to estimate new weights.
+    Count update_countdown;             ///< The number of observations that can be added before the UpdateScheme must be consulted again.
+
+    bool estimation_in_progress;        ///< Whether begin_estimate_new_weights() has been called, but finish_estimate_new_weights() has not.
+    bool estimate_failed;               ///< Whether the latest call to compute_new_estimate() failed.
+    std::string estimate_failure;       ///< The message of the exception raised, if the latest estimation failed.
 
     /// Private function for initializing the class
     void init() {
         // Setup other variables
         total_iterations = 0;
         new_weights_variable = false;
+        update_countdown = 0;
+        next_estimate = NULL;
+        estimation_in_progress = false;
+        estimate_failed = false;
+    }
+
+    /// Private function for setting the observation countdown, given the
+    /// number of observations before the update scheme can require an
+    /// update. The countdown is one less, since the update scheme must be
+    /// consulted when the last of these observations is added.
+    ///
+    /// \param until The number of observations before an update can be required.
+    inline void set_update_countdown(Count until) {
+        update_countdown = (until > 0) ? until-1 : 0;
+    }
+
+    /// Private function for consulting the update scheme, which sets the
+    /// cached value returned by new_weights() and the observation countdown.
+    /// The update scheme is not consulted while new weights are estimated,
+    /// since the history is then used by compute_new_estimate().
+    ///
+    /// \return Returns true if new weights should be estimated.
+    inline bool consult_updatescheme() {
+        if (estimation_in_progress)
+            return false;
+
+        new_weights_variable = updatescheme->update_required(*current, *history);
+        set_update_countdown(new_weights_variable ? 0 : updatescheme->observations_until_update(*current, *history));
+        return new_weights_variable;
+    }
+
+    /// Private function called after a single observation has been added to
+    /// the current histogram. The update scheme is only consulted when the
+    /// observation countdown has reached zero.
+    ///
+    /// \return Returns true if new weights should be estimated.
+    inline bool observation_added() {
+        if (update_countdown > 0) {
+            --update_countdown;
+            return new_weights_variable;
+        }
+        return consult_updatescheme();
     }
 
     /// Private function adding loggable classes to the statisticslogger.
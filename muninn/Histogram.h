@@ -27,10 +27,12 @@
 #include <vector>
 #include <deque>
 #include <iostream>
+#include <algorithm>
 
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
 #include "muninn/utils/utils.h"
+#include "muninn/utils/threads.h"
 #include "muninn/utils/StatisticsLogger.h"
 
 namespace Muninn {
@@ -38,6 +40,16 @@ namespace Muninn {
 /// The Histogram base class. The class contains a histogram of counts, the
 /// weights used to generate the histogram, and the total number of
 /// observations in the histogram.
+///
+/// Since the counts of a single histogram normally only cover a narrow part
+/// of the binning, the histogram keeps track of the window of flat indices
+/// [get_window_begin(), get_window_end()) outside which all counts are zero.
+/// This allows the history and the estimators to visit only the window.
+///
+/// Each constructed histogram is given a unique id (see get_id()), which
+/// estimators can use for recognizing histograms between estimates. Unlike
+/// the address of the histogram, the id is never reused, and a copy of a
+/// histogram is given a new id.
 class Histogram {
 public:
 
@@ -45,14 +57,14 @@ public:
     ///
     /// \param shape The shape of the histogram.
     Histogram(const std::vector<unsigned int> &shape) :
-        N(shape), lnw(shape), n(0), shape(shape) {}
+        N(shape), lnw(shape), n(0), shape(shape), window_begin(0), window_end(0), id(new_id()) {}
 
     /// Constructor for an histogram with a set of weights. The count histogram
     /// will be empty, but the histogram will get the same shape as the weights.
     ///
     /// \param lnw The weights the histogram will be initialized with.
     Histogram(const DArray &lnw) :
-        N(lnw.get_shape()), lnw(lnw), n(0), shape(lnw.get_shape()) {}
+        N(lnw.get_shape()), lnw(lnw), n(0), shape(lnw.get_shape()), window_begin(0), window_end(0), id(new_id()) {}
 
     /// Constructor for an histogram with a initial set of counts and a set of
     /// corresponding weights. The count histogram.
@@ -60,19 +72,43 @@ public:
     /// \param N The initial set of counts.
     /// \param lnw The weights the histogram will be initialized with.
     Histogram(const CArray &N, const DArray &lnw) :
-        N(N), lnw(lnw), n(N.sum()), shape(N.get_shape()) {
+        N(N), lnw(lnw), n(N.sum()), shape(N.get_shape()), window_begin(0), window_end(0), id(new_id()) {
     	assert(N.same_shape(lnw));
+    	find_window();
     }
 
+    /// Copy constructor. The copy is a new histogram, so it is given its own
+    /// id.
+    ///
+    /// \param other The histogram to copy.
+    Histogram(const Histogram &other) :
+        N(other.N), lnw(other.lnw), n(other.n), shape(other.shape), window_begin(other.window_begin), window_end(other.window_end), id(new_id()) {}
+
     /// Default destructor
     virtual ~Histogram() {}
 
+    /// Assignment operator. The counts and weights are copied, but the
+    /// histogram keeps its own id.
+    ///
+    /// \param other The histogram to copy.
+    /// \return A reference to this histogram.
+    Histogram &operator=(const Histogram &other) {
+        if (this != &other) {
+            N = other.N;
+            lnw = other.lnw;
+            n = other.n;
+            shape = other.shape;
+            window_begin = other.window_begin;
+            window_end = other.window_end;
+        }
+        return *this;
+    }
+
     /// Function for adding a one dimensional observation to the histogram.
     ///
     /// \param bin The bin index for the observation.
     inline void add_observation(unsigned int bin) {
-        N(bin)++;
-        n++;
+        add_to_bin(N(bin));
     }
 
     /// Function for adding a two dimensional observation to the histogram.
@@ -80,16 +116,71 @@ public:
     /// \param bin1 The first bin index of the observation to be added.
     /// \param bin2 The second bin index of the observation to be added.
     inline void add_observation(unsigned int bin1, unsigned int bin2) {
-        N(bin1, bin2)++;
-        n++;
+        add_to_bin(N(bin1, bin2));
     }
 
     /// Function for adding multidimensional observations to the histogram.
     ///
     /// \param bin The multidimensional index of the bin for the observation.
     inline void add_observation(std::vector<unsigned int> &bin) {
-        N(bin)++;
-        n++;
+        add_to_bin(N(bin));
+    }
+
+    /// Function for adding a histogram of counts to the histogram. The
+    /// window is updated while the counts are added.
+    ///
+    /// \param counts The counts to add, which must have the same shape as
+    ///               the histogram.
+    inline void add_counts(const CArray &counts) {
+        assert(counts.has_shape(shape));
+        const Count *added = counts.get_array();
+        Count *N_array = N.get_array();
+        const unsigned int size = N.get_asize();
+        unsigned int added_begin = size;
+        unsigned int added_end = 0;
+
+        for (unsigned int i=0; i<size; ++i) {
+            if (added[i] > 0) {
+                N_array[i] += added[i];
+                n += added[i];
+
+                if (added_begin == size)
+                    added_begin = i;
+                added_end = i+1;
+            }
+        }
+
+        if (added_begin < added_end)
+            include_in_window(added_begin, added_end);
+    }
+
+    /// Function for adding the counts of another histogram to the histogram.
+    /// Only the window of the other histogram is visited.
+    ///
+    /// \param other The histogram to add, which must have the same shape as
+    ///              the histogram.
+    inline void add_counts(const Histogram &other) {
+        assert(vector_equal(other.shape, shape));
+        const Count *added = other.N.get_array();
+        Count *N_array = N.get_array();
+
+        for (unsigned int i=other.window_begin; i<other.window_end; ++i)
+            N_array[i] += added[i];
+        n += other.n;
+        include_in_window(other.window_begin, other.window_end);
+    }
+
+    /// Remove all counts from the histogram, while keeping the weights. Only
+    /// the window of the histogram is visited. Since the emptied histogram
+    /// collects new observations, it is given a new id.
+    void clear() {
+        Count *counts = N.get_array();
+        for (unsigned int i=window_begin; i<window_end; ++i)
+            counts[i] = 0;
+
+        n = 0;
+        window_begin = window_end = 0;
+        id = new_id();
     }
 
     /// Function for extending the shape of the Histogram.
@@ -97,9 +188,14 @@ public:
     /// \param add_under The number of bins to be added leftmost in all dimensions.
     /// \param add_over The number of bins to be added rightmost in all dimensions.
     void extend(const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over) {
-        N = N.extended(add_under, add_over);
-        lnw = lnw.extended(add_under, add_over);
+        const std::vector<unsigned int> old_shape = shape;
+        N.extend(add_under, add_over);
+        lnw.extend(add_under, add_over);
         shape = add_vectors(shape, add_under, add_over);
+
+        // The extension preserves the order of the flat indices, so only the
+        // ends of the window are mapped
+        extend_window(window_begin, window_end, old_shape, add_under, add_over);
     }
 
     /// Set the weights used to collect the histogram.
@@ -130,6 +226,68 @@ public:
     /// \return The shape of the histogram.
     inline const std::vector<unsigned int>& get_shape() const {return shape;}
 
+    /// Get the first flat index of the window of bins with counts. All bins
+    /// with a flat index outside the window have zero counts.
+    ///
+    /// \return The first flat index of the window.
+    inline unsigned int get_window_begin() const {return window_begin;}
+
+    /// Get one past the last flat index of the window of bins with counts. If
+    /// the histogram has no counts the window is empty, that is
+    /// get_window_begin()==get_window_end().
+    ///
+    /// \return One past the last flat index of the window.
+    inline unsigned int get_window_end() const {return window_end;}
+
+    /// Get the unique id of the histogram. The ids are assigned in increasing
+    /// order when histograms are constructed, and are never reused.
+    ///
+    /// \return The id of the histogram.
+    inline Count get_id() const {return id;}
+
+    /// Map a window of flat indices to the window after an extension of the
+    /// shape. Since the extension preserves the order of the flat indices,
+    /// only the ends of the window are mapped.
+    ///
+    /// \param begin The first flat index of the window (updated).
+    /// \param end One past the last flat index of the window (updated).
+    /// \param shape The shape before the extension.
+    /// \param add_under The number of bins added leftmost in all dimensions.
+    /// \param add_over The number of bins added rightmost in all dimensions.
+    static void extend_window(unsigned int &begin, unsigned int &end, const std::vector<unsigned int> &shape,
+                              const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over) {
+        if (begin < end) {
+            const unsigned int last = extended_index(end-1, shape, add_under, add_over);
+            begin = extended_index(begin, shape, add_under, add_over);
+            end = last+1;
+        }
+    }
+
+    /// Map a flat index to the flat index of the same bin after an extension
+    /// of the shape.
+    ///
+    /// \param index The flat index before the extension.
+    /// \param shape The shape before the extension.
+    /// \param add_under The number of bins added leftmost in all dimensions.
+    /// \param add_over The number of bins added rightmost in all dimensions.
+    /// \return The flat index after the extension.
+    static unsigned int extended_index(unsigned int index, const std::vector<unsigned int> &shape,
+                                       const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over) {
+        unsigned int extended = 0;
+        unsigned int stride = 1;
+
+        for (unsigned int dim=0; dim<shape.size(); ++dim) {
+            extended += (index % shape[dim] + add_under[dim]) * stride;
+            index /= shape[dim];
+            stride *= shape[dim] + add_under[dim] + add_over[dim];
+        }
+
+        return extended;
+    }
+
+    // The GE class sets the weights of the added bins after an extension
+    friend class GE;
+
     // Define output strem operator as friend
     friend std::ostream &operator<<(std::ostream &output, const Histogram &histogram);
 
@@ -147,6 +305,63 @@ private:
     DArray lnw;                      ///< The weights used for collecting the histogram.
     Count n;                         ///< The total number of observations.
     std::vector<unsigned int> shape; ///< The shape of the histogram.
+    unsigned int window_begin;       ///< The first flat index of the window of bins with counts.
+    unsigned int window_end;         ///< One past the last flat index of the window of bins with counts.
+    Count id;                        ///< The unique id of the histogram.
+
+    /// Get a new unique histogram id.
+    ///
+    /// \return The next id in the sequence of histogram ids.
+    static Count new_id() {
+        static Count next_id = 0;
+        return atomic_fetch_increment(next_id);
+    }
+
+    /// Add an observation to a bin and include the bin in the window.
+    ///
+    /// \param count The count of the bin (a reference into N).
+    inline void add_to_bin(Count &count) {
+        count++;
+        n++;
+
+        const unsigned int index = &count - N.get_array();
+        include_in_window(index, index+1);
+    }
+
+    /// Include a range of flat indices in the window.
+    ///
+    /// \param begin The first flat index of the range.
+    /// \param end One past the last flat index of the range.
+    inline void include_in_window(unsigned int begin, unsigned int end) {
+        if (begin == end)
+            return;
+
+        if (window_begin == window_end) {
+            window_begin = begin;
+            window_end = end;
+        }
+        else {
+            window_begin = std::min(window_begin, begin);
+            window_end = std::max(window_end, end);
+        }
+    }
+
+    /// Find the window of bins with counts by scanning the counts.
+    void find_window() {
+        const Count *counts = N.get_array();
+        const unsigned int size = N.get_asize();
+
+        window_begin = 0;
+        while (window_begin < size && counts[window_begin] == 0)
+            ++window_begin;
+
+        window_end = size;
+        while (window_end > window_begin && counts[window_end-1] == 0)
+            --window_end;
+
+        if (window_begin == window_end)
+            window_begin = window_end = 0;
+    }
 };
 
 /// Output stream operator for the Muninnn Histogram class.
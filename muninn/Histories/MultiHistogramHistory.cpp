@@ -22,26 +22,71 @@
 // specific prior written permission.
 
 #include <cassert>
+#include <algorithm>
 
 #include "muninn/Histories/MultiHistogramHistory.h"
 #include "muninn/common.h"
 #include "muninn/utils/utils.h"
 #include "muninn/utils/TArray.h"
-#include "muninn/utils/TArrayUtils.h"
 
 namespace Muninn {
 
 const std::string MultiHistogramHistory::history_mode_names[] = {"drop-none", "drop-oldest", "drop-oldest-possible", "drop-any-possible"};
 
 void MultiHistogramHistory::add_histogram(Histogram *histogram) {
+    add_histogram(*histogram);
+    delete histogram;
+}
+
+void MultiHistogramHistory::add_histogram(const Histogram &histogram) {
     // Check that the histogram has the correct shape
-    assert(vector_equal(histogram->get_shape(), this->shape));
+    assert(vector_equal(histogram.get_shape(), this->shape));
+
+    // The accumulated window contains the windows of the histogram and all
+    // histograms in the history
+    unsigned int accumulated_begin = histogram.get_window_begin();
+    unsigned int accumulated_end = histogram.get_window_end();
 
-    // Add the histogram to the deque
-    histograms.push_front(histogram);
+    for (std::vector<WindowedHistogram*>::const_iterator it = histograms.begin(); it != histograms.end(); ++it) {
+        if ((*it)->get_window_begin() == (*it)->get_window_end())
+            continue;
+
+        if (accumulated_begin == accumulated_end) {
+            accumulated_begin = (*it)->get_window_begin();
+            accumulated_end = (*it)->get_window_end();
+        }
+        else {
+            accumulated_begin = std::min(accumulated_begin, (*it)->get_window_begin());
+            accumulated_end = std::max(accumulated_end, (*it)->get_window_end());
+        }
+    }
+
+    // Make room for the histogram. The rows are widened to at least twice
+    // their width, but never beyond the size of the history.
+    const unsigned int window_width = histogram.get_window_end() - histogram.get_window_begin();
+    const unsigned int window_accumulated_width = accumulated_end - accumulated_begin;
+
+    if (histograms.size() == capacity || window_width > N_width || window_accumulated_width > accumulated_width) {
+        const unsigned int nbins = sum_N.get_asize();
+        const unsigned int new_capacity = (histograms.size() == capacity) ? std::max(2*capacity, memory+1) : capacity;
+        const unsigned int new_N_width = (window_width > N_width) ? std::min(std::max(2*N_width, window_width), nbins) : N_width;
+        const unsigned int new_accumulated_width = (window_accumulated_width > accumulated_width) ? std::min(std::max(2*accumulated_width, window_accumulated_width), nbins) : accumulated_width;
+        const std::vector<unsigned int> no_bins(this->shape.size(), 0);
+
+        reallocate(new_capacity, new_N_width, new_accumulated_width, no_bins, no_bins);
+    }
 
-    // Update sum_N
-    sum_N += histograms.front()->get_N();
+    // Copy the histogram to a free slot, and add it to the front of the history
+    WindowedHistogram *slot = free_slots.back();
+    free_slots.pop_back();
+    slot->assign(histogram, histograms.empty() ? NULL : histograms.front(), accumulated_begin, accumulated_end);
+    histograms.insert(histograms.begin(), slot);
+
+    // Update sum_N, where only the window of the histogram has counts
+    const Count *N = slot->get_window_N();
+    Count *sum = sum_N.get_array();
+    for (unsigned int i=slot->get_window_begin(); i<slot->get_window_end(); ++i)
+        sum[i] += N[i-slot->get_window_begin()];
 
     switch (history_mode) {
     case DROP_NONE : {}
@@ -58,15 +103,8 @@ void MultiHistogramHistory::add_histogram(Histogram *histogram) {
     case DROP_OLDEST_POSSIBLE : {
         // Check if the last histogram should be removed
         while (histograms.size() > memory) {
-            // Find the sum of N and support
-            BArray current_support = sum_N >= min_count;
-            CArray remaining_sum_N = sum_N-histograms.back()->get_N();
-            BArray remaining_support = remaining_sum_N >= min_count;
-
-            // Find the number of bins that are observed in the oldest histogram but not in the remaining
-            unsigned int overlap = number_of_true(current_support && (!remaining_support));
-
-            if (overlap==0) {
+            // Remove the oldest histogram if this does not decrease the support
+            if (is_removable(*histograms.back())) {
                 remove_last_histogram();
             }
             else {
@@ -79,24 +117,13 @@ void MultiHistogramHistory::add_histogram(Histogram *histogram) {
 
     case DROP_ANY_POSSIBLE : {
         // See if some of the oldest histograms can be deleted
-        std::deque<Histogram*>::iterator it = histograms.end()-1;
+        std::vector<WindowedHistogram*>::iterator it = histograms.end()-1;
 
         // Check if the last histogram should be removed
         while ((it-histograms.begin()) > static_cast<int>(memory)) {
-            // Find the sum of N and support
-            BArray current_support = sum_N>=min_count;
-            CArray remaining_sum_N = sum_N-(*it)->get_N();
-            BArray remaining_support = remaining_sum_N>=min_count;
-
-            // Find the number of bins that are observed in the oldest histogram but not in the remaining
-            unsigned int overlap = number_of_true(current_support && (!remaining_support));
-
-            // Delete the histogram, if there is no overlap
-            if (overlap==0) {
-                // Update sum_N and remove the histogram
-                sum_N -= (*it)->get_N();
-                delete *it;
-                it = histograms.erase(it);
+            // Delete the histogram, if this does not decrease the support
+            if (is_removable(**it)) {
+                it = erase_histogram(it);
             }
 
             // Move to the previous histogram
@@ -119,59 +146,141 @@ void MultiHistogramHistory::extend(const std::vector<unsigned int> &add_under, c
     // Called method in base class
     History::extend(add_under, add_over);
 
-    // Extend the histograms
-    for(std::deque<Histogram*>::iterator it = histograms.begin(); it != histograms.end(); it++) {
-        (*it)->extend(add_under, add_over);
-    }
+    // Extend the histograms, by moving the windows to new slabs
+    reallocate(capacity, N_width, accumulated_width, add_under, add_over);
 
     // Extend sum_N
-    sum_N = sum_N.extended(add_under, add_over);
+    sum_N.extend(add_under, add_over);
 }
 
-std::vector<const CArray*> MultiHistogramHistory::get_Ns() const {
-    std::vector<const CArray*> Ns;
-    for(std::deque<Histogram*>::const_iterator it = histograms.begin(); it != histograms.end(); it++) {
-        Ns.push_back(&((*it)->get_N()));
+std::vector<Count> MultiHistogramHistory::get_ns() const {
+    std::vector<Count> ns;
+    for(std::vector<WindowedHistogram*>::const_iterator it = histograms.begin(); it != histograms.end(); it++) {
+        ns.push_back((*it)->get_n());
     }
-    return Ns;
+    return ns;
 }
 
-std::vector<const DArray*> MultiHistogramHistory::get_lnws() const {
-    std::vector<const DArray*> lnws;
-    for(std::deque<Histogram*>::const_iterator it = histograms.begin(); it != histograms.end(); it++) {
-        lnws.push_back(&((*it)->get_lnw()));
+void MultiHistogramHistory::remove_last_histogram() {
+    // Update the sums
+    subtract_counts(histograms.size()-1);
+
+    // Remove the histogram, and free its slot
+    free_slots.push_back(histograms.back());
+    histograms.pop_back();
+}
+
+std::vector<WindowedHistogram*>::iterator MultiHistogramHistory::erase_histogram(std::vector<WindowedHistogram*>::iterator it) {
+    // Update the sums
+    subtract_counts(it - histograms.begin());
+
+    // Remove the histogram, and free its slot
+    free_slots.push_back(*it);
+    return histograms.erase(it);
+}
+
+void MultiHistogramHistory::reallocate(unsigned int new_capacity, unsigned int new_N_width, unsigned int new_accumulated_width,
+                                       const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over) {
+    const std::vector<unsigned int> &old_shape = sum_N.get_shape();
+    const bool extended = !vector_equal(old_shape, this->shape);
+
+    // In more than one dimension, the extension spreads the windows
+    if (extended) {
+        for (std::vector<WindowedHistogram*>::const_iterator it = histograms.begin(); it != histograms.end(); ++it) {
+            unsigned int begin = (*it)->get_window_begin();
+            unsigned int end = (*it)->get_window_end();
+            Histogram::extend_window(begin, end, old_shape, add_under, add_over);
+            new_N_width = std::max(new_N_width, end-begin);
+
+            begin = (*it)->get_accumulated_begin();
+            end = (*it)->get_accumulated_end();
+            Histogram::extend_window(begin, end, old_shape, add_under, add_over);
+            new_accumulated_width = std::max(new_accumulated_width, end-begin);
+        }
+    }
+
+    // Allocate the slabs and make a view for each slot
+    std::vector<Count> new_slab_N(new_capacity*new_N_width);
+    std::vector<double> new_slab_lnw(new_capacity*new_accumulated_width);
+    std::vector<Count> new_slab_accumulated_N(new_capacity*new_accumulated_width);
+    std::vector<WindowedHistogram*> slots(new_capacity);
+
+    for (unsigned int slot=0; slot<new_capacity; ++slot) {
+        slots[slot] = new WindowedHistogram(this->shape,
+                                            new_N_width>0 ? &new_slab_N[slot*new_N_width] : NULL,
+                                            new_accumulated_width>0 ? &new_slab_lnw[slot*new_accumulated_width] : NULL,
+                                            new_accumulated_width>0 ? &new_slab_accumulated_N[slot*new_accumulated_width] : NULL);
+    }
+
+    // Copy the histograms in order to the first slots
+    for (unsigned int i=0; i<histograms.size(); ++i) {
+        if (extended)
+            slots[i]->assign_extended(*histograms[i], add_under, add_over);
+        else
+            slots[i]->assign(*histograms[i]);
     }
-    return lnws;
+
+    // Replace the views, where the unused slots are taken from the back of
+    // free_slots in order
+    for (std::vector<WindowedHistogram*>::iterator it=histograms.begin(); it!=histograms.end(); ++it)
+        delete *it;
+    for (std::vector<WindowedHistogram*>::iterator it=free_slots.begin(); it!=free_slots.end(); ++it)
+        delete *it;
+
+    free_slots.clear();
+    for (unsigned int slot=new_capacity; slot>histograms.size(); --slot)
+        free_slots.push_back(slots[slot-1]);
+    histograms.assign(slots.begin(), slots.begin()+histograms.size());
+
+    slab_N.swap(new_slab_N);
+    slab_lnw.swap(new_slab_lnw);
+    slab_accumulated_N.swap(new_slab_accumulated_N);
+    capacity = new_capacity;
+    N_width = new_N_width;
+    accumulated_width = new_accumulated_width;
 }
 
-std::vector<Count> MultiHistogramHistory::get_ns() const {
-    std::vector<Count> ns;
-    for(std::deque<Histogram*>::const_iterator it = histograms.begin(); it != histograms.end(); it++) {
-        ns.push_back((*it)->get_n());
+bool MultiHistogramHistory::is_removable(const WindowedHistogram &histogram) const {
+    const Count *N = histogram.get_window_N();
+    const Count *sum = sum_N.get_array();
+    const unsigned int window_begin = histogram.get_window_begin();
+
+    // A bin loses its support if the counts of the histogram brings the sum
+    // below min_count. Bins without counts in the histogram are unaffected.
+    for (unsigned int i=window_begin; i<histogram.get_window_end(); ++i) {
+        const Count count = N[i-window_begin];
+        if (count>0 && sum[i]>=min_count && sum[i]-count<min_count)
+            return false;
     }
-    return ns;
+
+    return true;
 }
 
+void MultiHistogramHistory::subtract_counts(unsigned int i) {
+    const WindowedHistogram &histogram = *histograms[i];
+    const Count *N = histogram.get_window_N();
+    Count *sum = sum_N.get_array();
 
-void MultiHistogramHistory::remove_last_histogram() {
-    // Update sum_N
-    sum_N -= histograms.back()->get_N();
+    for (unsigned int index=histogram.get_window_begin(); index<histogram.get_window_end(); ++index)
+        sum[index] -= N[index-histogram.get_window_begin()];
 
-    // Remove the histogram
-    delete histograms.back();
-    histograms.pop_back();
+    // The newer histograms include the histogram in their accumulated counts
+    for (unsigned int j=0; j<i; ++j)
+        histograms[j]->subtract_accumulated(histogram);
 }
 
 Histogram* MultiHistogramHistory::remove_newest() {
      Histogram *newest = NULL;
 
      if (histograms.size() > 0) {
-        // Update sum_N
-        sum_N -= histograms.front()->get_N();
-
-        // Remove the histogram
-        newest = histograms.front();
-        histograms.pop_front();
+        // Update sum_N; no histograms include the newest histogram in their
+        // accumulated counts
+        subtract_counts(0);
+
+        // Remove the histogram, and return its counts and weights
+        newest = new Histogram(histograms.front()->get_dense_N(), histograms.front()->get_dense_lnw());
+        free_slots.push_back(histograms.front());
+        histograms.erase(histograms.begin());
      }
 
      return newest;
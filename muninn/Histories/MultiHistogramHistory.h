@@ -25,7 +25,6 @@
 #define MUNINN_MULTIHISTOGRAMHISTORY_H_
 
 #include <vector>
-#include <deque>
 #include <iostream>
 
 #include "muninn/common.h"
@@ -33,12 +32,22 @@
 #include "muninn/utils/TArray.h"
 #include "muninn/History.h"
 #include "muninn/Histogram.h"
+#include "muninn/Histories/WindowedHistogram.h"
 #include "muninn/utils/BaseConverter.h"
 
 namespace Muninn {
 
 /// The MultiHistogramHistory class is a history that can store multiple
 /// consecutive histograms in the memory.
+///
+/// The histograms are stored as WindowedHistogram objects, where only the
+/// window of counts and the accumulated window of each histogram are stored.
+/// The windows are stored in contiguous slabs with a row for each slot, and
+/// the histograms in the history are views of the rows. The rows are as wide
+/// as the widest window, which for a large binning is normally much narrower
+/// than the binning. The slot of a removed histogram is reused for the next
+/// added histogram, so adding and removing histograms does not allocate
+/// memory, once the slabs have room for the histograms in the memory.
 class MultiHistogramHistory : public History, public BaseConverter<History, MultiHistogramHistory>  {
 public:
     /// Define the modes for handling the history with respected to deletion of
@@ -61,35 +70,49 @@ public:
     /// \param min_count The minimal number of counts for a bin to have support.
     /// \param history_mode Describes the procedure for deleting old histograms.
     MultiHistogramHistory(const std::vector<unsigned int> &shape, unsigned int memory, Count min_count, HistoryMode history_mode) :
-        History(shape), memory(memory), min_count(min_count), history_mode(history_mode), sum_N(shape) {}
+        History(shape), memory(memory), min_count(min_count), history_mode(history_mode),
+        capacity(0), N_width(0), accumulated_width(0), sum_N(shape) {}
 
     /// Destructor.
     virtual ~MultiHistogramHistory() {
-        for (std::deque<Histogram*>::iterator it=histograms.begin(); it!=histograms.end(); ++it) {
+        for (std::vector<WindowedHistogram*>::iterator it=histograms.begin(); it!=histograms.end(); ++it) {
+            delete *it;
+        }
+        for (std::vector<WindowedHistogram*>::iterator it=free_slots.begin(); it!=free_slots.end(); ++it) {
             delete *it;
         }
     }
 
-    /// Function for adding a histogram to the history. The histogram is
-    /// always added to the front of the internal deque
-    /// MultiHistogramHistory::histograms.
+    /// Function for adding a histogram to the history. The windows of the
+    /// histogram are copied to a free slot, and the histogram is deleted.
     ///
     /// Note that the History takes ownership of the passed histogram.
     ///
     /// \param histogram The histogram to be added.
     virtual void add_histogram(Histogram *histogram);
 
+    /// Function for adding a copy of a histogram to the history. The
+    /// histogram is always added to the front of the history, and the copy
+    /// keeps the id of the histogram (see Histogram::get_id).
+    ///
+    /// Only the weights in the accumulated window are kept, which is the
+    /// smallest window containing the windows of the histogram and all
+    /// histograms in the history.
+    ///
+    /// \param histogram The histogram to be added.
+    virtual void add_histogram(const Histogram &histogram);
+
     /// Function for extending the shape of the History. When this functions is
-    /// called all histograms in the internal deque MultiHistogramHistory::histograms
-    /// are extended, which makes the function rather expensive.
+    /// called the windows of all histograms are copied to new slabs.
     ///
     /// \param add_under The number of bins to be added leftmost in all dimensions.
     /// \param add_over The number of bins to be added rightmost in all dimensions.
     virtual void extend(const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over);
 
-    /// Remove and returns newest histogram from the history. In this case, the
-    /// histogram in front of the internal deque MultiHistogramHistory::histograms
-    /// is removed.
+    /// Remove and returns newest histogram from the history. The returned
+    /// histogram is a new Histogram with the counts of the histogram in front
+    /// of the history. Only the weights in the accumulated window are kept,
+    /// and the other weights are zero.
     ///
     /// Note that ownership is passed along with the histogram.
     ///
@@ -98,12 +121,13 @@ public:
 
     /// This function overloads the []-operator and gives access to the
     /// individual histograms. The function is safe in the sense, that it uses
-    /// the deque function std::deque::at, which throws a out_of_range
-    /// exception, if the the index is out of range.
+    /// the vector function std::vector::at, which throws a out_of_range
+    /// exception, if the the index is out of range. The returned histogram is
+    /// a view into the slabs, which is valid until the history is changed.
     ///
     /// \param i The index of the histogram to access.
     /// \return The i'th histogram.
-    inline const Histogram& operator[](unsigned int i) const {return *histograms.at(i);}
+    inline const WindowedHistogram& operator[](unsigned int i) const {return *histograms.at(i);}
 
     /// Function for getting the sum of counts in each bin, called the sum
     /// histogram. The returned array has the same shape as the individual
@@ -119,19 +143,25 @@ public:
     /// \return The sum histogram.
     inline const CArray& get_sum_N() const {return sum_N;}
 
-    /// Get a vector containing pointer to the individual count arrays from the
-    /// list of histograms. Note that a new vector constructed each time the
-    /// function is called.
+    /// Get the accumulated number of counts in a bin for the i'th histogram,
+    /// which is the sum of counts in the bin for the i'th histogram and all
+    /// older histograms in the history
     ///
-    /// \return A vector of pointer to count arrays.
-    std::vector<const CArray*> get_Ns() const;
-
-    /// Get a vector containing pointer to the individual weight arrays from
-    /// the list of histograms. Note that a new vector constructed each time
-    /// the function is called.
+    /// \f[
+    ///  \mathrm{accumulated\_N}_i[x] = \sum_{j \geq i} N_j[x].
+    /// \f]
     ///
-    /// \return A vector of pointer to weight arrays.
-    std::vector<const DArray*> get_lnws() const;
+    /// The accumulated counts are stored with each histogram in its
+    /// accumulated window (see WindowedHistogram::get_accumulated_N), and
+    /// they are updated when histograms are added or removed, so the function
+    /// does not iterate over the histograms.
+    ///
+    /// \param i The index of the histogram in the history.
+    /// \param index The flat index of the bin.
+    /// \return The accumulated number of counts in the bin.
+    inline Count get_accumulated_N(unsigned int i, unsigned int index) const {
+        return histograms[i]->get_accumulated_N(index);
+    }
 
     /// Get a vector containing the sum of counts in the individual histograms.
     /// Note that a new vector constructed each time the function is called, but
@@ -153,16 +183,16 @@ public:
     virtual void add_statistics_to_log(StatisticsLogger& statistics_logger) const;
 
     /// Type of forward iterator for the MultiHistogramHistory.
-    typedef std::deque<Histogram*>::iterator iterator;
+    typedef std::vector<WindowedHistogram*>::iterator iterator;
 
     /// Type of constant forward iterator for the MultiHistogramHistory.
-    typedef std::deque<Histogram*>::const_iterator const_iterator;
+    typedef std::vector<WindowedHistogram*>::const_iterator const_iterator;
 
     /// Type of reverse iterator for the MultiHistogramHistory.
-    typedef std::deque<Histogram*>::reverse_iterator reverse_iterator;
+    typedef std::vector<WindowedHistogram*>::reverse_iterator reverse_iterator;
 
     /// Type of reverse iterator for the MultiHistogramHistory.
-    typedef std::deque<Histogram*>::const_reverse_iterator const_reverse_iterator;
+    typedef std::vector<WindowedHistogram*>::const_reverse_iterator const_reverse_iterator;
 
     /// \return Forward iterator pointing to the first element in the history.
     inline iterator begin() {return histograms.begin();}
@@ -196,11 +226,53 @@ private:
     const unsigned int memory;          ///< The maximal length of the history.
     const Count min_count;              ///< The minimal number of counts is used to determine if the last histogram should be removed.
     const HistoryMode history_mode;     ///< The mode for removing histograms from the history.
-    std::deque<Histogram*> histograms;  ///< The histograms in the history.
-    CArray sum_N;                       ///< The sum of counts in each bin across all histograms.
+    std::vector<WindowedHistogram*> histograms; ///< Views of the histograms in the history, with the newest histogram first.
+    std::vector<WindowedHistogram*> free_slots; ///< Views of the slots not used by a histogram in the history.
+    std::vector<Count> slab_N;                  ///< The counts in the windows of the histograms, with a row for each slot.
+    std::vector<double> slab_lnw;               ///< The weights in the accumulated windows of the histograms, with a row for each slot.
+    std::vector<Count> slab_accumulated_N;      ///< The accumulated counts in the accumulated windows of the histograms, with a row for each slot.
+    unsigned int capacity;                      ///< The number of slots allocated in the slabs.
+    unsigned int N_width;                       ///< The length of the rows in slab_N.
+    unsigned int accumulated_width;             ///< The length of the rows in slab_lnw and slab_accumulated_N.
+    CArray sum_N;                               ///< The sum of counts in each bin across all histograms.
+
+    /// Erase a histogram from the history and update the sums.
+    ///
+    /// \param it An iterator pointing to the histogram to erase.
+    /// \return An iterator pointing to the histogram following the erased histogram.
+    std::vector<WindowedHistogram*>::iterator erase_histogram(std::vector<WindowedHistogram*>::iterator it);
 
     /// Removed the last (oldest) histogram from the history.
     void remove_last_histogram();
+
+    /// Move the histograms to newly allocated slabs, where the histograms are
+    /// placed in order in the first slots. The shape of the history must
+    /// already be set to the shape of the new slabs. The rows are made wider
+    /// if needed for the extended windows of the histograms.
+    ///
+    /// \param new_capacity The number of slots to allocate.
+    /// \param new_N_width The minimal length of the rows in slab_N.
+    /// \param new_accumulated_width The minimal length of the rows in slab_lnw and slab_accumulated_N.
+    /// \param add_under The number of bins added leftmost in all dimensions since the slabs were allocated.
+    /// \param add_over The number of bins added rightmost in all dimensions since the slabs were allocated.
+    void reallocate(unsigned int new_capacity, unsigned int new_N_width, unsigned int new_accumulated_width,
+                    const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over);
+
+    /// Determine if a histogram in the history can be removed without
+    /// decreasing the support, that is without any bin in sum_N dropping
+    /// below min_count. Only the counts of the histogram are visited, and the
+    /// check stops at the first bin that would lose its support.
+    ///
+    /// \param histogram A histogram in the history.
+    /// \return True if the histogram can be removed.
+    bool is_removable(const WindowedHistogram &histogram) const;
+
+    /// Remove the counts of a histogram from sum_N and from the accumulated
+    /// counts of the newer histograms. Only the window of the histogram is
+    /// visited.
+    ///
+    /// \param i The index of the histogram in the history.
+    void subtract_counts(unsigned int i);
 };
 
 /// Input operator for MultiHistogramHistory::HistoryMode.
@@ -0,0 +1,311 @@
+// WindowedHistogram.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_WINDOWEDHISTOGRAM_H_
+#define MUNINN_WINDOWEDHISTOGRAM_H_
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "muninn/common.h"
+#include "muninn/Histogram.h"
+#include "muninn/utils/TArray.h"
+#include "muninn/utils/utils.h"
+#include "muninn/utils/StatisticsLogger.h"
+
+namespace Muninn {
+
+/// The WindowedHistogram class is the form in which the
+/// MultiHistogramHistory stores a histogram. Only the counts in the window
+/// [get_window_begin(), get_window_end()) are stored, and the counts outside
+/// the window are implicitly zero.
+///
+/// The weights are stored in the accumulated window
+/// [get_accumulated_begin(), get_accumulated_end()), which contains the
+/// window of the histogram and the windows of all older histograms in the
+/// history. This covers the bins where the estimators use the weights of the
+/// histogram. In the same window, the histogram stores the accumulated
+/// counts, that is the sum of counts for this and all older histograms in
+/// the history.
+///
+/// The histogram is a view into storage owned by the history, which must
+/// have room for the windows.
+class WindowedHistogram {
+public:
+
+    /// Constructor for an empty histogram.
+    ///
+    /// \param shape The shape of the histogram.
+    /// \param N_storage The storage for the counts in the window.
+    /// \param lnw_storage The storage for the weights in the accumulated window.
+    /// \param accumulated_N_storage The storage for the accumulated counts in the accumulated window.
+    WindowedHistogram(const std::vector<unsigned int> &shape, Count *N_storage, double *lnw_storage, Count *accumulated_N_storage) :
+        N(N_storage), lnw(lnw_storage), accumulated_N(accumulated_N_storage), n(0), id(0), shape(shape),
+        window_begin(0), window_end(0), accumulated_begin(0), accumulated_end(0) {}
+
+    /// Store a histogram, which becomes newer than a given histogram. The id
+    /// of the histogram is kept.
+    ///
+    /// \param histogram The histogram to store.
+    /// \param older The newest of the older histograms, or NULL if there are none.
+    /// \param accumulated_begin The first flat index of the accumulated window.
+    /// \param accumulated_end One past the last flat index of the accumulated window.
+    void assign(const Histogram &histogram, const WindowedHistogram *older, unsigned int accumulated_begin, unsigned int accumulated_end) {
+        assert(histogram.get_window_begin()==histogram.get_window_end() ||
+               (accumulated_begin<=histogram.get_window_begin() && histogram.get_window_end()<=accumulated_end));
+
+        n = histogram.get_n();
+        id = histogram.get_id();
+        window_begin = histogram.get_window_begin();
+        window_end = histogram.get_window_end();
+        this->accumulated_begin = accumulated_begin;
+        this->accumulated_end = accumulated_end;
+
+        const Count *histogram_N = histogram.get_N().get_array();
+        const double *histogram_lnw = histogram.get_lnw().get_array();
+
+        std::copy(histogram_N+window_begin, histogram_N+window_end, N);
+        std::copy(histogram_lnw+accumulated_begin, histogram_lnw+accumulated_end, lnw);
+
+        for (unsigned int index=accumulated_begin; index<accumulated_end; ++index) {
+            accumulated_N[index-accumulated_begin] = (older==NULL ? 0 : older->get_accumulated_N(index)) + get_N(index);
+        }
+    }
+
+    /// Store a copy of another histogram with the same shape, including the
+    /// id of the histogram.
+    ///
+    /// \param other The histogram to copy.
+    void assign(const WindowedHistogram &other) {
+        assert(vector_equal(shape, other.shape));
+
+        n = other.n;
+        id = other.id;
+        window_begin = other.window_begin;
+        window_end = other.window_end;
+        accumulated_begin = other.accumulated_begin;
+        accumulated_end = other.accumulated_end;
+
+        std::copy(other.N, other.N+(window_end-window_begin), N);
+        std::copy(other.lnw, other.lnw+(accumulated_end-accumulated_begin), lnw);
+        std::copy(other.accumulated_N, other.accumulated_N+(accumulated_end-accumulated_begin), accumulated_N);
+    }
+
+    /// Store an extended copy of another histogram, including the id of the
+    /// histogram. The shape of this histogram must be the extended shape.
+    /// Only the windows are visited, and the added bins that fall inside the
+    /// windows get zero counts and zero weights.
+    ///
+    /// \param other The histogram to copy.
+    /// \param add_under The number of bins added leftmost in all dimensions.
+    /// \param add_over The number of bins added rightmost in all dimensions.
+    void assign_extended(const WindowedHistogram &other, const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over) {
+        n = other.n;
+        id = other.id;
+        window_begin = other.window_begin;
+        window_end = other.window_end;
+        accumulated_begin = other.accumulated_begin;
+        accumulated_end = other.accumulated_end;
+        Histogram::extend_window(window_begin, window_end, other.shape, add_under, add_over);
+        Histogram::extend_window(accumulated_begin, accumulated_end, other.shape, add_under, add_over);
+
+        std::fill(N, N+(window_end-window_begin), 0);
+        std::fill(lnw, lnw+(accumulated_end-accumulated_begin), 0.0);
+        std::fill(accumulated_N, accumulated_N+(accumulated_end-accumulated_begin), 0);
+
+        for (unsigned int index=other.window_begin; index<other.window_end; ++index) {
+            N[Histogram::extended_index(index, other.shape, add_under, add_over)-window_begin] = other.N[index-other.window_begin];
+        }
+
+        for (unsigned int index=other.accumulated_begin; index<other.accumulated_end; ++index) {
+            const unsigned int extended = Histogram::extended_index(index, other.shape, add_under, add_over)-accumulated_begin;
+            lnw[extended] = other.lnw[index-other.accumulated_begin];
+            accumulated_N[extended] = other.accumulated_N[index-other.accumulated_begin];
+        }
+    }
+
+    /// Remove the counts of an older histogram from the accumulated counts.
+    /// Only the window of the older histogram is visited.
+    ///
+    /// \param older The older histogram, which is removed from the history.
+    void subtract_accumulated(const WindowedHistogram &older) {
+        assert(older.window_begin==older.window_end ||
+               (accumulated_begin<=older.window_begin && older.window_end<=accumulated_end));
+
+        for (unsigned int index=older.window_begin; index<older.window_end; ++index)
+            accumulated_N[index-accumulated_begin] -= older.N[index-older.window_begin];
+    }
+
+    /// Get the number of counts in a bin.
+    ///
+    /// \param index The flat index of the bin.
+    /// \return The number of counts in the bin, which is zero outside the window.
+    inline Count get_N(unsigned int index) const {
+        return (window_begin<=index && index<window_end) ? N[index-window_begin] : 0;
+    }
+
+    /// Get the number of counts in a bin.
+    ///
+    /// \param bin The multidimensional index of the bin.
+    /// \return The number of counts in the bin, which is zero outside the window.
+    inline Count get_N(const std::vector<unsigned int> &bin) const {
+        return get_N(flat_index(bin));
+    }
+
+    /// Get the counts in the window, where the i'th element is the number of
+    /// counts in the bin with flat index get_window_begin()+i.
+    ///
+    /// \return A pointer to the counts in the window.
+    inline const Count *get_window_N() const {return N;}
+
+    /// Get the weight used for collecting the histogram in a bin in the
+    /// accumulated window.
+    ///
+    /// \param index The flat index of the bin.
+    /// \return The weight in the bin.
+    inline double get_lnw(unsigned int index) const {
+        assert(accumulated_begin<=index && index<accumulated_end);
+        return lnw[index-accumulated_begin];
+    }
+
+    /// Get the weight used for collecting the histogram in a bin in the
+    /// accumulated window.
+    ///
+    /// \param bin The multidimensional index of the bin.
+    /// \return The weight in the bin.
+    inline double get_lnw(const std::vector<unsigned int> &bin) const {
+        return get_lnw(flat_index(bin));
+    }
+
+    /// Get the weights in the accumulated window, where the i'th element is
+    /// the weight in the bin with flat index get_accumulated_begin()+i.
+    ///
+    /// \return A pointer to the weights in the accumulated window.
+    inline const double *get_window_lnw() const {return lnw;}
+
+    /// Get the accumulated number of counts in a bin, which is the sum of
+    /// counts in the bin for this and all older histograms in the history.
+    ///
+    /// \param index The flat index of the bin.
+    /// \return The accumulated number of counts, which is zero outside the accumulated window.
+    inline Count get_accumulated_N(unsigned int index) const {
+        return (accumulated_begin<=index && index<accumulated_end) ? accumulated_N[index-accumulated_begin] : 0;
+    }
+
+    /// Get the counts as an array over the full shape of the histogram.
+    ///
+    /// \return The counts.
+    CArray get_dense_N() const {
+        CArray dense(shape);
+        std::copy(N, N+(window_end-window_begin), dense.get_array()+window_begin);
+        return dense;
+    }
+
+    /// Get the weights as an array over the full shape of the histogram,
+    /// where the weights outside the accumulated window are zero.
+    ///
+    /// \return The weights.
+    DArray get_dense_lnw() const {
+        DArray dense(shape);
+        std::copy(lnw, lnw+(accumulated_end-accumulated_begin), dense.get_array()+accumulated_begin);
+        return dense;
+    }
+
+    /// Getter for the total number of counts collected in the histogram.
+    ///
+    /// \return The total number of counts collected in the histogram.
+    inline Count get_n() const {return n;}
+
+    /// Get the unique id of the histogram (see Histogram::get_id).
+    ///
+    /// \return The id of the histogram.
+    inline Count get_id() const {return id;}
+
+    /// Get the shape of the histogram.
+    ///
+    /// \return The shape of the histogram.
+    inline const std::vector<unsigned int>& get_shape() const {return shape;}
+
+    /// Get the first flat index of the window of bins with counts.
+    ///
+    /// \return The first flat index of the window.
+    inline unsigned int get_window_begin() const {return window_begin;}
+
+    /// Get one past the last flat index of the window of bins with counts.
+    ///
+    /// \return One past the last flat index of the window.
+    inline unsigned int get_window_end() const {return window_end;}
+
+    /// Get the first flat index of the accumulated window.
+    ///
+    /// \return The first flat index of the accumulated window.
+    inline unsigned int get_accumulated_begin() const {return accumulated_begin;}
+
+    /// Get one past the last flat index of the accumulated window.
+    ///
+    /// \return One past the last flat index of the accumulated window.
+    inline unsigned int get_accumulated_end() const {return accumulated_end;}
+
+    /// Add an entries to the statistics log. The entries are the same as for
+    /// a Histogram, with zero weights outside the accumulated window.
+    ///
+    /// \param statistics_logger The logger to add an entry to.
+    void add_statistics_to_log(StatisticsLogger& statistics_logger) const {
+        statistics_logger.add_entry("N", get_dense_N());
+        statistics_logger.add_entry("lnw", get_dense_lnw());
+    }
+
+private:
+    Count *N;                        ///< The counts in the window.
+    double *lnw;                     ///< The weights in the accumulated window.
+    Count *accumulated_N;            ///< The accumulated counts in the accumulated window.
+    Count n;                         ///< The total number of observations.
+    Count id;                        ///< The id of the stored histogram.
+    std::vector<unsigned int> shape; ///< The shape of the histogram.
+    unsigned int window_begin;       ///< The first flat index of the window of bins with counts.
+    unsigned int window_end;         ///< One past the last flat index of the window of bins with counts.
+    unsigned int accumulated_begin;  ///< The first flat index of the accumulated window.
+    unsigned int accumulated_end;    ///< One past the last flat index of the accumulated window.
+
+    /// Get the flat index of a bin.
+    ///
+    /// \param bin The multidimensional index of the bin.
+    /// \return The flat index of the bin.
+    unsigned int flat_index(const std::vector<unsigned int> &bin) const {
+        assert(bin.size()==shape.size());
+
+        unsigned int index = 0;
+        unsigned int stride = 1;
+        for (unsigned int dim=0; dim<shape.size(); ++dim) {
+            index += bin[dim]*stride;
+            stride *= shape[dim];
+        }
+        return index;
+    }
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_WINDOWEDHISTOGRAM_H_ */
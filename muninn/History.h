@@ -48,6 +48,14 @@ public:
     /// \param histogram The histogram to be added.
     virtual void add_histogram(Histogram *histogram) = 0;
 
+    /// Function for adding a copy of a histogram to the history. The caller
+    /// keeps the passed histogram, which can be reused afterwards.
+    ///
+    /// \param histogram The histogram to be added.
+    virtual void add_histogram(const Histogram &histogram) {
+        add_histogram(new Histogram(histogram));
+    }
+
     /// Function for extending the shape of the History.
     ///
     /// \param add_under The number of bins to be added leftmost in all dimensions.
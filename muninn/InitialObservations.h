@@ -0,0 +1,402 @@
+// InitialObservations.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_INITIALOBSERVATIONS_H_
+#define MUNINN_INITIALOBSERVATIONS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "muninn/common.h"
+#include "muninn/utils/P2QuantileEstimator.h"
+
+namespace Muninn {
+
+/// A collection of the energies observed for the initial histogram, which
+/// is used for initializing the binner. The collection uses bounded memory,
+/// independently of the number of observations. The first energies are
+/// stored in a raw buffer, and as long as all observations are buffered the
+/// collection gives exactly the same fractiles and bins as the full list of
+/// energies. When the buffer is full, the energies are instead counted in a
+/// fine uniform grid, and the fractiles are estimated by streaming P-square
+/// estimators (see P2QuantileEstimator). The grid has a bounded number of
+/// bins; it is extended when an energy falls outside it, and coarsened by a
+/// factor of two if it otherwise would exceed the maximal number of bins.
+///
+/// The minimal and maximal energy are always exact.
+///
+/// Collections can be merged (see merge()), which allows e.g. several walkers
+/// to collect observations independently in bounded memory.
+class InitialObservations {
+public:
+    /// Constructor.
+    ///
+    /// \param buffer_size The maximal number of energies in the raw buffer.
+    /// \param max_grid_bins The maximal number of bins in the grid used when
+    ///                      the buffer is full.
+    InitialObservations(size_t buffer_size=65536, size_t max_grid_bins=65536) :
+        buffer_size(buffer_size), max_grid_bins(max_grid_bins), n(0), nonfinite(0), min(0.0), max(0.0),
+        lower_estimator(0.1586553), upper_estimator(0.8413447), grid_origin(0.0), grid_width(0.0), fractiles_from_grid(false) {
+        assert(max_grid_bins >= 16);
+    }
+
+    /// Add an observed energy.
+    ///
+    /// \param energy The energy to add.
+    inline void add(double energy) {
+        // Non finite energies are only counted
+        if (!std::isfinite(energy)) {
+            ++n;
+            ++nonfinite;
+            return;
+        }
+
+        include_in_range(energy, energy);
+        ++n;
+        record(energy);
+    }
+
+    /// Add the observations of another collection. If the other collection
+    /// has all its energies buffered, these are added one by one, which is
+    /// equivalent to adding them by add(). Otherwise, the counts of the grid
+    /// of the other collection are added to the grid of this collection,
+    /// and from then on the fractiles are found from the grid, since the
+    /// streaming estimators cannot be merged.
+    ///
+    /// \param other The collection to add the observations of.
+    void merge(const InitialObservations &other) {
+        if (other.n == other.nonfinite) {
+            n += other.n;
+            nonfinite += other.nonfinite;
+            return;
+        }
+
+        include_in_range(other.min, other.max);
+        n += other.n;
+        nonfinite += other.nonfinite;
+
+        if (other.is_buffered()) {
+            for (std::vector<double>::const_iterator it=other.buffer.begin(); it!=other.buffer.end(); ++it)
+                record(*it);
+        }
+        else {
+            if (grid.empty())
+                setup_grid();
+
+            for (size_t i=0; i<other.grid.size(); ++i) {
+                if (other.grid[i] > 0)
+                    add_to_grid(other.get_grid_energy(i), other.grid[i]);
+            }
+
+            fractiles_from_grid = true;
+        }
+    }
+
+    /// Remove all observations and release the memory used.
+    void clear() {
+        n = 0;
+        nonfinite = 0;
+        min = 0.0;
+        max = 0.0;
+        lower_estimator = P2QuantileEstimator(0.1586553);
+        upper_estimator = P2QuantileEstimator(0.8413447);
+        std::vector<double>().swap(buffer);
+        std::vector<Count>().swap(grid);
+        grid_origin = 0.0;
+        grid_width = 0.0;
+        fractiles_from_grid = false;
+    }
+
+    /// Get the number of observations, including non finite energies.
+    ///
+    /// \return The number of observations.
+    inline Count get_n() const {
+        return n;
+    }
+
+    /// Check whether a non finite energy has been observed. Non finite
+    /// energies are counted, but are otherwise ignored.
+    ///
+    /// \return True if a non finite energy has been observed.
+    inline bool has_nonfinite() const {
+        return nonfinite > 0;
+    }
+
+    /// Get the minimal finite energy observed.
+    ///
+    /// \return The minimal energy.
+    inline double get_min() const {
+        assert(n > nonfinite);
+        return min;
+    }
+
+    /// Get the maximal finite energy observed.
+    ///
+    /// \return The maximal energy.
+    inline double get_max() const {
+        assert(n > nonfinite);
+        return max;
+    }
+
+    /// Get the 15.9% and 84.1% fractiles of the energies, which correspond
+    /// to +/- one standard deviation for a normal distribution. If all
+    /// observations are buffered, the fractiles are exact and calculated as
+    /// in calculate_fractiles() (but using a partial sort, which may reorder
+    /// the buffer); otherwise they are estimated, either by the streaming
+    /// estimators or, if a grid has been merged into the collection, from the
+    /// grid.
+    ///
+    /// \param lower The lower (15.9%) fractile is returned in this variable.
+    /// \param upper The upper (84.1%) fractile is returned in this variable.
+    void get_fractiles(double &lower, double &upper) {
+        assert(n > nonfinite);
+
+        if (is_buffered()) {
+            std::vector<double>::iterator lower_it = buffer.begin() + static_cast<size_t>(0.1586553*buffer.size());
+            std::vector<double>::iterator upper_it = buffer.begin() + static_cast<size_t>(0.8413447*buffer.size());
+
+            std::nth_element(buffer.begin(), upper_it, buffer.end());
+            std::nth_element(buffer.begin(), lower_it, upper_it);
+            lower = *lower_it;
+            upper = *upper_it;
+        }
+        else if (fractiles_from_grid) {
+            lower = grid_fractile(0.1586553);
+            upper = grid_fractile(0.8413447);
+        }
+        else {
+            lower = lower_estimator.get_quantile();
+            upper = upper_estimator.get_quantile();
+        }
+    }
+
+    /// Check whether all finite energies are stored in the raw buffer.
+    ///
+    /// \return True if all finite energies are buffered.
+    inline bool is_buffered() const {
+        return grid.empty();
+    }
+
+    /// Get the raw buffer of energies.
+    ///
+    /// \return The buffered energies.
+    inline const std::vector<double> &get_buffer() const {
+        return buffer;
+    }
+
+    /// Get the number of bins in the grid of counted energies, which is zero
+    /// as long as all energies are buffered.
+    ///
+    /// \return The number of bins in the grid.
+    inline size_t get_grid_size() const {
+        return grid.size();
+    }
+
+    /// Get the number of energies counted in a bin of the grid.
+    ///
+    /// \param i The index of the bin in the grid.
+    /// \return The number of energies.
+    inline Count get_grid_count(size_t i) const {
+        return grid[i];
+    }
+
+    /// Get the energy representing a bin of the grid, which is the center of
+    /// the bin limited to the range of the observed energies.
+    ///
+    /// \param i The index of the bin in the grid.
+    /// \return The energy of the bin.
+    inline double get_grid_energy(size_t i) const {
+        double center = grid_origin + (i+0.5)*grid_width;
+        return std::min(std::max(center, min), max);
+    }
+
+private:
+    size_t buffer_size;                  ///< The maximal number of energies in the buffer.
+    size_t max_grid_bins;                ///< The maximal number of bins in the grid.
+
+    Count n;                             ///< The number of observations.
+    Count nonfinite;                     ///< The number of non finite energies observed.
+    double min;                          ///< The minimal finite energy.
+    double max;                          ///< The maximal finite energy.
+
+    P2QuantileEstimator lower_estimator; ///< Estimator for the lower fractile.
+    P2QuantileEstimator upper_estimator; ///< Estimator for the upper fractile.
+
+    std::vector<double> buffer;          ///< The raw buffer of energies.
+
+    std::vector<Count> grid;             ///< The counts in the grid, which is used when the buffer is full.
+    double grid_origin;                  ///< The lower edge of the grid.
+    double grid_width;                   ///< The width of the bins in the grid.
+    bool fractiles_from_grid;            ///< Whether the fractiles are found from the grid instead of the streaming estimators, which is the case when a grid has been merged.
+
+    /// Include a range of finite energies in the range of observed energies.
+    /// Must be called before the number of observations is updated.
+    ///
+    /// \param lower The lower end of the range.
+    /// \param upper The upper end of the range.
+    inline void include_in_range(double lower, double upper) {
+        if (n == nonfinite) {
+            min = lower;
+            max = upper;
+        }
+        else {
+            min = std::min(min, lower);
+            max = std::max(max, upper);
+        }
+    }
+
+    /// Record a finite energy in the estimators and in either the buffer or
+    /// the grid. The range and the number of observations are not updated.
+    ///
+    /// \param energy The energy to record.
+    inline void record(double energy) {
+        lower_estimator.add(energy);
+        upper_estimator.add(energy);
+
+        if (grid.empty()) {
+            if (buffer.size() < buffer_size) {
+                buffer.push_back(energy);
+                return;
+            }
+            setup_grid();
+        }
+
+        add_to_grid(energy);
+    }
+
+    /// Find a fractile from the counts in the grid. The fractile is the
+    /// energy of the grid bin holding the energy, which would be found at
+    /// the position given by the fractile in the sorted list of energies.
+    ///
+    /// \param p The fractile (between 0 and 1).
+    /// \return The energy of the fractile.
+    double grid_fractile(double p) const {
+        Count rank = static_cast<Count>(p*(n-nonfinite));
+        Count cumulative = 0;
+
+        for (size_t i=0; i<grid.size(); ++i) {
+            cumulative += grid[i];
+            if (cumulative > rank)
+                return get_grid_energy(i);
+        }
+
+        return max;
+    }
+
+    /// Setup the grid when the buffer is full, and move the buffered energies
+    /// to the grid. The range of the energies observed so far is initially
+    /// covered by a quarter of the maximal number of bins.
+    void setup_grid() {
+        grid_width = (max-min) / (max_grid_bins/4);
+        if (!(grid_width > 0.0))
+            grid_width = std::max(std::abs(min), 1.0) * 1E-6;
+
+        grid_origin = min;
+        grid.assign(static_cast<size_t>((max-min)/grid_width) + 1, 0);
+
+        for (std::vector<double>::const_iterator it=buffer.begin(); it!=buffer.end(); ++it)
+            add_to_grid(*it);
+
+        std::vector<double>().swap(buffer);
+    }
+
+    /// Count an energy in the grid, extending the grid if required.
+    ///
+    /// \param energy The energy to count.
+    /// \param count The number of times to count the energy.
+    inline void add_to_grid(double energy, Count count=1) {
+        double position = std::floor((energy-grid_origin)/grid_width);
+
+        if (position < 0.0 || position >= grid.size()) {
+            include_in_grid(energy);
+            position = std::floor((energy-grid_origin)/grid_width);
+        }
+
+        // Guard against rounding at the edges of the grid
+        size_t index = static_cast<size_t>(std::max(position, 0.0));
+        grid[std::min(index, grid.size()-1)] += count;
+    }
+
+    /// Extend the grid to include an energy. The grid is padded by up to its
+    /// current size, so that repeated extensions take amortized constant
+    /// time, and is coarsened if the energy cannot otherwise be included.
+    ///
+    /// \param energy The energy that should be included in the grid.
+    void include_in_grid(double energy) {
+        // Coarsen the grid until the energy can be included
+        for (;;) {
+            double lower = std::min(grid_origin, energy);
+            double upper = std::max(grid_origin + grid.size()*grid_width, energy);
+
+            if ((upper-lower)/grid_width + 2 <= max_grid_bins)
+                break;
+
+            coarsen_grid();
+        }
+
+        // Extend the grid on the relevant side
+        double position = std::floor((energy-grid_origin)/grid_width);
+        size_t size = grid.size();
+
+        if (position < 0.0) {
+            size_t needed = static_cast<size_t>(-position);
+            size_t added = needed + padding(size+needed);
+            grid.insert(grid.begin(), added, 0);
+            grid_origin -= added*grid_width;
+        }
+        else if (position >= size) {
+            size_t needed = static_cast<size_t>(position) - size + 1;
+            size_t added = needed + padding(size+needed);
+            grid.resize(size+added, 0);
+        }
+    }
+
+    /// Get the padding used when extending the grid.
+    ///
+    /// \param size The size of the grid including the bins that are needed.
+    /// \return The number of bins to pad with.
+    inline size_t padding(size_t size) const {
+        return (size < max_grid_bins) ? std::min(grid.size(), max_grid_bins-size) : 0;
+    }
+
+    /// Coarsen the grid by merging pairs of neighbouring bins.
+    void coarsen_grid() {
+        size_t size = (grid.size()+1)/2;
+
+        for (size_t i=0; i<size; ++i) {
+            grid[i] = grid[2*i];
+            if (2*i+1 < grid.size())
+                grid[i] += grid[2*i+1];
+        }
+
+        grid.resize(size);
+        grid_width *= 2.0;
+    }
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_INITIALOBSERVATIONS_H_ */
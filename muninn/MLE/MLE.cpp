@@ -22,17 +22,19 @@
 // specific prior written permission.
 
 #include <limits>
+#include <map>
 
 #include "muninn/MLE/MLE.h"
 #include "muninn/utils/TArrayUtils.h"
 #include "muninn/utils/TArrayMath.h"
 #include "muninn/utils/nonlinear/NonlinearEquation.h"
 #include "muninn/utils/nonlinear/newton.h"
+#include "muninn/utils/nonlinear/lbfgs.h"
 
-#include "muninn/utils/polation/SupportBoundaries.h"
 #include "muninn/utils/polation/AverageSlope.h"
 #include "muninn/utils/polation/AverageSlope1dUniform.h"
 
+#include "utils/PackedHistory.h"
 #include "utils/GMHequations.h"
 #include "utils/GMHequationsAccumulated.h"
 
@@ -61,19 +63,18 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
     else {
         // Calculate the total number of counts in each histogram, but only where we have support
         CArray support_n(history.get_size());
-        for (unsigned int set=0; set<history.get_size(); set++)
-            support_n(set) = history[set].get_N().sum(lnG_support);
+        calc_support_n(history, lnG_support, support_n);
 
         // Make an array of free energies from the free energies in the previous estimate
         DArray free_energies(history.get_size());
+        std::vector<unsigned int> missing_sets;
 
         for (unsigned int set=0; set<history.get_size(); set++) {
-            if (estimate.free_energies.count(&history[set]) > 0) {
-                free_energies(set) = estimate.free_energies[&history[set]];
+            if (estimate.free_energies.count(history[set].get_id()) > 0) {
+                free_energies(set) = estimate.free_energies[history[set].get_id()];
             }
             else if (set > 0) {
-                // TODO: Do something if the free energy hasn't previous been estimated?
-                MessageLogger::get().warning("Missing previous MLE entropy for histogram number " + to_string<unsigned int>(set) + " in the history.");
+                missing_sets.push_back(set);
             }
         }
 
@@ -89,13 +90,23 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
         }
 
         // Calculate the initial free energy estimate
-        free_energies(0) = initial_free_energy_estimate(history, estimate.get_lnG(), sum_N, support_n, estimate.get_x0());
+        free_energies(0) = initial_free_energy_estimate(history, 0, estimate.get_lnG(), sum_N, support_n, estimate.get_x0());
+
+        // Predict the free energies of older histograms, which has not previously been estimated, from the previous entropy
+        for (std::vector<unsigned int>::const_iterator set=missing_sets.begin(); set!=missing_sets.end(); ++set) {
+            try {
+                free_energies(*set) = initial_free_energy_estimate(history, *set, estimate.get_lnG(), sum_N, support_n, estimate.get_x0());
+            }
+            catch (MLENoOverlapException &exception) {
+                MessageLogger::get().warning("Missing previous MLE entropy for histogram number " + to_string<unsigned int>(*set) + " in the history.");
+            }
+        }
 
         if (restricted_individual_support) {
             // Set up the GMH equations and solve the to get a estimate of the free energy (c.f. section 4.1 in [JFB02])
-            GMHequations eqn(history, sum_N, lnG_support, support_n, estimate.get_x0(), estimate.get_lnG()(estimate.get_x0()));
+            GMHequations eqn(history, sum_N, lnG_support, support_n, estimate.get_x0(), estimate.get_lnG()(estimate.get_x0()), threads);
 
-            int info = newton(free_energies, eqn);
+            int info = solve(free_energies, eqn);
 
             if (info!=0) {
                 throw MLENoSolutionException();
@@ -103,25 +114,15 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
 
             // Calculate the entropy from the estimated free energies using equation (4.2) in [JFB02].
             DArray new_lnG(estimate.get_shape());
-            calc_lnG(history, sum_N, lnG_support, support_n, free_energies, new_lnG);
+            calc_lnG(eqn.get_packed_history(), support_n, free_energies, new_lnG, threads);
             estimate.set_lnG(new_lnG);
         }
         else {
-            // Calculate the accumulated support
-            std::vector<CArray> accumulated_N(history.get_size());
-            CArray sum_N(history.get_shape());
-
-            for (MultiHistogramHistory::const_reverse_iterator set=history.rbegin(); set!=history.rend(); ++set) {
-                for (unsigned int bin=0; bin < sum_N.get_asize(); ++bin) {
-                    sum_N(bin) += (*set)->get_N()(bin);
-                }
-                accumulated_N[history.rend()-set-1] = sum_N;
-            }
-
-            // Set up the GMH equations and solve the to get a estimate of the free energy (c.f. section 4.1 in [JFB02])
-            GMHequationsAccumulated eqn(history, sum_N, accumulated_N, lnG_support, support_n, estimate.get_x0(), estimate.get_lnG()(estimate.get_x0()));
+            // Set up the GMH equations and solve the to get a estimate of the free energy (c.f. section 4.1 in [JFB02]).
+            // The accumulated support is given by the accumulated counts stored with the histograms.
+            GMHequationsAccumulated eqn(history, sum_N, lnG_support, support_n, estimate.get_x0(), estimate.get_lnG()(estimate.get_x0()), threads);
 
-            int info = newton(free_energies, eqn);
+            int info = solve(free_energies, eqn);
 
             if (info!=0) {
                 throw MLENoSolutionException();
@@ -129,7 +130,7 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
 
             // Calculate the entropy from the estimated free energies using equation (4.2) in [JFB02].
             DArray new_lnG(estimate.get_shape());
-            calc_lnG_accumulated(history, sum_N, accumulated_N, lnG_support, support_n, free_energies, new_lnG);
+            calc_lnG(eqn.get_packed_history(), support_n, free_energies, new_lnG, threads);
             estimate.set_lnG(new_lnG);
         }
 
@@ -140,7 +141,7 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
         estimate.free_energies_array = free_energies;
 
         for (unsigned int set=0; set<history.get_size(); set++) {
-            estimate.free_energies[&history[set]] = free_energies(set);
+            estimate.free_energies[history[set].get_id()] = free_energies(set);
         }
 
         // Print the estimated free energies
@@ -149,8 +150,8 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
         // Calculate and print the minimal and maximal beta
         if (history.get_shape().size()==1) {
             // Find left and right bound of the support
-            unsigned int bin_left = MLEutils::SupportBoundaries1D::find_left_bound(lnG_support);
-            unsigned int bin_right = MLEutils::SupportBoundaries1D::find_right_bound(lnG_support);
+            unsigned int bin_left = estimate.get_lnG_support_index().get_left_bound();
+            unsigned int bin_right = estimate.get_lnG_support_index().get_right_bound();
 
             double beta_left = 0;
             double beta_right = 0;
@@ -175,27 +176,135 @@ void MLE::estimate(const History &base_history, Estimate &base_estimate, const B
     }
 }
 
-double MLE::initial_free_energy_estimate(const MultiHistogramHistory &history, const DArray &lnG, const CArray &sum_N, const CArray &support_n, const std::vector<Index> x0) {
-    // TODO: This code assumes that only the first histogram is the new one. This should be generalized.
+int MLE::solve(DArray &free_energies, NonlinearEquation &eqn) {
+    switch (solver) {
+    case LBFGS :
+        return lbfgs(free_energies, eqn);
+    case NEWTON :
+    default :
+        return newton(free_energies, eqn);
+    }
+}
+
+void MLE::init_parallel() {
+    // Eigen queries the cache sizes used for blocking matrix products the
+    // first time a product is evaluated, and stores them in function static
+    // variables, so this must not first happen inside a parallel region
+#if EIGEN_VERSION_AT_LEAST(3,1,0)
+    Eigen::initParallel();
+#else
+    Eigen::l1CacheSize();
+#endif
+}
+
+void MLE::calc_support_n(const MultiHistogramHistory &history, const BArray &support, CArray &support_n) {
+    assert(support_n.get_asize()==history.get_size());
+
+    // Find the bins where the support has changed since the previous call
+    const bool cache_valid = cached_support.same_shape(support);
+    const bool *support_array = support.get_array();
+    std::vector<unsigned int> changed_bins;
+
+    if (cache_valid) {
+        const bool *cached_support_array = cached_support.get_array();
+        for (unsigned int bin=0; bin<support.get_asize(); ++bin) {
+            if (support_array[bin] != cached_support_array[bin])
+                changed_bins.push_back(bin);
+        }
+    }
+
+    // Find the position of the cached histograms. The histograms are
+    // identified by their ids, since the address of a deleted histogram may
+    // be reused by a new histogram.
+    std::map<Count, unsigned int> cached_positions;
+    if (cache_valid) {
+        for (unsigned int i=0; i<cached_ids.size(); ++i)
+            cached_positions[cached_ids[i]] = i;
+    }
+
+    // Calculate the values, where unchanged histograms are updated in the changed bins
+    std::vector<Count> new_ids(history.get_size());
+    std::vector<Count> new_ns(history.get_size());
+    std::vector<Count> new_support_n(history.get_size());
+
+    for (unsigned int set=0; set<history.get_size(); ++set) {
+        const WindowedHistogram &histogram = history[set];
+        std::map<Count, unsigned int>::const_iterator cached = cached_positions.find(histogram.get_id());
+
+        if (cached!=cached_positions.end() && cached_ns[cached->second]==histogram.get_n()) {
+            Count n = cached_support_n[cached->second];
+
+            for (std::vector<unsigned int>::const_iterator bin=changed_bins.begin(); bin!=changed_bins.end(); ++bin) {
+                if (support_array[*bin])
+                    n += histogram.get_N(*bin);
+                else
+                    n -= histogram.get_N(*bin);
+            }
+
+            new_support_n[set] = n;
+        }
+        else {
+            // Only the window of the histogram has counts
+            const Count *N = histogram.get_window_N();
+            const unsigned int window_begin = histogram.get_window_begin();
+            Count n = 0;
+
+            for (unsigned int bin=window_begin; bin<histogram.get_window_end(); ++bin) {
+                if (support_array[bin])
+                    n += N[bin-window_begin];
+            }
+
+            new_support_n[set] = n;
+        }
+
+        new_ids[set] = histogram.get_id();
+        new_ns[set] = histogram.get_n();
+        support_n(set) = new_support_n[set];
+    }
+
+    // Update the cache
+    cached_support = support;
+    cached_ids.swap(new_ids);
+    cached_ns.swap(new_ns);
+    cached_support_n.swap(new_support_n);
+}
 
+double MLE::initial_free_energy_estimate(const MultiHistogramHistory &history, unsigned int set, const DArray &lnG, const CArray &sum_N, const CArray &support_n, const std::vector<Index> x0) {
     if (history.get_size()==1) {
         // If there is only one histogram in the history, the free energy is estimated based on the reference entropy in x0.
         // See equation (2.19) in [JFB02] for details, c.f. point (1) on page 116.
-        return -lnG(x0) - history[0].get_lnw()(x0) - log(support_n(0)) + log(history[0].get_N()(x0));
+        return -lnG(x0) - history[0].get_lnw(x0) - log(support_n(0)) + log(history[0].get_N(x0));
     }
     else {
         // Else the initial guess is defined as described in equation (A.4) in [JFB02].
 
         // Find the regions where we can use the old estimate of lnG.
-        // If sum_N-history[0].get_N() >= minount then we know that lnG has been estimated for this been
-        BArray usable = (sum_N - history[0].get_N()) >= min_count && history[0].get_N() > 0;
-
-        // Calculate the total number of counts within the usable region (n_in) for the 0'th histogram
-        unsigned int n_in = history[0].get_N().sum(usable);
+        // If sum_N-history[set].get_N() >= minount then we know that lnG has been estimated for this been.
+        // Only the window of the histogram is visited, since the bins must have counts in the histogram.
+        const WindowedHistogram &histogram = history[set];
+        const Count *N = histogram.get_window_N();
+        const Count *sum_N_array = sum_N.get_array();
+        const double *lnG_array = lnG.get_array();
+        const double *lnw_array = histogram.get_window_lnw();
+        const unsigned int window_begin = histogram.get_window_begin();
+        const unsigned int accumulated_begin = histogram.get_accumulated_begin();
+
+        // Calculate the total number of counts within the usable region (n_in)
+        // for the histogram and the summands for the partition function within the usable region
+        unsigned int n_in = 0;
+        LogSumExpAccumulator z_in;
+
+        for (unsigned int bin=window_begin; bin<histogram.get_window_end(); ++bin) {
+            const Count count = N[bin-window_begin];
+            if (count > 0 && sum_N_array[bin] - count >= min_count) {
+                n_in += count;
+                z_in.add(lnG_array[bin] + lnw_array[bin-accumulated_begin]);
+            }
+        }
 
-        // Calculate the total number of counts outside the usable region (n_out) for the 0'th histogram.
+        // Calculate the total number of counts outside the usable region (n_out) for the histogram.
         // Note that we use support_n as the total number of counts for the histogram, since we are not going to use those bins, we the is no support.
-        unsigned int n_out = support_n(0) - n_in;
+        unsigned int n_out = support_n(set) - n_in;
 
         // If n_in is 0 then there is no overlap with previous histograms
         if(n_in == 0) {
@@ -203,13 +312,7 @@ double MLE::initial_free_energy_estimate(const MultiHistogramHistory &history, c
         }
 
         // First calculate the partition function within the usable area, as given by equation (A.5) in [JFB02].
-        DArray summands(history.get_shape());
-
-        for (BArray::constwheretrueiterator it = usable.get_constwheretrueiterator(); it(); ++it) {
-            summands(it) = lnG(it) + history[0].get_lnw()(it);
-        }
-
-        double ln_z_in = log_sum_exp(summands, usable);
+        double ln_z_in = z_in.get_result();
 
         // Calculate partition function as z = z_in(1+n_out/n_in) from equation (A.4) and further explained on page 117 in [JFB02].
         double lnz = ln_z_in + log(1.0 + static_cast<double> (n_out) / static_cast<double> (n_in));
@@ -222,45 +325,24 @@ void MLE::extend_estimate(const History &extended_history, Estimate &estimate, c
     estimate.extend(add_under, add_over);
 }
 
-void MLE::calc_lnG(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, const CArray &support_n, const DArray &free_energy, DArray &new_lnG) {
-    DArray summands(history.get_size());
-
-    for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it) {
-        // Calculate the sum in the denominator of equation (4.2) in [JBF02] using "log sum exp"
-        for (unsigned int i=0; i < history.get_size(); i++) {
-            if (history[i].get_N()(it) > 0) {
-                summands(i) = log(support_n(i)) + history[i].get_lnw()(it) + free_energy(i);
-            }
-            else {
-                summands(i) = -std::numeric_limits<double>::infinity();
-            }
-        }
-
-        double log_denominator = log_sum_exp(summands);
-
-        // Calculate the entropy using equation (4.2) in [JBF02]
-        new_lnG(it) = log(sum_N(it)) - log_denominator;
+void MLE::calc_lnG(const PackedHistory &packed_history, const CArray &support_n, const DArray &free_energy, DArray &new_lnG, unsigned int threads) {
+    // Calculate the sum in the denominator of equation (4.2) in [JBF02] using "log sum exp"
+    std::vector<double> offsets(packed_history.get_nhistograms());
+    for (unsigned int i=0; i < packed_history.get_nhistograms(); i++) {
+        offsets[i] = log(support_n(i)) + free_energy(i);
     }
-}
-
-void MLE::calc_lnG_accumulated(const MultiHistogramHistory &history, const CArray &sum_N, const std::vector<CArray> &accumulated_N, const BArray &support, const CArray &support_n, const DArray &free_energy, DArray &new_lnG) {
-    DArray summands(history.get_size());
 
-    for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it) {
-        // Calculate the sum in the denominator of equation (4.2) in [JBF02] using "log sum exp"
-        for (unsigned int i=0; i < history.get_size(); i++) {
-            if (history[i].get_N()(it) > 0) {
-                summands(i) = log(support_n(i)) + history[i].get_lnw()(it) + free_energy(i);
-            }
-            else {
-                summands(i) = -std::numeric_limits<double>::infinity();
-            }
-        }
+    std::vector<double> log_denominator;
+    // Only histograms with counts in a bin contributes, regardless of whether the packing uses accumulated support
+    packed_history.log_sum_exp_columns(offsets, log_denominator, true, threads);
 
-        double log_denominator = log_sum_exp(summands);
+    // Calculate the entropy using equation (4.2) in [JBF02]
+    const std::vector<unsigned int> &bins = packed_history.get_bins();
+    const double *ln_sum_N = packed_history.get_ln_sum_N();
+    double *lnG = new_lnG.get_array();
 
-        // Calculate the entropy using equation (4.2) in [JBF02]
-        new_lnG(it) = log(sum_N(it)) - log_denominator;
+    for (unsigned int k=0; k < packed_history.get_nbins(); k++) {
+        lnG[bins[k]] = ln_sum_N[k] - log_denominator[k];
     }
 }
 
@@ -283,7 +365,7 @@ Estimate* MLE::new_estimate(const DArray &lnG, const BArray &lnG_support, const
 
 	for (MultiHistogramHistory::const_iterator set=history.begin(); set!=history.end(); ++set) {
         unsigned int i = set - history.begin();
-        estimate->free_energies[*set] = free_energies(i);
+        estimate->free_energies[(*set)->get_id()] = free_energies(i);
     }
 
     // Get an accurate estimate of the free energies (the estimate is set
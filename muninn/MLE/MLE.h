@@ -29,16 +29,27 @@
 
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
+#include "muninn/utils/MessageLogger.h"
+#include "muninn/utils/threads.h"
+#include "muninn/utils/nonlinear/NonlinearEquation.h"
 #include "muninn/Estimator.h"
 #include "muninn/Histories/MultiHistogramHistory.h"
 #include "muninn/MLE/MLEestimate.h"
 
 namespace Muninn {
 
+class PackedHistory;
+
 /// The maximum likelihood estimator (MLE)s. This estimator uses the
 /// generalized multihistogram (GMH) equations for estimating the entropy.
 class MLE: public Estimator, public BaseConverter<Estimator, MLE> {
 public:
+    /// The solvers that can be used for solving the GMH equations.
+    enum Solver {
+        NEWTON,  ///< Newton's method using the full Jacobian; each iteration uses O(n^2) memory and O(n^3) time, where n is the number of histograms.
+        LBFGS    ///< L-BFGS minimization of the convex potential of the GMH equations; each iteration only requires evaluating the equations.
+    };
+
     /// Constructor for the MLE class.
     ///
     /// \param min_count The minimal number of counts in a bin in order to have
@@ -48,11 +59,23 @@ public:
     ///                                      cover the support for the individual histogram.
     /// \param history_mode Describes the procedure for deleting old histograms.
     /// \param sigma The number of bins used in the Gaussian kernel, when printing beta values.
+    /// \param threads The number of threads used for solving the GMH
+    ///                equations and calculating the entropy. The estimates
+    ///                does not depend on the number of threads. Values larger
+    ///                than one requires that Muninn is compiled with OpenMP.
+    /// \param solver The solver used for the GMH equations.
     MLE(Count min_count=30, unsigned int memory=20, bool restricted_individual_support=false,
         MultiHistogramHistory::HistoryMode history_mode=MultiHistogramHistory::DROP_OLDEST,
-        unsigned int sigma=20) :
+        unsigned int sigma=20, unsigned int threads=1, Solver solver=NEWTON) :
             min_count(min_count), memory(memory), restricted_individual_support(restricted_individual_support),
-            history_mode(history_mode), sigma(sigma) {}
+            history_mode(history_mode), sigma(sigma), threads(threads>0 ? threads : 1), solver(solver) {
+        if (this->threads>1 && !multithreading_supported()) {
+            MessageLogger::get().warning("Muninn is compiled without OpenMP, so the MLE will only use one thread.");
+        }
+
+        if (this->threads>1)
+            init_parallel();
+    }
 
     virtual ~MLE() {}
 
@@ -101,18 +124,52 @@ public:
     /// \return A new empty Estimate.
     virtual Estimate* new_estimate(const DArray &lnG, const BArray &lnG_support, const std::vector<unsigned int> &x0, const DArray &free_energies, const History &base_history, const Binner *binner=NULL, bool allow_more_free_energies=false);
 
+protected:
+    /// Solve the GMH equations using the selected solver. Estimators
+    /// solving the GMH equations by other means can override this function.
+    ///
+    /// \param free_energies The initial free energies and the solution.
+    /// \param eqn The GMH equations.
+    /// \return The return value of the solver - 0 if successful.
+    virtual int solve(DArray &free_energies, NonlinearEquation &eqn);
+
 private:
     const Count min_count;                           ///< The minimal number of counts in a bin in order to have support in a bin.
     const unsigned int memory;                       ///< The maximal number of histogram to keep in the history.
     bool restricted_individual_support;              ///< Restrict the support of the individual histograms to only cover the support for the individual histogram.
     MultiHistogramHistory::HistoryMode history_mode; ///< Describes the procedure for deleting old histograms.
     unsigned int sigma;                              ///< The number of bins used in the Gaussian kernel, used when printing beta values
-
-    /// Give an initial guess of the free energy (-ln(Z)) for the first (newest)
-    /// histogram in the history (history[0]) using the previous estimated
-    /// entropy (lnG), as described in equation (A.4) in [JFB02].
+    unsigned int threads;                            ///< The number of threads used for solving the GMH equations and calculating the entropy.
+    Solver solver;                                   ///< The solver used for the GMH equations.
+
+    BArray cached_support;                           ///< The support used for calculating the cached values of support_n.
+    std::vector<Count> cached_ids;                   ///< The ids of the histograms in the history at the previous estimate.
+    std::vector<Count> cached_ns;                    ///< The total number of counts in the cached histograms (used for detecting changed histograms).
+    std::vector<Count> cached_support_n;             ///< The number of counts within cached_support for the cached histograms.
+
+    /// Calculate the total number of counts in each histogram, but only
+    /// summed over the bins with support. The values for the histograms that
+    /// were also in the history at the previous call are updated using only
+    /// the bins where the support has changed, so the cost scales with the
+    /// number of new histograms and changed bins rather than the memory.
+    ///
+    /// \param history The history to calculate the counts for.
+    /// \param support The bins with support.
+    /// \param support_n The number of counts within the support for each
+    ///                  histogram (output); must have length history.get_size().
+    void calc_support_n(const MultiHistogramHistory &history, const BArray &support, CArray &support_n);
+
+    /// Prepare Eigen for matrix products evaluated concurrently in several
+    /// threads, which is required before the first parallel region.
+    static void init_parallel();
+
+    /// Give an initial guess of the free energy (-ln(Z)) for a histogram in
+    /// the history, which has not previously been estimated, using the
+    /// previous estimated entropy (lnG), as described in equation (A.4) in
+    /// [JFB02]. Normally this is the first (newest) histogram (history[0]).
     ///
     /// \param history The history to base the estimate on.
+    /// \param set The index of the histogram in the history.
     /// \param lnG The previous estimate of the entropy to base the initial
     ///            guess of the free energy on.
     /// \param sum_N The sum histogram.
@@ -120,39 +177,23 @@ private:
     ///                  summed over the bins with support.
     /// \param x0 The index of the reference bin for the entropy (the entropy
     ///           has a fixed value in this bin).
-    /// \return A guess of the free energy for the first histogram.
-    double initial_free_energy_estimate(const MultiHistogramHistory &history, const DArray &lnG, const CArray &sum_N, const CArray &support_n, const std::vector<Index> x0);
+    /// \return A guess of the free energy for the histogram.
+    double initial_free_energy_estimate(const MultiHistogramHistory &history, unsigned int set, const DArray &lnG, const CArray &sum_N, const CArray &support_n, const std::vector<Index> x0);
 
     /// Calculate a estimate of the entropies from the estimated free energies,
-    /// as described in equation (4.2) in [JFB02].
-    ///
-    /// \param history The history to base the estimate on.
-    /// \param sum_N The sum histogram.
-    /// \param support The support history.
-    /// \param support_n The number of counts in each histogram, but only
-    ///                  summed over the bins with support.
-    /// \param free_energy The estimated free energies for the individual
-    ///                    histograms in the history.
-    /// \param new_lnG The new calculated/estimated entropy (note that the
-    ///                array must have the corrected size).
-    static void calc_lnG(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, const CArray &support_n, const DArray &free_energy, DArray &new_lnG);
-
-    /// Calculate a estimate of the entropies from the estimated free energies
-    /// as calc_lnG, but with the local support replaced by the accumulated
-    /// support.
+    /// as described in equation (4.2) in [JFB02]. The entropies are
+    /// calculated in the packed bins, using the masks of the packing, which
+    /// are either local or accumulated support (see PackedHistory).
     ///
-    /// \param history The history to base the estimate on.
-    /// \param sum_N The sum histogram.
-    /// \param accumulated_N The i'th array in this vector contains the sum
-    ///                      histogram for the first i histograms.
-    /// \param support The support history.
+    /// \param packed_history The packed history to base the estimate on.
     /// \param support_n The number of counts in each histogram, but only
     ///                  summed over the bins with support.
     /// \param free_energy The estimated free energies for the individual
     ///                    histograms in the history.
     /// \param new_lnG The new calculated/estimated entropy (note that the
     ///                array must have the corrected size).
-    static void calc_lnG_accumulated(const MultiHistogramHistory &history, const CArray &sum_N, const std::vector<CArray> &accumulated_N, const BArray &support, const CArray &support_n, const DArray &free_energy, DArray &new_lnG);
+    /// \param threads The number of threads to use.
+    static void calc_lnG(const PackedHistory &packed_history, const CArray &support_n, const DArray &free_energy, DArray &new_lnG, unsigned int threads=1);
 };
 
 /// Exception to be thrown if the history contains non-overlapping histograms.
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
@@ -53,6 +54,19 @@ public:
     /// Empty virtual destructor
     virtual ~MLEestimate() {}
 
+    // Implementation of Estimate interface (see base class for documentation).
+    virtual Estimate* clone() const {
+        return new MLEestimate(*this);
+    }
+
+    // Implementation of Estimate interface (see base class for documentation).
+    virtual void swap(Estimate &other) {
+        MLEestimate &other_mle = MLEestimate::cast_from_base(other, "An MLEestimate can only be swapped with an other MLEestimate.");
+        Estimate::swap(other);
+        free_energies.swap(other_mle.free_energies);
+        std::swap(free_energies_array, other_mle.free_energies_array);
+    }
+
     /// Add an entries to the statistics log. This function implements the
     /// Loggable interface.
     ///
@@ -65,7 +79,7 @@ public:
     friend class MLE;
 
 private:
-    std::map<const Histogram*, double> free_energies;   ///< The estimated free energies for each histogram.
+    std::map<Count, double> free_energies;              ///< The estimated free energies for each histogram, indexed by the id of the histogram.
     DArray free_energies_array;                         ///< The estimated free energies in an array (only used for writing to log)
 };
 
@@ -0,0 +1,170 @@
+// WHAM.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#include <cmath>
+#include <deque>
+#include <limits>
+
+#include "Eigen/Core"
+#include "Eigen/Dense"
+
+#include "muninn/MLE/WHAM.h"
+#include "muninn/utils/timer.h"
+#include "muninn/utils/MessageLogger.h"
+
+namespace Muninn {
+
+/// Evaluate the equations for a given Eigen vector.
+///
+/// \param eqn The equations to evaluate.
+/// \param x The argument.
+/// \param f The calculated function value (output).
+static void evaluate(NonlinearEquation &eqn, const Eigen::VectorXd &x, Eigen::VectorXd &f) {
+    // Note that the const cast is reasonable, since X is declared const and
+    // the constructor of DArray does not modify the contents of the storage.
+    const DArray X(newvector<Index>(x.size()), const_cast<double*>(x.data()));
+    DArray F(newvector<Index>(f.size()), f.data());
+    eqn.function(X, F);
+}
+
+int WHAM::solve(DArray &free_energies, NonlinearEquation &eqn) {
+    assert(free_energies.nonempty() && free_energies.get_ndims()==1);
+
+    const Index n = free_energies.get_shape(0);
+    const timeval start = Timer::get_time();
+
+    // The current iterate, the spectral free energy and the self-consistent residual
+    Eigen::VectorXd f(n), F(n), r(n);
+
+    for (Index i=0; i<n; ++i) {
+        f(i) = free_energies(i);
+    }
+
+    // The differences between consecutive iterates and residuals used in the mixing (newest in front)
+    std::deque<Eigen::VectorXd> delta_f;
+    std::deque<Eigen::VectorXd> delta_r;
+    Eigen::VectorXd f_previous(n), r_previous(n);
+
+    // The iterate with the smallest error, which is used if the iteration is stopped
+    Eigen::VectorXd f_best = f;
+    double error_best = std::numeric_limits<double>::infinity();
+
+    int return_value = 1;
+    unsigned int iteration = 0;
+
+    for (; iteration<max_iterations; ++iteration) {
+        // Evaluate the spectral free energy
+        evaluate(eqn, f, F);
+        double error = F.cwiseAbs().maxCoeff();
+
+        // If the mixed iterate is not valid or the error has grown substantially, restart the mixing from the best iterate
+        if (!(error <= std::numeric_limits<double>::max()) || error > 10*error_best) {
+            if (delta_f.empty()) {
+                break;
+            }
+
+            delta_f.clear();
+            delta_r.clear();
+            f = f_best;
+            f_previous = f;
+            evaluate(eqn, f, F);
+            error = error_best;
+            error_best = std::numeric_limits<double>::infinity();
+        }
+
+        if (error < error_best) {
+            f_best = f;
+            error_best = error;
+        }
+
+        if (error < tolerance) {
+            return_value = 0;
+            break;
+        }
+
+        // Calculate the residual of the self-consistent update f <- f - ln(F+1)
+        for (Index i=0; i<n; ++i) {
+            r(i) = -log(1.0 + F(i));
+        }
+
+        // Update the mixing history
+        if (iteration > 0 && (f-f_previous).squaredNorm() > 0) {
+            delta_f.push_front(f - f_previous);
+            delta_r.push_front(r - r_previous);
+
+            if (delta_f.size() > mixing_depth) {
+                delta_f.pop_back();
+                delta_r.pop_back();
+            }
+        }
+
+        f_previous = f;
+        r_previous = r;
+
+        // Calculate the next iterate using Anderson mixing
+        if (delta_f.empty()) {
+            f += r;
+        }
+        else {
+            const unsigned int m = delta_f.size();
+            Eigen::MatrixXd DF(n, m);
+            Eigen::MatrixXd DR(n, m);
+
+            for (unsigned int j=0; j<m; ++j) {
+                DF.col(j) = delta_f[j];
+                DR.col(j) = delta_r[j];
+            }
+
+            Eigen::VectorXd gamma = DR.colPivHouseholderQr().solve(r);
+            f += r - (DF + DR) * gamma;
+        }
+
+        // Check the time budget
+        if (time_budget > 0) {
+            const timeval now = Timer::get_time();
+            double elapsed = (now.tv_sec - start.tv_sec) + 1E-6 * (now.tv_usec - start.tv_usec);
+
+            if (elapsed > time_budget) {
+                MessageLogger::get().info("WHAM stopped by the time budget after " + to_string(iteration+1) + " iterations with error " + to_string(error_best) + ".");
+                f = f_best;
+                return_value = 0;
+                break;
+            }
+        }
+    }
+
+    MessageLogger::get().debug("WHAM iterations: " + to_string(iteration));
+
+    // Copy the result to the free energies
+    if (return_value!=0) {
+        f = f_best;
+    }
+
+    for (Index i=0; i<n; ++i) {
+        free_energies(i) = f(i);
+    }
+
+    return return_value;
+}
+
+} // namespace Muninn
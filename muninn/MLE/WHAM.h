@@ -0,0 +1,98 @@
+// WHAM.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_WHAM_H_
+#define MUNINN_WHAM_H_
+
+#include "muninn/common.h"
+#include "muninn/MLE/MLE.h"
+
+namespace Muninn {
+
+/// An estimator that solves the generalized multihistogram (GMH) equations
+/// by self-consistent iteration, as known from the weighted histogram
+/// analysis method (WHAM). Given the free energies, the spectral free energy
+/// \f$ F_i \f$ (see GMHequations) fulfills \f$ F_i + 1 = e^{f_i} Z_i \f$, so
+/// the self-consistent update of the free energies is
+/// \f[
+///     f_i \leftarrow f_i - \ln(F_i + 1) .
+/// \f]
+/// The iteration is accelerated using Anderson mixing of the latest
+/// iterates. Each iteration only requires evaluating the GMH equations, and
+/// no Jacobian is used.
+///
+/// The estimator uses the same history, estimate, support and entropy
+/// calculation as the MLE, which it extends. Optionally, a time budget can be
+/// set, in which case the iteration is stopped when the budget is exceeded
+/// and the latest iterate is used as estimate.
+class WHAM: public MLE {
+public:
+    /// Constructor for the WHAM class.
+    ///
+    /// \param min_count The minimal number of counts in a bin in order to have
+    ///                  support in the given bin.
+    /// \param memory The maximal number of histogram to keep in the history.
+    /// \param restricted_individual_support Restrict the support of the individual histograms to only
+    ///                                      cover the support for the individual histogram.
+    /// \param history_mode Describes the procedure for deleting old histograms.
+    /// \param sigma The number of bins used in the Gaussian kernel, when printing beta values.
+    /// \param threads The number of threads used for evaluating the GMH equations.
+    /// \param mixing_depth The number of previous iterates used in the Anderson
+    ///                     mixing. The value zero gives the plain
+    ///                     self-consistent iteration.
+    /// \param time_budget The maximal time in seconds used for iterating in
+    ///                    each estimation. If zero or negative, there is no
+    ///                    time limit.
+    /// \param max_iterations The maximal number of iterations in each estimation.
+    /// \param tolerance The iteration has converged when the max norm of the
+    ///                  spectral free energy is below this value.
+    WHAM(Count min_count=30, unsigned int memory=20, bool restricted_individual_support=false,
+         MultiHistogramHistory::HistoryMode history_mode=MultiHistogramHistory::DROP_OLDEST,
+         unsigned int sigma=20, unsigned int threads=1, unsigned int mixing_depth=5,
+         double time_budget=0, unsigned int max_iterations=10000, double tolerance=1E-9) :
+             MLE(min_count, memory, restricted_individual_support, history_mode, sigma, threads),
+             mixing_depth(mixing_depth), time_budget(time_budget), max_iterations(max_iterations), tolerance(tolerance) {}
+
+    virtual ~WHAM() {}
+
+protected:
+    /// Solve the GMH equations by Anderson accelerated self-consistent
+    /// iteration.
+    ///
+    /// \param free_energies The initial free energies and the solution.
+    /// \param eqn The GMH equations.
+    /// \return 0 if the iteration converged or was stopped by the time
+    ///         budget, and 1 if the maximal number of iterations was exceeded
+    ///         or the iteration broke down.
+    virtual int solve(DArray &free_energies, NonlinearEquation &eqn);
+
+private:
+    unsigned int mixing_depth;    ///< The number of previous iterates used in the Anderson mixing.
+    double time_budget;           ///< The maximal time in seconds used for iterating in each estimation (no limit if zero or negative).
+    unsigned int max_iterations;  ///< The maximal number of iterations in each estimation.
+    double tolerance;             ///< The tolerance for the max norm of the spectral free energy.
+};
+
+} // namespace Muninn
+
+#endif // MUNINN_WHAM_H_
@@ -24,13 +24,18 @@
 #ifndef MUNINN_GMHEQUATIONS_H_
 #define MUNINN_GMHEQUATIONS_H_
 
+#include <algorithm>
 #include <limits>
+#include <vector>
+
+#include "Eigen/Core"
 
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
 #include "muninn/utils/TArrayUtils.h"
-#include "muninn/utils/TArrayMath.h"
 #include "muninn/utils/nonlinear/NonlinearEquation.h"
+#include "muninn/utils/threads.h"
+#include "muninn/MLE/utils/PackedHistory.h"
 
 namespace Muninn {
 
@@ -45,6 +50,10 @@ namespace Muninn {
 /// GMHequations::spectral_free. The Jacobian of \f$\vec{F}\f$ is implemented
 /// in the function GMHequations::spectral_free_jacobian.
 ///
+/// The histories are packed into a PackedHistory when the equations are
+/// constructed, and all evaluations of the equations stream over the packed
+/// weights.
+///
 /// The class also implements the NonlinearEquation interface.
 ///
 /// Note that in [JFB02] the Jacobian is mistakenly refereed to as the Hessian.
@@ -66,10 +75,10 @@ public:
     /// \param x0 This is the reference bin, the entropy in this bin is fixed
     ///           to lnG_x0.
     /// \param lnG_x0 The reference entropy in the reference bin x0.
-    GMHequations(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, const CArray &support_n, const std::vector<unsigned int> x0, const double &lnG_x0) :
-        history(history), support(support), support_n(support_n), x0(x0), lnG_x0(lnG_x0), lnD(history.get_shape()) {
-        ln_sum_N = TArray_log<DArray>(sum_N);
-        this->support(x0) = false;
+    /// \param threads The number of threads used when evaluating the equations.
+    GMHequations(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, const CArray &support_n, const std::vector<unsigned int> x0, const double &lnG_x0, unsigned int threads=1) :
+        packed_history(history, sum_N, support), support_n(support_n), lnG_x0(lnG_x0), threads(std::max(threads, 1u)) {
+        initialize(support, x0);
     }
 
     /// Default virtual destructor.
@@ -84,18 +93,11 @@ public:
     /// \param free_energy The free energy to calculate D from. The array must
     ///                   have shape n, where n=history.get_size().
     void calc_lnD(const DArray &free_energy) {
-        DArray summands(history.get_size());
-
-        for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it) {
-            // Calculate log of the terms in the sum given by equation (A.9) if [JFB02].
-            for (unsigned int i=0; i<history.get_size(); i++) {
-                if (history[i].get_N()(it) > 0)
-                    summands(i) = log(support_n(i)) + history[i].get_lnw()(it) + free_energy(i);
-                else
-                    summands(i) = -std::numeric_limits<double>::infinity();
-            }
-            lnD(it) = log_sum_exp(summands);
-        }
+        // Calculate log of the terms in the sum given by equation (A.9) if [JFB02], except for the weights.
+        for (unsigned int i=0; i<offsets.size(); i++)
+            offsets[i] = ln_support_n[i] + free_energy(i);
+
+        packed_history.log_sum_exp_columns(offsets, lnD, false, threads);
     }
 
     /// Calculates the spectral free energy \f$\vec{F}\f$, as given by equation
@@ -111,25 +113,44 @@ public:
     /// \param F The resulting calculated spectral free energy (output). The
     ///          array must have shape n, where n=history.get_size().
     void spectral_free(const DArray &free_energy, DArray &F) {
-        DArray summands(history.get_shape());
+        const unsigned int nbins = packed_history.get_nbins();
 
-        for (unsigned int i=0; i<history.get_size(); i++) {
-            summands = -std::numeric_limits<double>::infinity();
+        // The bin dependent part of the summands, which is minus infinity in x0
+        for (unsigned int k=0; k<nbins; k++)
+            bin_terms[k] = ln_sum_N[k] - lnD[k];
 
-            for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it)
-                if (history[i].get_N()(it) > 0)
-                    summands(it) = history[i].get_lnw()(it) + ln_sum_N(it) - lnD(it);
+        // The sum over the bins for each histogram, which only runs over the range of unmasked weights
+        packed_history.log_sum_exp_rows(bin_terms, row_sums, threads);
 
-            F(i) = -1 + exp(free_energy(i) + log_sum_exp(summands));
+        for (unsigned int i=0; i<packed_history.get_nhistograms(); i++) {
+            F(i) = -1 + exp(free_energy(i) + row_sums[i]);
 
-            if (history[i].get_N()(x0) > 0)
-                F(i) += exp(free_energy(i) + history[i].get_lnw()(x0) + lnG_x0);
+            // The masked weight in x0 is minus infinity, if the histogram has no counts in x0
+            F(i) += exp(free_energy(i) + packed_history.get_lnw(i)[x0_bin] + lnG_x0);
         }
     }
 
     /// Calculates the jacobian of spectral free energy, as given by equation
     /// (A.10) on page 118 in [JFB02].
     ///
+    /// The upper triangle of the Jacobian is calculated as the rescaled matrix
+    /// product
+    /// \f[
+    ///     H_{ij} = -n_j e^{m_i + m_j} (A A^T)_{ij} + \delta_{ij}(F_i+1),
+    ///     \qquad A_{ix} = \exp\Big(\ln w_i(x) + f_i - \ln D(x) + \tfrac{1}{2}\ln N(x) - m_i\Big),
+    /// \f]
+    /// where \f$ N \f$ is the sum histogram and \f$ m_i \f$ is the maximal
+    /// exponent in the i'th row. Since \f$ \ln w_i(x) + f_i - \ln D(x) \leq -\ln n_i \f$,
+    /// the per bin shift by \f$ \ln D(x) \f$ keeps the entries bounded, while
+    /// the per histogram shift \f$ m_i \f$ protects against underflow. The
+    /// product is evaluated using the matrix-matrix product of Eigen, so only
+    /// n times the number of bins exponentials are needed.
+    ///
+    /// The rows of A and fixed size blocks of rows of the product are
+    /// distributed among the threads. Since the partitioning does not depend on
+    /// the number of threads, the result is independent of the number of
+    /// threads.
+    ///
     /// Note, that the function assumes that GMHequations::lnD is set correct.
     /// This means that the function GMHequations::calc_lnD should have been
     /// called previously with the same value of the free_energy.
@@ -143,17 +164,61 @@ public:
     ///          corresponding to the value of free_energy. The array must have
     ///          shape (n,n), where n=history.get_size().
     void spectral_free_jacobian(const DArray &free_energy, const DArray &F,    DArray &H) {
-        DArray summands(history.get_shape());
+        const int nhistograms = packed_history.get_nhistograms();
+        const unsigned int nbins = packed_history.get_nbins();
+
+        // The bin dependent part of the exponents, which is minus infinity in x0
+        for (unsigned int k=0; k<nbins; k++)
+            bin_terms[k] = 0.5*ln_sum_N[k] - lnD[k];
+
+        // The matrices are only allocated when the Jacobian is used (resizing to the same size is a no-op)
+        scaled_weights.resize(nhistograms, nbins);
+        gram.resize(nhistograms, nhistograms);
+
+        // Calculate the rescaled matrix A
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(threads) schedule(static)
+#endif
+        for (int i=0; i<nhistograms; i++) {
+            const double *lnw = packed_history.get_lnw(i);
+            double *exponents = &thread_buffers[get_thread_number()][0];
+
+            // The entries outside the range of unmasked weights are zero
+            const unsigned int begin = packed_history.get_row_begin(i);
+            const unsigned int end = packed_history.get_row_end(i);
+
+            double max = -std::numeric_limits<double>::infinity();
+            for (unsigned int k=begin; k<end; k++) {
+                exponents[k] = lnw[k] + free_energy(i) + bin_terms[k];
+                max = (exponents[k] > max) ? exponents[k] : max;
+            }
+
+            row_shifts[i] = (max > -std::numeric_limits<double>::infinity()) ? max : 0.0;
+
+            for (unsigned int k=0; k<begin; k++)
+                scaled_weights(i,k) = 0.0;
+            for (unsigned int k=begin; k<end; k++)
+                scaled_weights(i,k) = exp(exponents[k] - row_shifts[i]);
+            for (unsigned int k=end; k<nbins; k++)
+                scaled_weights(i,k) = 0.0;
+        }
+
+        // Calculate the upper part of the Gram matrix A A^T in blocks of rows
+        const int nblocks = (nhistograms + GRAM_BLOCK_SIZE - 1) / GRAM_BLOCK_SIZE;
+
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(threads) schedule(dynamic)
+#endif
+        for (int block=0; block<nblocks; block++) {
+            const int begin = block*GRAM_BLOCK_SIZE;
+            const int size = std::min<int>(GRAM_BLOCK_SIZE, nhistograms-begin);
+            gram.block(begin, begin, size, nhistograms-begin).noalias() = scaled_weights.middleRows(begin, size) * scaled_weights.middleRows(begin, nhistograms-begin).transpose();
+        }
 
         // Calculate H(i,j) for the upper triangle
         for (unsigned int i=0; i<free_energy.get_asize(); i++) {
             for (unsigned int j=i; j<free_energy.get_asize(); j++) {
-                summands = -std::numeric_limits<double>::infinity();
-                for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it)
-                    if (history[i].get_N()(it) > 0 && history[j].get_N()(it) > 0)
-                        summands(it) = history[i].get_lnw()(it) + history[j].get_lnw()(it) + ln_sum_N(it) - 2*lnD(it);
-
-                H(i,j) = -static_cast<double>(support_n(j)) * exp(free_energy(i) + free_energy(j) + log_sum_exp(summands));
+                H(i,j) = -static_cast<double>(support_n(j)) * exp(row_shifts[i] + row_shifts[j]) * gram(i,j);
 
                 if (i==j)
                     H(i,j) += F(i) + 1.0;
@@ -189,16 +254,123 @@ public:
         spectral_free_jacobian(X, F, J);
     }
 
+    /// Implementation of the NonlinearEquation interface. The GMH equations
+    /// are the stationarity conditions of the convex potential
+    /// \f[
+    ///     L(\vec{f}) = \sum_{x \neq x_0} N(x) \ln D(x) - \sum_i n_i f_i
+    ///                 + \sum_i n_i e^{f_i} w_i(x_0) G(x_0),
+    /// \f]
+    /// which is minus the log-likelihood up to a constant, and the gradient
+    /// of the potential is \f$ \partial L / \partial f_i = n_i F_i \f$.
+    ///
+    /// \param X The free energy, which must have shape (n).
+    /// \param F The resulting spectral free energy, which must have shape (n).
+    /// \param L The resulting value of the potential.
+    /// \return True, since the potential is always available.
+    virtual bool potential(const DArray &X, DArray &F, double &L) {
+        const unsigned int nbins = packed_history.get_nbins();
+
+        calc_lnD(X);
+        spectral_free(X, F);
+
+        L = 0;
+        for (unsigned int k=0; k<nbins; k++) {
+            if (k!=x0_bin)
+                L += exp(ln_sum_N[k]) * lnD[k];
+        }
+
+        for (unsigned int i=0; i<packed_history.get_nhistograms(); i++) {
+            L -= static_cast<double>(support_n(i)) * X(i);
+            L += exp(ln_support_n[i] + X(i) + packed_history.get_lnw(i)[x0_bin] + lnG_x0);
+        }
+
+        return true;
+    }
+
+    /// Implementation of the NonlinearEquation interface. Since
+    /// \f$ n_i H_{ij} = n_j H_{ji} \f$ (see spectral_free_jacobian), the
+    /// Jacobian is symmetrized by the scaling \f$ d_i = \sqrt{n_i} \f$.
+    ///
+    /// \param D The resulting scaling, which must have shape (n).
+    /// \return True if all histograms have counts within the support.
+    virtual bool symmetrizing_scaling(DArray &D) const {
+        for (unsigned int i=0; i<support_n.get_asize(); i++) {
+            if (support_n(i)==0)
+                return false;
+            D(i) = sqrt(static_cast<double>(support_n(i)));
+        }
+        return true;
+    }
+
+    /// Get the packing of the history used by the equations. The packing
+    /// covers all bins with support including the reference bin x0.
+    ///
+    /// \return The packed history.
+    inline const PackedHistory& get_packed_history() const {
+        return packed_history;
+    }
+
+protected:
+
+    /// Constructor for the GMH equations class, where the individual support
+    /// of the histograms are given by accumulated counts. See
+    /// GMHequationsAccumulated for details.
+    GMHequations(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, const CArray &support_n, const std::vector<unsigned int> x0, const double &lnG_x0, unsigned int threads, bool accumulated_support) :
+        packed_history(history, sum_N, support, accumulated_support), support_n(support_n), lnG_x0(lnG_x0), threads(std::max(threads, 1u)) {
+        initialize(support, x0);
+    }
+
 private:
-    const MultiHistogramHistory &history;  ///< The history the equations are based on.
-    BArray support;                        ///< The support of the history; support(j) is true if the bin with index j has support.
+    /// The number of rows in the blocks of the Gram matrix distributed among the threads.
+    static const int GRAM_BLOCK_SIZE = 32;
+
+    PackedHistory packed_history;          ///< The history the equations are based on, packed to the bins with support.
     const CArray &support_n;               ///< The total number of observations in the individual histogram, but only summed over the bins with support.
 
-    std::vector<unsigned int> x0;          ///< The index of the reference bin, where the entropy is fixed to lnG_x0.
+    unsigned int x0_bin;                   ///< The packed position of the reference bin, where the entropy is fixed to lnG_x0.
     double lnG_x0;                         ///< The reference entropy in the reference bin x0.
 
-    DArray ln_sum_N;                       ///< The log of the sum histogram for the history.
-    DArray lnD;                            ///< ln(D), where D is given by equation (A.9) in [JFB02] where it is denoted G.
+    unsigned int threads;                  ///< The number of threads used when evaluating the equations.
+
+    std::vector<double> ln_support_n;      ///< The log of support_n.
+    std::vector<double> ln_sum_N;          ///< The packed log of the sum histogram for the history, set to minus infinity in x0.
+    std::vector<double> lnD;               ///< The packed ln(D), where D is given by equation (A.9) in [JFB02] where it is denoted G.
+
+    std::vector<double> offsets;           ///< Scratch buffer for the histogram dependent terms in calc_lnD.
+    std::vector<double> bin_terms;         ///< Scratch buffer for the bin dependent terms of the summands.
+    std::vector<double> row_sums;          ///< Scratch buffer for the log-sum-exp over the bins for each histogram.
+    std::vector<std::vector<double> > thread_buffers; ///< Contiguous scratch buffers for the exponents; one for each thread.
+
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> scaled_weights; ///< The rescaled matrix A used for the Jacobian.
+    Eigen::MatrixXd gram;                  ///< The Gram matrix A A^T used for the Jacobian (only the upper triangle is calculated).
+    std::vector<double> row_shifts;        ///< The per histogram shifts of the exponents in A.
+
+    /// Set up the tables and buffers used by the equations.
+    ///
+    /// \param support The support of the history.
+    /// \param x0 The reference bin.
+    void initialize(const BArray &support, const std::vector<unsigned int> &x0) {
+        const unsigned int nhistograms = packed_history.get_nhistograms();
+        const unsigned int stride = packed_history.get_stride();
+
+        x0_bin = packed_history.find_bin(support.get_index(x0));
+        assert(x0_bin < packed_history.get_nbins());
+
+        ln_support_n.resize(nhistograms);
+        for (unsigned int i=0; i<nhistograms; i++)
+            ln_support_n[i] = log(static_cast<double>(support_n(i)));
+
+        // The reference bin is excluded from the sums, since the entropy is fixed in x0
+        ln_sum_N.assign(packed_history.get_ln_sum_N(), packed_history.get_ln_sum_N() + stride);
+        ln_sum_N[x0_bin] = -std::numeric_limits<double>::infinity();
+
+        offsets.resize(nhistograms);
+        bin_terms.resize(stride);
+        row_sums.resize(nhistograms);
+        thread_buffers.assign(threads, std::vector<double>(stride));
+
+        row_shifts.resize(nhistograms);
+    }
 };
 
 } // namespace Muninn
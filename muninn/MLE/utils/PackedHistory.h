@@ -0,0 +1,412 @@
+// PackedHistory.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_PACKEDHISTORY_H_
+#define MUNINN_PACKEDHISTORY_H_
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "muninn/common.h"
+#include "muninn/utils/TArray.h"
+#include "muninn/utils/TArrayUtils.h"
+#include "muninn/Histories/MultiHistogramHistory.h"
+
+namespace Muninn {
+
+/// A dense packing of a MultiHistogramHistory restricted to a set of bins
+/// (normally the bins with support). The weights of the histograms are stored
+/// in a (histograms x bins) matrix in row-major order, such that the packed
+/// bins of a single histogram are contiguous in memory. Each row is padded to
+/// a multiple of the cache line size and the rows are aligned accordingly.
+///
+/// Bins outside the mask of a histogram (normally the bins where the histogram
+/// has no counts) are masked out by storing minus infinity as the weight. Accordingly, sums of the form
+/// \f$ \sum_{x: N_i(x)>0} \exp(\ln w_i(x) + \ldots) \f$ can be evaluated as
+/// branch free loops over the rows, since the masked bins contribute with
+/// \f$ \exp(-\infty)=0 \f$. Padding entries are likewise set to minus
+/// infinity. Furthermore, a (histograms x bins) matrix flagging the bins where
+/// the individual histograms has counts is stored alongside the weights.
+///
+/// For each row, the unmasked entries lie within a range of packed bins
+/// [get_row_begin(i), get_row_end(i)), which is found from the windows of the
+/// histograms (see Histogram::get_window_begin). Since each histogram
+/// normally only covers a narrow part of the bins, the sums can be restricted
+/// to these ranges.
+///
+/// The packing is constructed once per estimation, after which the GMH
+/// equations only stream over the packed matrix.
+class PackedHistory {
+public:
+
+    /// Constructor. The mask for the i'th histogram is either the bins where
+    /// the i'th histogram has counts, or, if accumulated_support is true, the
+    /// bins where the i'th histogram or any older histogram has counts (see
+    /// MultiHistogramHistory::get_accumulated_N).
+    ///
+    /// \param history The history to pack.
+    /// \param sum_N The sum histogram for the history.
+    /// \param support The bins to pack; support(j) is true if the bin with
+    ///                index j should be included in the packing.
+    /// \param accumulated_support If true, the accumulated number of counts in
+    ///                            each bin is used to determine the mask.
+    PackedHistory(const MultiHistogramHistory &history, const CArray &sum_N, const BArray &support, bool accumulated_support=false) :
+        nhistograms(history.get_size()), nbins(0), stride(0), lnw_storage(), lnw(NULL), has_counts(), row_begin(nhistograms), row_end(nhistograms), bins(), ln_sum_N() {
+
+        assert(support.has_shape(history.get_shape()) && sum_N.has_shape(history.get_shape()));
+
+        // Find the flat indices of the packed bins
+        const bool *support_array = support.get_array();
+        for (unsigned int index=0; index<support.get_asize(); ++index)
+            if (support_array[index])
+                bins.push_back(index);
+
+        nbins = bins.size();
+        stride = ((nbins + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+        // Allocate the storage with room for aligning the first row
+        lnw_storage.assign(static_cast<size_t>(nhistograms)*stride + ALIGNMENT, -std::numeric_limits<double>::infinity());
+        size_t misalignment = (reinterpret_cast<size_t>(&lnw_storage[0]) / sizeof(double)) % ALIGNMENT;
+        lnw = &lnw_storage[0] + (misalignment==0 ? 0 : ALIGNMENT-misalignment);
+
+        // Pack the weights and the count flags of the histograms. The
+        // histograms are visited from the oldest, such that the accumulated
+        // window covers the bins where the histogram or any older histogram
+        // has counts.
+        has_counts.assign(static_cast<size_t>(nhistograms)*stride, 0);
+
+        unsigned int accumulated_begin = 0;
+        unsigned int accumulated_end = 0;
+
+        for (unsigned int i=nhistograms; i-- > 0; ) {
+            const WindowedHistogram &histogram = history[i];
+            const Count *N = histogram.get_window_N();
+            const double *history_lnw = histogram.get_window_lnw();
+            const unsigned int window_begin = histogram.get_window_begin();
+            const unsigned int lnw_begin = histogram.get_accumulated_begin();
+            double *row = lnw + static_cast<size_t>(i)*stride;
+            unsigned char *has_counts_row = &has_counts[static_cast<size_t>(i)*stride];
+
+            const unsigned int counts_begin = lower_bound_bin(histogram.get_window_begin());
+            const unsigned int counts_end = lower_bound_bin(histogram.get_window_end());
+
+            for (unsigned int k=counts_begin; k<counts_end; ++k) {
+                has_counts_row[k] = (N[bins[k]-window_begin] > 0);
+                if (has_counts_row[k])
+                    row[k] = history_lnw[bins[k]-lnw_begin];
+            }
+
+            row_begin[i] = counts_begin;
+            row_end[i] = counts_end;
+
+            if (accumulated_support) {
+                if (histogram.get_window_begin() < histogram.get_window_end()) {
+                    if (accumulated_begin == accumulated_end) {
+                        accumulated_begin = histogram.get_window_begin();
+                        accumulated_end = histogram.get_window_end();
+                    }
+                    else {
+                        accumulated_begin = std::min(accumulated_begin, histogram.get_window_begin());
+                        accumulated_end = std::max(accumulated_end, histogram.get_window_end());
+                    }
+                }
+
+                row_begin[i] = lower_bound_bin(accumulated_begin);
+                row_end[i] = lower_bound_bin(accumulated_end);
+
+                for (unsigned int k=row_begin[i]; k<row_end[i]; ++k) {
+                    if (!has_counts_row[k] && histogram.get_accumulated_N(bins[k]) > 0)
+                        row[k] = history_lnw[bins[k]-lnw_begin];
+                }
+            }
+        }
+
+        // Pack the log of the sum histogram
+        ln_sum_N.resize(stride, -std::numeric_limits<double>::infinity());
+        const Count *sum_N_array = sum_N.get_array();
+        for (unsigned int k=0; k<nbins; ++k)
+            ln_sum_N[k] = log(static_cast<double>(sum_N_array[bins[k]]));
+    }
+
+    /// Get the number of histograms (rows) in the packing.
+    ///
+    /// \return The number of histograms.
+    inline unsigned int get_nhistograms() const {return nhistograms;}
+
+    /// Get the number of packed bins.
+    ///
+    /// \return The number of packed bins.
+    inline unsigned int get_nbins() const {return nbins;}
+
+    /// Get the distance between two consecutive rows in the packed matrix,
+    /// which is the number of packed bins rounded up to the alignment.
+    ///
+    /// \return The row stride.
+    inline unsigned int get_stride() const {return stride;}
+
+    /// Get the flat indices of the packed bins in the original histogram
+    /// arrays; get_bins()[k] is the flat index of the k'th packed bin.
+    ///
+    /// \return The flat indices of the packed bins.
+    inline const std::vector<unsigned int>& get_bins() const {return bins;}
+
+    /// Find the packed position of a bin.
+    ///
+    /// \param index The flat index of the bin in the history.
+    /// \return The packed position of the bin or get_nbins() if the bin is not
+    ///         packed.
+    inline unsigned int find_bin(unsigned int index) const {
+        std::vector<unsigned int>::const_iterator it = std::lower_bound(bins.begin(), bins.end(), index);
+        return (it!=bins.end() && *it==index) ? static_cast<unsigned int>(it-bins.begin()) : nbins;
+    }
+
+    /// Get the first packed bin of the range of unmasked entries of a row.
+    /// All entries of the row before this bin are minus infinity.
+    ///
+    /// \param i The index of the histogram in the history.
+    /// \return The first packed bin of the range.
+    inline unsigned int get_row_begin(unsigned int i) const {return row_begin[i];}
+
+    /// Get one past the last packed bin of the range of unmasked entries of a
+    /// row. All entries of the row from this bin and onwards are minus
+    /// infinity.
+    ///
+    /// \param i The index of the histogram in the history.
+    /// \return One past the last packed bin of the range.
+    inline unsigned int get_row_end(unsigned int i) const {return row_end[i];}
+
+    /// Get the packed weights of a histogram.
+    ///
+    /// \param i The index of the histogram in the history.
+    /// \return A pointer to get_stride() contiguous weights for the i'th
+    ///         histogram, where masked and padding entries are minus infinity.
+    inline const double* get_lnw(unsigned int i) const {
+        return lnw + static_cast<size_t>(i)*stride;
+    }
+
+    /// Get the packed flags for the bins where a histogram has counts.
+    ///
+    /// \param i The index of the histogram in the history.
+    /// \return A pointer to get_stride() contiguous flags for the i'th
+    ///         histogram, which are non-zero where the histogram has counts.
+    inline const unsigned char* get_has_counts(unsigned int i) const {
+        return &has_counts[static_cast<size_t>(i)*stride];
+    }
+
+    /// Get the packed log of the sum histogram.
+    ///
+    /// \return A pointer to get_stride() contiguous values, where padding
+    ///         entries are minus infinity.
+    inline const double* get_ln_sum_N() const {
+        return &ln_sum_N[0];
+    }
+
+    /// For each packed bin calculate the log-sum-exp over the histograms of
+    /// the packed weights shifted by a histogram specific offset, that is
+    /// \f[
+    ///     r_k = \ln \sum_i \exp(\ln w_i(x_k) + c_i).
+    /// \f]
+    /// The bins are processed in blocks of fixed size, and within a block the
+    /// rows are streamed twice: once for determining the maximum in each bin
+    /// and once for summing. Bins with no unmasked entries yields minus
+    /// infinity.
+    ///
+    /// The blocks are distributed among the threads. Since the partitioning
+    /// into blocks does not depend on the number of threads, the result is
+    /// independent of the number of threads.
+    ///
+    /// \param offsets The offsets \f$ c_i \f$; must have length get_nhistograms().
+    /// \param result The result \f$ r_k \f$ (output); is resized to get_stride().
+    /// \param only_with_counts If true, the sum for each bin only runs over the
+    ///                         histograms with counts in the bin, regardless
+    ///                         of the mask used for the weights.
+    /// \param threads The number of threads to use.
+    inline void log_sum_exp_columns(const std::vector<double> &offsets, std::vector<double> &result, bool only_with_counts=false, unsigned int threads=1) const {
+        assert(offsets.size()==nhistograms);
+        result.resize(stride);
+
+        const int nblocks = (stride + COLUMN_BLOCK_SIZE - 1) / COLUMN_BLOCK_SIZE;
+
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(threads) schedule(static)
+#endif
+        for (int block=0; block<nblocks; ++block) {
+            unsigned int begin = block*COLUMN_BLOCK_SIZE;
+            unsigned int end = std::min(begin+COLUMN_BLOCK_SIZE, stride);
+            log_sum_exp_columns(offsets, only_with_counts, begin, end, &result[0]);
+        }
+    }
+
+    /// For each histogram calculate the log-sum-exp over the packed bins of
+    /// the packed weights shifted by a bin specific offset, that is
+    /// \f[
+    ///     r_i = \ln \sum_k \exp(\ln w_i(x_k) + c_k).
+    /// \f]
+    /// The sum for each row only runs over its range of unmasked entries (see
+    /// log_sum_exp_rows(const double*, unsigned int, size_t, const double*, const unsigned int*, const unsigned int*, double*)).
+    /// Rows without unmasked entries yields minus infinity.
+    ///
+    /// The rows are distributed among the threads in blocks. Since the sum
+    /// for each row is calculated independently, the result is independent of
+    /// the number of threads.
+    ///
+    /// \param offsets The offsets \f$ c_k \f$; must have length get_stride().
+    /// \param result The result \f$ r_i \f$ (output); is resized to get_nhistograms().
+    /// \param threads The number of threads to use.
+    inline void log_sum_exp_rows(const std::vector<double> &offsets, std::vector<double> &result, unsigned int threads=1) const {
+        assert(offsets.size()==stride);
+        result.resize(nhistograms);
+
+        const int nblocks = (nhistograms + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE;
+
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(threads) schedule(static)
+#endif
+        for (int block=0; block<nblocks; ++block) {
+            unsigned int begin = block*ROW_BLOCK_SIZE;
+            unsigned int size = std::min(begin+ROW_BLOCK_SIZE, nhistograms) - begin;
+            Muninn::log_sum_exp_rows(get_lnw(begin), size, stride, &offsets[0], &row_begin[begin], &row_end[begin], &result[begin]);
+        }
+    }
+
+private:
+    /// The alignment of the rows in number of doubles (a 64 byte cache line).
+    static const unsigned int ALIGNMENT = 8;
+
+    /// The number of bins in the blocks used by log_sum_exp_columns.
+    static const unsigned int COLUMN_BLOCK_SIZE = 1024;
+
+    /// The number of rows in the blocks used by log_sum_exp_rows.
+    static const unsigned int ROW_BLOCK_SIZE = 4;
+
+    unsigned int nhistograms;              ///< The number of histograms (rows) in the packing.
+    unsigned int nbins;                    ///< The number of packed bins.
+    unsigned int stride;                   ///< The distance between two rows; nbins rounded up to the alignment.
+
+    std::vector<double> lnw_storage;       ///< The storage for the packed weights including room for alignment.
+    double *lnw;                           ///< Pointer to the aligned first row of the packed weights.
+
+    std::vector<unsigned char> has_counts; ///< The packed flags for the bins where the histograms has counts.
+    std::vector<unsigned int> row_begin;   ///< The first packed bin of the unmasked entries in each row.
+    std::vector<unsigned int> row_end;     ///< One past the last packed bin of the unmasked entries in each row.
+
+    std::vector<unsigned int> bins;        ///< The flat indices of the packed bins.
+    std::vector<double> ln_sum_N;          ///< The packed log of the sum histogram.
+
+    /// Calculate the log-sum-exp over the histograms for a block of bins (see
+    /// log_sum_exp_columns).
+    ///
+    /// \param offsets The offsets added to the rows.
+    /// \param only_with_counts If true, bins where the histogram has no counts
+    ///                         are left out.
+    /// \param begin The first bin in the block.
+    /// \param end One past the last bin in the block.
+    /// \param result The result for the full range of bins (output); only the
+    ///               entries in the block are set.
+    inline void log_sum_exp_columns(const std::vector<double> &offsets, bool only_with_counts, unsigned int begin, unsigned int end, double *result) const {
+        const double minus_infinity = -std::numeric_limits<double>::infinity();
+        const unsigned int size = end - begin;
+
+        std::vector<double> values(size);
+        std::vector<double> max(size, minus_infinity);
+        std::vector<double> sum(size, 0.0);
+
+        // Rows are only visited within their range of unmasked entries,
+        // since the entries outside the range contribute with zero
+        for (unsigned int i=0; i<nhistograms; ++i) {
+            const unsigned int row_first = std::max(begin, row_begin[i]);
+            const unsigned int row_last = std::min(end, row_end[i]);
+            if (row_first >= row_last)
+                continue;
+
+            shifted_row(i, offsets[i], only_with_counts, row_first, row_last, &values[row_first-begin]);
+            for (unsigned int k=row_first-begin; k<row_last-begin; ++k)
+                max[k] = (values[k] > max[k]) ? values[k] : max[k];
+        }
+
+        // Replace minus infinity by zero, to avoid subtracting infinities
+        for (unsigned int k=0; k<size; ++k)
+            max[k] = (max[k] == minus_infinity) ? 0.0 : max[k];
+
+        for (unsigned int i=0; i<nhistograms; ++i) {
+            const unsigned int row_first = std::max(begin, row_begin[i]);
+            const unsigned int row_last = std::min(end, row_end[i]);
+            if (row_first >= row_last)
+                continue;
+
+            shifted_row(i, offsets[i], only_with_counts, row_first, row_last, &values[row_first-begin]);
+            for (unsigned int k=row_first-begin; k<row_last-begin; ++k)
+                sum[k] += exp(values[k] - max[k]);
+        }
+
+        for (unsigned int k=0; k<size; ++k)
+            result[begin+k] = max[k] + log(sum[k]);
+    }
+
+    /// Calculate a block of a row of the packed weights shifted by an offset.
+    ///
+    /// \param i The index of the histogram.
+    /// \param offset The offset added to the weights.
+    /// \param only_with_counts If true, bins where the histogram has no counts
+    ///                         are set to minus infinity.
+    /// \param begin The first bin in the block.
+    /// \param end One past the last bin in the block.
+    /// \param values The shifted block of the row (output); must point to a
+    ///               buffer of at least end-begin values.
+    inline void shifted_row(unsigned int i, double offset, bool only_with_counts, unsigned int begin, unsigned int end, double *values) const {
+        const double *row = get_lnw(i) + begin;
+        const unsigned int size = end - begin;
+
+        if (only_with_counts) {
+            const unsigned char *has_counts_row = get_has_counts(i) + begin;
+            for (unsigned int k=0; k<size; ++k)
+                values[k] = has_counts_row[k] ? row[k] + offset : -std::numeric_limits<double>::infinity();
+        }
+        else {
+            for (unsigned int k=0; k<size; ++k)
+                values[k] = row[k] + offset;
+        }
+    }
+
+    /// Find the first packed bin with a flat index not less than a given index.
+    ///
+    /// \param index The flat index.
+    /// \return The packed position, which is get_nbins() if all packed bins has
+    ///         a smaller flat index.
+    inline unsigned int lower_bound_bin(unsigned int index) const {
+        return std::lower_bound(bins.begin(), bins.end(), index) - bins.begin();
+    }
+
+    /// Private copy constructor, since the aligned pointer refers into the storage.
+    PackedHistory(const PackedHistory &);
+
+    /// Private assignment operator, since the aligned pointer refers into the storage.
+    PackedHistory& operator=(const PackedHistory &);
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_PACKEDHISTORY_H_ */
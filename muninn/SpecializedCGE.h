@@ -0,0 +1,130 @@
+// SpecializedCGE.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_SPECIALIZEDCGE_H_
+#define MUNINN_SPECIALIZEDCGE_H_
+
+#include "muninn/CGE.h"
+
+namespace Muninn {
+
+/// A CGE class specialized for a given type of binner and update scheme. The
+/// functions add_observation() and get_lnweights() call the binner and the
+/// update scheme non-virtually, which allows the compiler to inline the path
+/// taken for each observation within the binned region. All other calls,
+/// including observations outside the binned region, are handled by the
+/// general CGE class.
+///
+/// Note that the specialized functions hide the functions of the base class,
+/// so the object must be used through a pointer or reference to the
+/// specialized type to take advantage of the specialization (see
+/// CGEfactory::new_specialized_CGE()).
+///
+/// \tparam BinnerT The type of the binner.
+/// \tparam UpdateSchemeT The type of the update scheme.
+template <class BinnerT, class UpdateSchemeT>
+class SpecializedCGE : public CGE {
+public:
+
+    /// Constructor based on pointers to the Estimator, UpdateScheme,
+    /// WeighScheme and Binner objects (see the corresponding CGE constructor).
+    ///
+    /// \param estimator A pointer to the Estimator to be used.
+    /// \param updatescheme A pointer to the UpdateScheme to be used.
+    /// \param weightscheme A pointer to the weightscheme to be used.
+    /// \param binner A reference to the binner to be used.
+    /// \param statisticslogger A pointer to the StatisticsLogger (if set to
+    ///                         null no statistics will be logged).
+    /// \param initial_beta The beta to be used for collecting the first histogram.
+    /// \param receives_ownership Whether the CGE class takes ownership of the
+    ///                           Estimator, UpdateScheme and WeighScheme objects.
+    SpecializedCGE(Estimator *estimator,
+                   UpdateSchemeT *updatescheme,
+                   WeightScheme *weightscheme,
+                   BinnerT *binner,
+                   StatisticsLogger *statisticslogger=NULL,
+                   double initial_beta=0,
+                   bool receives_ownership=false) :
+        CGE(estimator, updatescheme, weightscheme, binner, statisticslogger, initial_beta, receives_ownership),
+        specialized_binner(binner) {}
+
+    /// Construct a CGE object based on a given estimate and a history (see
+    /// the corresponding CGE constructor).
+    ///
+    /// \param estimate The inital value of the estimate.
+    /// \param history The initial history.
+    /// \param estimator A pointer to the Estimator to be used.
+    /// \param updatescheme A pointer to the UpdateScheme to be used.
+    /// \param weightscheme A pointer to the weightscheme to be used.
+    /// \param binner A reference to the binner to be used.
+    /// \param statisticslogger A pointer to the StatisticsLogger (if set to
+    ///                         null no statistics will be logged).
+    /// \param receives_ownership Whether the CGE class takes ownership of the
+    ///                           Estimate, History, Estimator, UpdateScheme,
+    ///                           and WeighScheme objects.
+    SpecializedCGE(Estimate *estimate,
+                   History *history,
+                   Estimator *estimator,
+                   UpdateSchemeT *updatescheme,
+                   WeightScheme *weightscheme,
+                   BinnerT *binner,
+                   StatisticsLogger *statisticslogger=NULL,
+                   bool receives_ownership=false) :
+        CGE(estimate, history, estimator, updatescheme, weightscheme, binner, statisticslogger, receives_ownership),
+        specialized_binner(binner) {}
+
+    /// Add a observation of an energy (see CGE::add_observation()).
+    ///
+    /// \param energy The energy to be added.
+    /// \return Returns true if new weights should be estimated.
+    inline bool add_observation(double energy) {
+        if (!initial_collection && get_estimation_state() == ESTIMATION_IDLE) {
+            int bin = specialized_binner->BinnerT::calc_bin(energy);
+
+            if (0<=bin && bin<static_cast<int>(specialized_binner->get_nbins()))
+                return ge.template add_observation_specialized<UpdateSchemeT>(bin);
+        }
+        return CGE::add_observation(energy);
+    }
+
+    /// Get the log weighs for an energy (see CGE::get_lnweights()).
+    ///
+    /// \param energy The energy to get a weigh for.
+    /// \return The log weight for the energy.
+    inline double get_lnweights(double energy) {
+        if (!initial_collection) {
+            int bin = specialized_binner->BinnerT::calc_bin(energy);
+
+            if (0<=bin && bin<static_cast<int>(specialized_binner->get_nbins()))
+                return ge.get_lnweights(bin);
+        }
+        return CGE::get_lnweights(energy);
+    }
+
+private:
+    BinnerT *specialized_binner;  ///< The binner in use, with its specialized type.
+};
+
+} // namespace Muninn
+
+#endif // MUNINN_SPECIALIZEDCGE_H_
@@ -0,0 +1,134 @@
+// SupportIndex.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_SUPPORTINDEX_H_
+#define MUNINN_SUPPORTINDEX_H_
+
+#include <vector>
+#include <utility>
+
+#include "muninn/common.h"
+#include "muninn/utils/TArray.h"
+#include "muninn/Exceptions/MessageException.h"
+
+namespace Muninn {
+
+/// A compressed representation of a support mask, which contains the (flat)
+/// indices of the bins with support, the outer bounds of the support and the
+/// internal regions without support. The index is calculated once from the
+/// mask, such that the users of the support do not need to scan the mask.
+class SupportIndex {
+public:
+    /// Construct an empty support index.
+    SupportIndex() : indices(), internal_unsupported() {}
+
+    /// Construct the support index of a support mask.
+    ///
+    /// \param support The support mask.
+    explicit SupportIndex(const BArray &support) : indices(), internal_unsupported() {
+        update(support);
+    }
+
+    /// Recalculate the index from a support mask.
+    ///
+    /// \param support The support mask.
+    void update(const BArray &support) {
+        indices.clear();
+        internal_unsupported.clear();
+
+        const bool *values = support.get_array();
+        const unsigned int size = support.get_asize();
+
+        for (unsigned int i=0; i<size; ++i) {
+            if (values[i]) {
+                if (!indices.empty() && indices.back()+1 != i)
+                    internal_unsupported.push_back(std::pair<unsigned int,unsigned int>(indices.back(), i));
+                indices.push_back(i);
+            }
+        }
+    }
+
+    /// Move the index to an extended support mask, where a number of bins
+    /// without support have been added before the first bin. This
+    /// corresponds to an extension of a one-dimensional support mask.
+    ///
+    /// \param add_under The number of bins added before the first bin.
+    void shift(unsigned int add_under) {
+        for (std::vector<unsigned int>::iterator it=indices.begin(); it!=indices.end(); ++it)
+            *it += add_under;
+
+        for (std::vector<std::pair<unsigned int,unsigned int> >::iterator it=internal_unsupported.begin(); it!=internal_unsupported.end(); ++it) {
+            it->first += add_under;
+            it->second += add_under;
+        }
+    }
+
+    /// Get the indices of the bins with support in increasing order.
+    ///
+    /// \return The indices of the bins with support.
+    inline const std::vector<unsigned int>& get_indices() const {return indices;}
+
+    /// Get the number of bins with support.
+    ///
+    /// \return The number of bins with support.
+    inline unsigned int size() const {return indices.size();}
+
+    /// Determine if no bins have support.
+    ///
+    /// \return True if no bins have support.
+    inline bool empty() const {return indices.empty();}
+
+    /// Get the first bin with support.
+    ///
+    /// \return The index of the first bin with support.
+    inline unsigned int get_left_bound() const {
+        if (indices.empty())
+            throw MessageException("No support found on left side.");
+        return indices.front();
+    }
+
+    /// Get the last bin with support.
+    ///
+    /// \return The index of the last bin with support.
+    inline unsigned int get_right_bound() const {
+        if (indices.empty())
+            throw MessageException("No support found on right side.");
+        return indices.back();
+    }
+
+    /// Get the internal regions without support. Each region is given by a
+    /// pair of bins with support, such that the bins strictly between the
+    /// two has no support.
+    ///
+    /// \return The internal regions without support.
+    inline const std::vector<std::pair<unsigned int,unsigned int> >& get_internal_unsupported() const {return internal_unsupported;}
+
+private:
+    std::vector<unsigned int> indices;                                        ///< The indices of the bins with support.
+    std::vector<std::pair<unsigned int,unsigned int> > internal_unsupported;  ///< The bounds of the internal regions without support.
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_SUPPORTINDEX_H_ */
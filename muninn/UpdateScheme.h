@@ -58,6 +58,22 @@ public:
     /// \return Returns true if the weights should be updated.
     virtual bool update_required(const Histogram &current, const History &history)=0;
 
+    /// Get a countdown of observations, which allows the GE class to avoid
+    /// calling update_required() for every observation. The function is
+    /// called after update_required() has returned false, and must return a
+    /// number of observations, \f$ k \f$, such that update_required() will
+    /// return false until at least \f$ k \f$ more observations have been
+    /// added to the current histogram (given that the state of the update
+    /// scheme is unchanged). The default implementation returns zero, which
+    /// means that update_required() is called for every observation.
+    ///
+    /// \param current The histogram for the current (ongoing) simulation.
+    /// \param history The history of previous histograms
+    /// \return The number of observations before an update can be required.
+    virtual Count observations_until_update(const Histogram &current, const History &history) const {
+        return 0;
+    }
+
     /// This function is always called before the current histogram is added
     /// to the history. This allows the update scheme to updates its state.
     ///
@@ -83,6 +83,12 @@ public:
         return current.get_n() >= (this_max+prolonging);
     }
 
+    // Implementation of UpdateScheme interface (see base class for documentation).
+    virtual Count observations_until_update(const Histogram &current, const History &history) const {
+        Count max = this_max+prolonging;
+        return (current.get_n() < max) ? max-current.get_n() : 0;
+    }
+
     /// This function is always called before the current histogram is added
     /// to the history. This allows the the scheme to update the value of the
     /// current IncreaseFactorScheme::this_max.
@@ -93,16 +99,28 @@ public:
         const MultiHistogramHistory& mh_history = MultiHistogramHistory::cast_from_base(history, "The FractionalIncreaseFactorScheme update scheme is only compatible with the MultiHistogramHistory.");
 
         if (mh_history.get_size() > 0) {
-            // Check if thismax should be updated
+            // Check if thismax should be updated. The bins observed in the
+            // history are marked in place, to avoid temporary arrays for
+            // each histogram in the history. Only the window of bins with
+            // counts is visited for each histogram.
             BArray prev_observed(mh_history.get_shape());
+            bool *observed = prev_observed.get_array();
 
-            for (MultiHistogramHistory::const_iterator it=mh_history.begin(); it!=mh_history.end(); it++)
-                prev_observed = prev_observed || ((*it)->get_N() >= min_count);
+            for (MultiHistogramHistory::const_iterator it=mh_history.begin(); it!=mh_history.end(); it++) {
+                const Count *N = (*it)->get_window_N();
+                const unsigned int window_begin = (*it)->get_window_begin();
+                for (unsigned int i=window_begin; i<(*it)->get_window_end(); ++i)
+                    observed[i] |= (N[i-window_begin] >= min_count);
+            }
 
             unsigned int num_prev_observed = number_of_true(prev_observed);
 
-            BArray new_observations = (current.get_N() >= min_count) && (!prev_observed);
-            unsigned int new_observed_bins = number_of_true(new_observations);
+            // Count the bins that are only observed in the current histogram
+            const Count *current_N = current.get_N().get_array();
+            unsigned int new_observed_bins = 0;
+
+            for (unsigned int i=current.get_window_begin(); i<current.get_window_end(); ++i)
+                new_observed_bins += (current_N[i] >= min_count) && !observed[i];
 
             if (new_observed_bins<fraction*num_prev_observed || (new_observed_bins==0 && fraction<0) ) {
                 this_max = std::min(static_cast<Count>(this_max * increase_factor), max_iterations_per_histogram);
@@ -24,6 +24,8 @@
 #ifndef MUNINN_WEIGHTSCHEME_H_
 #define MUNINN_WEIGHTSCHEME_H_
 
+#include <vector>
+
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
 #include "muninn/Estimate.h"
@@ -49,6 +51,25 @@ public:
     /// \param binner If the binning is not even, a binner should also be passed.
     /// \return Weights according to the weight scheme.
     virtual DArray get_weights(const Estimate &estimate, const History &history, const Binner *binner=NULL) = 0;
+
+    /// This method sets the weights in the bins added by an extension of the
+    /// binned area, without recalculating the weights in the remaining bins.
+    /// The weights lnw are the weights returned by the last call to
+    /// get_weights(), where the added bins have been inserted (with weight
+    /// zero). Weight schemes that cannot set the weights of the added bins
+    /// independently of the remaining bins should return false, in which case
+    /// all weights must be recalculated with get_weights().
+    ///
+    /// \param lnw The extended weights, where the added bins are to be set.
+    /// \param add_under The number of bins added leftmost in all dimensions.
+    /// \param add_over The number of bins added rightmost in all dimensions.
+    /// \param estimate The extended estimate of the entropy (lnG).
+    /// \param history The extended history.
+    /// \param binner If the binning is not even, a binner should also be passed.
+    /// \return True if the weights in the added bins have been set.
+    virtual bool extend_weights(DArray &lnw, const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over, const Estimate &estimate, const History &history, const Binner *binner=NULL) {
+        return false;
+    }
 };
 
 } // namespace Muninn
@@ -61,24 +61,25 @@ public:
         // and else
         //    lnk_i = lnk_{u-1} + ln( exp(lnk_{i-1} - lnG_i) )
 
-        // Make an itterator over the support
-        BArray::constwheretrueiterator it = lnG_support.get_constwheretrueiterator();
+        // Make an itterator over the bins with support
+        const std::vector<unsigned int> &support = estimate.get_lnG_support_index().get_indices();
+        std::vector<unsigned int>::const_iterator it = support.begin();
 
         // First check if there is any support
-        if(it()) {
+        if(it != support.end()) {
             // Calculate lnk_0 and set the weight
-            double lnk = lnG(it);
-            lnw(it) = -lnk;
+            double lnk = lnG(*it);
+            lnw(*it) = -lnk;
 
-            for (++it; it(); ++it) {
+            for (++it; it != support.end(); ++it) {
                 // Calculate lnk_i
-                if(lnG(it) > lnk)
-                    lnk = lnG(it) + log( exp(lnk-lnG(it)) + 1 );
+                if(lnG(*it) > lnk)
+                    lnk = lnG(*it) + log( exp(lnk-lnG(*it)) + 1 );
                 else
-                    lnk = lnk + log( 1 + exp(lnG(it)-lnk));
+                    lnk = lnk + log( 1 + exp(lnG(*it)-lnk));
 
                 // Set the weight
-                lnw(it) = -lnk;
+                lnw(*it) = -lnk;
             }
 
             // Shift the weights so that the bin with the maximal entropy has the
@@ -56,8 +56,10 @@ public:
         // Make an new array for the g-weights
         DArray lnw_g(lnG.get_shape());
 
-        for (BArray::constwheretrueiterator it = lnG_support.get_constwheretrueiterator(); it(); ++it) {
-            lnw_g(it) = - lnG(it);
+        const std::vector<unsigned int> &support = estimate.get_lnG_support_index().get_indices();
+
+        for (std::vector<unsigned int>::const_iterator it = support.begin(); it != support.end(); ++it) {
+            lnw_g(*it) = - lnG(*it);
         }
 
         if (binner && !binner->is_uniform()) {
@@ -78,24 +80,24 @@ public:
         // and else
         //    lnk_i = lnk_{u-1} + ln( exp(lnk_{i-1} - lnG_i) )
 
-        // Make an itterator over the support
-        BArray::constwheretrueiterator it = lnG_support.get_constwheretrueiterator();
+        // Make an itterator over the bins with support
+        std::vector<unsigned int>::const_iterator it = support.begin();
 
         // First check if there is any support
-        if(it()) {
+        if(it != support.end()) {
             // Calculate lnk_0 and set the weight
-            double lnk = lnG(it);
-            lnw_k(it) = -lnk;
+            double lnk = lnG(*it);
+            lnw_k(*it) = -lnk;
 
-            for (++it; it(); ++it) {
+            for (++it; it != support.end(); ++it) {
                 // Calculate lnk_i
-                if(lnG(it) > lnk)
-                    lnk = lnG(it) + log( exp(lnk-lnG(it)) + 1 );
+                if(lnG(*it) > lnk)
+                    lnk = lnG(*it) + log( exp(lnk-lnG(*it)) + 1 );
                 else
-                    lnk = lnk + log( 1 + exp(lnG(it)-lnk));
+                    lnk = lnk + log( 1 + exp(lnG(*it)-lnk));
 
                 // Set the weight and add the lnw_g log-weights
-                lnw_k(it) = - this->p * lnk + (1 - this->p) * lnw_g(it);
+                lnw_k(*it) = - this->p * lnk + (1 - this->p) * lnw_g(*it);
             }
 
             // Shift the weights so that the bin with the maximal entropy has the
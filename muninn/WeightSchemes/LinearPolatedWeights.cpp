@@ -45,7 +45,10 @@ DArray LinearPolatedWeigths::get_weights(const Estimate &estimate, const History
     const MultiHistogramHistory& history = MultiHistogramHistory::cast_from_base(base_history, "The LinearPolatedWeigths weight scheme is only compatible with an estimator that uses a MultiHistogramHistory.");
 
     // Check if there is any support, if not the extrapolation scheme set all weights uniformly
-    if (number_of_true(estimate.get_lnG_support()) == 0) {
+    has_weights = true;
+    has_support = !estimate.get_lnG_support_index().empty();
+
+    if (!has_support) {
         weights = 0.0;
     }
     else {
@@ -60,7 +63,7 @@ DArray LinearPolatedWeigths::get_weights(const Estimate &estimate, const History
         if (binner && !binner->is_uniform()) {
             DArray bin_centers = binner->get_binning_centered();
 
-            MLEutils::LinearPolator1d<DArray> linear_polator(weights, estimate.get_lnG_support(), sum_N, bin_centers, sigma);
+            MLEutils::LinearPolator1d<DArray> linear_polator(weights, estimate.get_lnG_support(), sum_N, bin_centers, sigma, &estimate.get_lnG_support_index());
             extrapolation_details = linear_polator.extrapolate(slope_factor_up, slope_factor_down, min_slope, max_slope, min_slope, max_slope);
             linear_polator.interpolate();
 
@@ -69,7 +72,7 @@ DArray LinearPolatedWeigths::get_weights(const Estimate &estimate, const History
             right_bound_center = bin_centers(extrapolation_details.second.first);
         }
         else {
-            MLEutils::LinearPolator1dUniform linear_polator(weights, estimate.get_lnG_support(), sum_N, sigma);
+            MLEutils::LinearPolator1dUniform linear_polator(weights, estimate.get_lnG_support(), sum_N, sigma, &estimate.get_lnG_support_index());
             extrapolation_details = linear_polator.extrapolate(slope_factor_up, slope_factor_down, min_slope, max_slope, min_slope, max_slope);
             linear_polator.interpolate();
 
@@ -165,6 +168,57 @@ DArray LinearPolatedWeigths::get_weights(const Estimate &estimate, const History
     return weights;
 }
 
+bool LinearPolatedWeigths::extend_weights(DArray &lnw, const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over, const Estimate &estimate, const History &history, const Binner *binner) {
+    if (!has_weights || lnw.get_shape().size()!=1)
+        return false;
+
+    unsigned int nbins = lnw.get_shape(0);
+    unsigned int first_over = nbins - add_over[0];
+
+    // Without support all weights are set uniformly
+    if (!has_support) {
+        for (unsigned int bin=0; bin<add_under[0]; ++bin)
+            lnw(bin) = 0.0;
+        for (unsigned int bin=first_over; bin<nbins; ++bin)
+            lnw(bin) = 0.0;
+        return true;
+    }
+
+    // Move the bounds of the extrapolation to the new bin indices
+    unsigned int &left_bin0 = extrapolation_details.first.first;
+    unsigned int &right_bin0 = extrapolation_details.second.first;
+    double left_slope = extrapolation_details.first.second;
+    double right_slope = extrapolation_details.second.second;
+
+    left_bin0 += add_under[0];
+    right_bin0 += add_under[0];
+
+    // Continue the extrapolation into the added bins, using the same
+    // coordinates as in get_weights()
+    if (binner && !binner->is_uniform()) {
+        left_bound_center = binner->get_bin_center(left_bin0);
+        right_bound_center = binner->get_bin_center(right_bin0);
+
+        for (unsigned int bin=0; bin<add_under[0]; ++bin)
+            lnw(bin) = lnw(left_bin0) + left_slope * (binner->get_bin_center(bin) - left_bound_center);
+        for (unsigned int bin=first_over; bin<nbins; ++bin)
+            lnw(bin) = lnw(right_bin0) + right_slope * (binner->get_bin_center(bin) - right_bound_center);
+    }
+    else {
+        for (unsigned int bin=0; bin<add_under[0]; ++bin)
+            lnw(bin) = lnw(left_bin0) + left_slope * (static_cast<double>(bin) - static_cast<double>(left_bin0));
+        for (unsigned int bin=first_over; bin<nbins; ++bin)
+            lnw(bin) = lnw(right_bin0) + right_slope * (static_cast<double>(bin) - static_cast<double>(right_bin0));
+
+        if (binner) {
+            left_bound_center = binner->get_bin_center(left_bin0);
+            right_bound_center = binner->get_bin_center(right_bin0);
+        }
+    }
+
+    return true;
+}
+
 double LinearPolatedWeigths::get_extrapolated_weight(double value, const DArray &lnw, const Estimate &estimate, const History &history, const Binner &binner) {
     int bin = binner.calc_bin(value);
 
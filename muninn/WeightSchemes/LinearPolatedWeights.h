@@ -117,7 +117,7 @@ public:
                 min_beta_extrapolation(min_beta_extrapolation), max_beta_extrapolation(max_beta_extrapolation),
                 min_beta_thermodynamics(min_beta_thermodynamics), max_beta_thermodynamics(max_beta_thermodynamics),
                 extrapolation_details(), left_bound_center(), right_bound_center(),
-                has_ownership(receives_ownership) {}
+                has_weights(false), has_support(false), has_ownership(receives_ownership) {}
 
     virtual ~LinearPolatedWeigths() {
         if (has_ownership) {
@@ -140,9 +140,38 @@ public:
     /// \return Weights according to the weight scheme.
     virtual DArray get_weights(const Estimate &estimate, const History &base_history, const Binner *binner=NULL);
 
+    /// This method sets the weights in the bins added by an extension, by
+    /// continuing the linear extrapolation used in the last call to
+    /// get_weights(), which is also the extrapolation used by
+    /// get_extrapolated_weight(). Only the added bins are visited. Since the
+    /// added bins have no support, the weights in the support are the same as
+    /// if get_weights() was called on the extended estimate, while the slopes
+    /// of the extrapolation are not refitted.
+    ///
+    /// \param lnw The extended weights, where the added bins are to be set.
+    /// \param add_under The number of bins added leftmost.
+    /// \param add_over The number of bins added rightmost.
+    /// \param estimate The extended estimate of the entropy (lnG).
+    /// \param history The extended history.
+    /// \param binner If the binning is not even, a binner should also be passed.
+    /// \return True if the weights in the added bins have been set.
+    virtual bool extend_weights(DArray &lnw, const std::vector<unsigned int> &add_under, const std::vector<unsigned int> &add_over, const Estimate &estimate, const History &history, const Binner *binner=NULL);
+
     // Implementation of ExtrapolatedWeightScheme interface (see base class for documentation).
     virtual double get_extrapolated_weight(double value, const DArray &lnw, const Estimate &estimate, const History &history, const Binner &binner);
 
+    // Implementation of ExtrapolatedWeightScheme interface (see base class for documentation).
+    virtual bool get_linear_extrapolation(const DArray &lnw, LinearExtrapolation &left, LinearExtrapolation &right) const {
+        left.center = left_bound_center;
+        left.lnw = lnw(extrapolation_details.first.first);
+        left.slope = extrapolation_details.first.second;
+
+        right.center = right_bound_center;
+        right.lnw = lnw(extrapolation_details.second.first);
+        right.slope = extrapolation_details.second.second;
+        return true;
+    }
+
     /// Set the minimal allowed beta value (negative slope) allowed for
     /// extrapolation. If the beta becomes smaller than this value it is
     /// capped at this value.
@@ -200,6 +229,8 @@ private:
     std::pair<std::pair<unsigned int, double>, std::pair<unsigned int, double> > extrapolation_details;  ///< The last used extrapolation details returned by MLEutils::LinearPolator1d::extrapolate.
     double left_bound_center;                ///< The center value for the left bound bin in the last extrapolation details (the center value of the bin extrapolation_details.first.first)
     double right_bound_center;               ///< The center value for the left bound bin in the last extrapolation details (the center value of the bin extrapolation_details.second.first)
+    bool has_weights;                        ///< Whether weights have been calculated by get_weights().
+    bool has_support;                        ///< Whether the estimate had any support in the last call to get_weights() (otherwise the weights are uniform).
 
     bool has_ownership;                      ///< Whether this object owns the underlying_weight_scheme object.
 
@@ -47,8 +47,12 @@ public:
         // in log space ln(w(E)) = -ln(g(E)) = ln(Delta(E) - ln(G(E)).
         DArray lnw(estimate.get_shape());
 
-        for (BArray::constwheretrueiterator it = estimate.get_lnG_support().get_constwheretrueiterator(); it(); ++it) {
-            lnw(it) = - estimate.get_lnG()(it);
+        const std::vector<unsigned int> &support = estimate.get_lnG_support_index().get_indices();
+        const double *lnG = estimate.get_lnG().get_array();
+        double *lnw_array = lnw.get_array();
+
+        for (std::vector<unsigned int>::const_iterator it = support.begin(); it != support.end(); ++it) {
+            lnw_array[*it] = - lnG[*it];
         }
 
         if (binner && !binner->is_uniform()) {
@@ -0,0 +1,202 @@
+// WeightSnapshot.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_WEIGHTSNAPSHOT_H_
+#define MUNINN_WEIGHTSNAPSHOT_H_
+
+#include "muninn/common.h"
+#include "muninn/WeightTable.h"
+#include "muninn/utils/threads.h"
+
+namespace Muninn {
+
+/// An immutable copy of the weights of a CGE object (see WeightTable). Since
+/// a snapshot is never changed, any number of threads can get weights from
+/// it concurrently. Snapshots are published by a WeightSnapshotPublisher and
+/// read through a WeightSnapshotReader.
+class WeightSnapshot {
+public:
+    /// Constructor.
+    ///
+    /// \param table The weights of the snapshot.
+    WeightSnapshot(const WeightTable &table) :
+        table(table), references(0), version(0) {}
+
+    /// Get the log weight for an energy.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \return The log weight for the energy.
+    inline double get_lnweights(double energy) const {
+        return table.get_lnweights(energy);
+    }
+
+    /// Get the version of the snapshot, which is set when it is published.
+    ///
+    /// \return The version number.
+    inline unsigned int get_version() const {return version;}
+
+    /// Get the weights of the snapshot.
+    ///
+    /// \return The weight table.
+    inline const WeightTable& get_weight_table() const {return table;}
+
+private:
+    const WeightTable table;     ///< The weights of the snapshot.
+
+    unsigned int references;     ///< The number of references to the snapshot (updated atomically).
+    unsigned int version;        ///< The version number of the snapshot.
+
+    friend class WeightSnapshotPublisher;
+};
+
+/// Class for publishing weight snapshots to reader threads. The publisher
+/// holds a reference to the latest published snapshot, and each
+/// WeightSnapshotReader holds a reference to the snapshot it uses. A snapshot
+/// is deleted when the last reference is released.
+///
+/// Publishing and acquiring a snapshot takes a short lock, but readers only
+/// acquire a snapshot when the version has changed. In between, reading a
+/// weight only requires an atomic read of the version.
+class WeightSnapshotPublisher {
+public:
+    /// Constructor.
+    WeightSnapshotPublisher() : snapshot(NULL), version(0) {}
+
+    /// Destructor, which releases the reference to the latest snapshot.
+    ~WeightSnapshotPublisher() {
+        release(snapshot);
+    }
+
+    /// Publish a new snapshot. The publisher takes ownership of the snapshot.
+    ///
+    /// \param new_snapshot The snapshot to publish.
+    void publish(WeightSnapshot *new_snapshot) {
+        new_snapshot->references = 1;
+
+        mutex.lock();
+        WeightSnapshot *old_snapshot = snapshot;
+        new_snapshot->version = version+1;
+        snapshot = new_snapshot;
+        atomic_write(version, new_snapshot->version);
+        mutex.unlock();
+
+        release(old_snapshot);
+    }
+
+    /// Acquire a reference to the latest snapshot. The reference must be
+    /// released with release().
+    ///
+    /// \return The latest snapshot (NULL if none has been published).
+    const WeightSnapshot* acquire() const {
+        mutex.lock();
+        WeightSnapshot *acquired = snapshot;
+        if (acquired)
+            atomic_increment(acquired->references);
+        mutex.unlock();
+
+        return acquired;
+    }
+
+    /// Release a reference to a snapshot.
+    ///
+    /// \param released The snapshot to release (may be NULL).
+    static void release(const WeightSnapshot *released) {
+        if (released && atomic_decrement(const_cast<WeightSnapshot*>(released)->references) == 0)
+            delete released;
+    }
+
+    /// Get the version of the latest snapshot.
+    ///
+    /// \return The version number (zero if no snapshot has been published).
+    inline unsigned int get_version() const {
+        return atomic_read(version);
+    }
+
+private:
+    WeightSnapshot *snapshot;    ///< The latest published snapshot.
+    unsigned int version;        ///< The version of the latest published snapshot (updated atomically).
+    mutable Mutex mutex;         ///< Lock protecting the snapshot pointer.
+
+    /// The publisher cannot be copied.
+    WeightSnapshotPublisher(const WeightSnapshotPublisher &);
+
+    /// The publisher cannot be assigned.
+    WeightSnapshotPublisher& operator=(const WeightSnapshotPublisher &);
+};
+
+/// A reader of weight snapshots for a single thread. The reader holds a
+/// reference to a snapshot and switches to the latest published snapshot,
+/// when it is out of date.
+class WeightSnapshotReader {
+public:
+    /// Constructor.
+    ///
+    /// \param publisher The publisher to read snapshots from.
+    WeightSnapshotReader(const WeightSnapshotPublisher &publisher) :
+        publisher(publisher), snapshot(publisher.acquire()) {}
+
+    /// Destructor, which releases the reference to the snapshot.
+    ~WeightSnapshotReader() {
+        WeightSnapshotPublisher::release(snapshot);
+    }
+
+    /// Get the log weight for an energy using the latest published snapshot.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \return The log weight for the energy.
+    inline double get_lnweights(double energy) {
+        refresh();
+        return snapshot->get_lnweights(energy);
+    }
+
+    /// Switch to the latest published snapshot, if the current is out of date.
+    inline void refresh() {
+        if (snapshot==NULL || snapshot->get_version() != publisher.get_version()) {
+            WeightSnapshotPublisher::release(snapshot);
+            snapshot = publisher.acquire();
+
+            if (snapshot==NULL)
+                throw MessageException("No weight snapshot has been published.");
+        }
+    }
+
+    /// Get the snapshot currently used by the reader. Note that the snapshot
+    /// is not refreshed by this call.
+    ///
+    /// \return The current snapshot.
+    inline const WeightSnapshot& get_snapshot() const {return *snapshot;}
+
+private:
+    const WeightSnapshotPublisher &publisher;  ///< The publisher snapshots are read from.
+    const WeightSnapshot *snapshot;            ///< The snapshot currently used.
+
+    /// The reader cannot be copied.
+    WeightSnapshotReader(const WeightSnapshotReader &);
+
+    /// The reader cannot be assigned.
+    WeightSnapshotReader& operator=(const WeightSnapshotReader &);
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_WEIGHTSNAPSHOT_H_ */
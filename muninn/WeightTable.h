@@ -0,0 +1,169 @@
+// WeightTable.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_WEIGHTTABLE_H_
+#define MUNINN_WEIGHTTABLE_H_
+
+#include <limits>
+
+#include "muninn/common.h"
+#include "muninn/utils/TArray.h"
+#include "muninn/utils/BinLookupIndex.h"
+#include "muninn/ExtrapolatedWeightScheme.h"
+
+namespace Muninn {
+
+/// A flat table of the weights of a CGE object, containing the bin edges,
+/// the log weights and the linear extrapolation of the weights outside the
+/// binned area. All functions are inline and non-virtual, so the table is
+/// suited for the inner loop of a Metropolis-Hastings sampler. The table is
+/// a copy, so it must be fetched again from the CGE object (see
+/// CGE::get_weight_table()) when the weights have been updated.
+///
+/// For a Metropolis-Hastings step the bin of the current state can be cached,
+/// such that only the new energy must be looked up:
+/// \code
+/// int bin_new;
+/// double delta = table.delta(energy_new, energy_old, bin_old, bin_new);
+/// if (accept(delta)) { energy_old = energy_new; bin_old = bin_new; }
+/// \endcode
+/// Note that the bins change when the binning is extended, so the cached bin
+/// must be recalculated with calc_bin() when the table has been rebuilt,
+/// which can be detected from the version of the table.
+class WeightTable {
+public:
+    /// Constructor for a table of Boltzmann weights, \f$ \ln w(E) = -\beta E \f$.
+    ///
+    /// \param beta The beta value of the weights.
+    /// \param version The version number of the table.
+    WeightTable(double beta=0.0, unsigned int version=0) :
+        binning(0), lnw(0), nbins(0), beta(beta), boltzmann(true), extrapolated(false), version(version) {
+        left.center = left.lnw = left.slope = 0.0;
+        right = left;
+    }
+
+    /// Constructor for a table of binned weights.
+    ///
+    /// \param binning The edges of the bins.
+    /// \param lnw The log weights of the bins.
+    /// \param extrapolated Whether the weights are extrapolated linearly
+    ///                     outside the binned area. If not, the log weight
+    ///                     outside the binned area is minus infinity, so
+    ///                     moves out of the binned area are rejected.
+    /// \param left The extrapolation below the binned area.
+    /// \param right The extrapolation above the binned area.
+    /// \param version The version number of the table.
+    WeightTable(const DArray &binning, const DArray &lnw, bool extrapolated,
+                const ExtrapolatedWeightScheme::LinearExtrapolation &left,
+                const ExtrapolatedWeightScheme::LinearExtrapolation &right,
+                unsigned int version=0) :
+        binning(binning), lnw(lnw), nbins(lnw.get_asize()), beta(0.0), boltzmann(false), extrapolated(extrapolated),
+        left(left), right(right), version(version) {
+        assert(binning.get_asize() == lnw.get_asize()+1);
+        lookup_index.build(this->binning);
+    }
+
+    /// Calculate the bin of an energy.
+    ///
+    /// \param energy The energy.
+    /// \return The bin index, which is negative or equal to the number of
+    ///         bins for energies outside the binned area (and always zero
+    ///         for Boltzmann weights).
+    inline int calc_bin(double energy) const {
+        return boltzmann ? 0 : lookup_index.lookup(binning.get_array(), energy);
+    }
+
+    /// Get the log weight for an energy.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \return The log weight for the energy.
+    inline double get_lnweights(double energy) const {
+        return get_lnweights(energy, calc_bin(energy));
+    }
+
+    /// Get the log weight for an energy, which bin is already known.
+    ///
+    /// \param energy The energy to get a weight for.
+    /// \param bin The bin of the energy (see calc_bin()).
+    /// \return The log weight for the energy.
+    inline double get_lnweights(double energy, int bin) const {
+        if (boltzmann)
+            return -beta * energy;
+        else if (0<=bin && bin<nbins)
+            return lnw(bin);
+        else if (!extrapolated)
+            return -std::numeric_limits<double>::infinity();
+        else if (bin < 0)
+            return left.lnw + left.slope*(energy - left.center);
+        else
+            return right.lnw + right.slope*(energy - right.center);
+    }
+
+    /// Calculate the difference in log weight between a new energy and the
+    /// energy of the current state, \f$ \ln w(E_\mathrm{new}) - \ln w(E_\mathrm{old}) \f$,
+    /// using the cached bin of the current state.
+    ///
+    /// \param energy_new The new energy.
+    /// \param energy_old The energy of the current state.
+    /// \param bin_old The bin of the current state.
+    /// \param bin_new Returns the bin of the new energy.
+    /// \return The difference in log weight.
+    inline double delta(double energy_new, double energy_old, int bin_old, int &bin_new) const {
+        bin_new = calc_bin(energy_new);
+        return get_lnweights(energy_new, bin_new) - get_lnweights(energy_old, bin_old);
+    }
+
+    /// Get the version number of the table. The CGE object increases the
+    /// version each time the table is rebuilt.
+    ///
+    /// \return The version number.
+    inline unsigned int get_version() const {return version;}
+
+    /// Get the edges of the bins.
+    ///
+    /// \return The bin edges (empty for Boltzmann weights).
+    inline const DArray& get_binning() const {return binning;}
+
+    /// Get the log weights of the bins.
+    ///
+    /// \return The log weights (empty for Boltzmann weights).
+    inline const DArray& get_lnw() const {return lnw;}
+
+private:
+    DArray binning;              ///< The edges of the bins.
+    DArray lnw;                  ///< The log weights of the bins.
+    int nbins;                   ///< The number of bins.
+    BinLookupIndex lookup_index; ///< Index for looking up the bin of an energy.
+
+    double beta;                 ///< The beta value for Boltzmann weights.
+    bool boltzmann;              ///< Whether the table contains Boltzmann weights.
+    bool extrapolated;           ///< Whether the weights are extrapolated outside the binned area.
+    ExtrapolatedWeightScheme::LinearExtrapolation left;   ///< The extrapolation below the binned area.
+    ExtrapolatedWeightScheme::LinearExtrapolation right;  ///< The extrapolation above the binned area.
+
+    unsigned int version;        ///< The version number of the table.
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_WEIGHTTABLE_H_ */
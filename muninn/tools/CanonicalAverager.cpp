@@ -60,13 +60,13 @@ std::vector<double> CanonicalAverager::calculate_weights(const std::vector<doubl
     BArray support = histogram_support && lnG_support;
     DArray binning = binner.get_binning_centered();
 
-    DArray summands(nbins);
+    LogSumExpAccumulator accumulator;
 
     for (BArray::constwheretrueiterator it = support.get_constwheretrueiterator(); it(); ++it) {
-        summands(it) = lnG(it) - beta*binning(it);
+        accumulator.add(lnG(it) - beta*binning(it));
     }
 
-    double lnZ_beta = log_sum_exp(summands, support);
+    double lnZ_beta = accumulator.get_result();
 
     // Now calculate the probability for each bin according to the canonical ensemble
     DArray P_beta(nbins);
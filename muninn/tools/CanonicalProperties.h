@@ -25,6 +25,7 @@
 #define MUNINN_CANONICAL_PROPERTIES_H_
 
 #include <cmath>
+#include <vector>
 
 #include "muninn/utils/TArray.h"
 #include "muninn/utils/TArrayMath.h"
@@ -61,7 +62,12 @@ public:
     /// \param beta The beta value to calculate the partition function at.
     /// \return The log of the partition function at beta, \f$ ln(Z_\beta) \f$.
     inline double lnZ (double beta) {
-        return log_sum_exp(*lnG - *energies*beta, *lnG_support);
+        LogSumExpAccumulator accumulator;
+
+        for (BArray::constwheretrueiterator it = lnG_support->get_constwheretrueiterator(); it(); ++it)
+            accumulator.add((*lnG)(it) - (*energies)(it)*beta);
+
+        return accumulator.get_result();
     }
 
     /// Calculates the partition function at a given beta value. The partition
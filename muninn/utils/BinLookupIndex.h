@@ -0,0 +1,139 @@
+// BinLookupIndex.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_BINLOOKUPINDEX_H_
+#define MUNINN_BINLOOKUPINDEX_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "muninn/utils/TArray.h"
+
+namespace Muninn {
+
+/// An acceleration index for finding the bin of a value in a sorted array of
+/// bin edges. The range spanned by the edges is divided into a uniform grid
+/// of buckets, and for each bucket the index stores the first bin that can
+/// contain a value in the bucket. A lookup maps the value to its bucket in
+/// constant time and then scans the few bins that start within the bucket.
+///
+/// The lookup returns exactly the same bin as a binary search with
+/// std::upper_bound, also for values on the edges. Since the bucket of a
+/// value is a monotone function of the value, the result does not depend on
+/// rounding in the bucket calculation.
+///
+/// The index does not own the edges, which are passed to lookup(). The index
+/// must be rebuilt (by calling build()) whenever the edges are changed.
+class BinLookupIndex {
+public:
+    /// Default constructor, which creates an empty index.
+    BinLookupIndex() : nedges(0), nbuckets(0), min_value(0), max_value(0), inv_bucket_width(0), first_bin() {}
+
+    /// Build the index for a set of bin edges.
+    ///
+    /// \param binning The sorted edges of the bins.
+    void build(const DArray &binning) {
+        const double *edges = binning.get_array();
+        nedges = binning.get_asize();
+        first_bin.clear();
+        nbuckets = 0;
+
+        if (nedges < 2 || !(binning(0) < binning(nedges-1)))
+            return;
+
+        // Use one bucket per bin
+        nbuckets = nedges-1;
+        min_value = edges[0];
+        max_value = edges[nedges-1];
+        inv_bucket_width = nbuckets/(max_value-min_value);
+
+        // For each bucket find the last bin starting in a previous bucket,
+        // which is the lowest bin that can contain a value in the bucket
+        first_bin.resize(nbuckets+1);
+        unsigned int bin = 0;
+
+        for (unsigned int bucket=0; bucket <= nbuckets; ++bucket) {
+            while (bin+1 < nedges-1 && calc_bucket(edges[bin+1]) < bucket)
+                ++bin;
+            first_bin[bucket] = bin;
+        }
+    }
+
+    /// Calculate the bin index for a value. The result is identical to
+    /// std::upper_bound(edges, edges+nedges, value) - edges - 1.
+    ///
+    /// \param edges The edges used for building the index.
+    /// \param value The value to look up.
+    /// \return The bin index, which is negative if the value is below the
+    ///         binned region and equal to the number of bins if the value is
+    ///         on or above the upper edge.
+    inline int lookup(const double *edges, double value) const {
+        if (nbuckets == 0)
+            return static_cast<int>(std::upper_bound(edges, edges+nedges, value)-edges) - 1;
+
+        // This also maps NaN to the upper end, as std::upper_bound does
+        if (!(value < max_value))
+            return static_cast<int>(nedges) - 1;
+
+        if (value < min_value)
+            return -1;
+
+        // Scan the bins starting in the bucket of the value
+        unsigned int bucket = calc_bucket(value);
+        unsigned int bin = first_bin[bucket];
+        unsigned int last = first_bin[bucket+1];
+
+        if (last-bin > max_scan)
+            return static_cast<int>(std::upper_bound(edges+bin+1, edges+last+1, value)-edges) - 1;
+
+        while (edges[bin+1] <= value)
+            ++bin;
+
+        return static_cast<int>(bin);
+    }
+
+private:
+    /// The maximal number of bins scanned linearly in a bucket, before
+    /// falling back to a binary search.
+    static const unsigned int max_scan = 8;
+
+    /// Calculate the bucket of a value in the binned region.
+    ///
+    /// \param value The value, which must be in the binned region.
+    /// \return The bucket index.
+    inline unsigned int calc_bucket(double value) const {
+        unsigned int bucket = static_cast<unsigned int>((value-min_value)*inv_bucket_width);
+        return std::min(bucket, nbuckets-1);
+    }
+
+    unsigned int nedges;               ///< The number of bin edges.
+    unsigned int nbuckets;             ///< The number of buckets (zero if the index is not used).
+    double min_value;                  ///< The lower edge of the binned region.
+    double max_value;                  ///< The upper edge of the binned region.
+    double inv_bucket_width;           ///< The inverse width of a bucket.
+    std::vector<unsigned int> first_bin; ///< For each bucket the lowest bin that can contain a value in the bucket.
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_BINLOOKUPINDEX_H_ */
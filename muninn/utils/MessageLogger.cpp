@@ -22,9 +22,19 @@
 // specific prior written permission.
 
 #include <muninn/utils/MessageLogger.h>
+#include <muninn/utils/threads.h>
 
 namespace Muninn {
 
 MessageLogger MessageLogger::logger;
 
+/// The lock shared by all loggers when writing messages.
+static Mutex message_mutex;
+
+void MessageLogger::write(std::ostream &stream, const char *prefix, const std::string &message) {
+    message_mutex.lock();
+    stream << prefix << message << std::endl;
+    message_mutex.unlock();
+}
+
 } // namespace Muninn
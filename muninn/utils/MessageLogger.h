@@ -81,7 +81,7 @@ public:
     /// \param message The debug message.
     void debug(std::string message) {
         if (debug_stream)
-            (*debug_stream) << "# MUNINN DEBUG: " << message << std::endl;
+            write(*debug_stream, "# MUNINN DEBUG: ", message);
     }
 
     /// Write a information message to the information stream.
@@ -89,7 +89,7 @@ public:
     /// \param message The information message.
     void info(std::string message) {
         if (info_stream)
-            (*info_stream) << "# MUNINN: " << message << std::endl;
+            write(*info_stream, "# MUNINN: ", message);
     }
 
     /// Write a warning message to the warning stream.
@@ -97,7 +97,7 @@ public:
     /// \param message The warning message.
     void warning(std::string message) {
         if (warning_stream)
-            (*warning_stream) << "# MUNINN WARNING: " << message << std::endl;
+            write(*warning_stream, "# MUNINN WARNING: ", message);
     }
 
     /// Write a error message to the error stream.
@@ -105,11 +105,12 @@ public:
     /// \param message The error message.
     void error(std::string message) {
         if (error_stream)
-            (*error_stream) << "# MUNINN ERROR: " << message << std::endl;
+            write(*error_stream, "# MUNINN ERROR: ", message);
     }
 
-    /// Static function of accessing a global MessageLogger. Note that
-    /// accessing this global logger is not thread safe!
+    /// Static function of accessing a global MessageLogger. Messages can be
+    /// written from several threads, but the streams must not be changed
+    /// while other threads are writing.
     ///
     /// \return A reference to a global MessageLogger
     static MessageLogger& get() {
@@ -123,6 +124,15 @@ private:
     std::ostream *error_stream;    ///< The stream used for error messages.
 
     static MessageLogger logger;   ///< A global MessageLogger.
+
+    /// Write a message to a stream. The messages of all loggers are written
+    /// under a common lock, so messages written by different threads (e.g.
+    /// by an estimator running concurrently with the sampling) are not mixed.
+    ///
+    /// \param stream The stream to write to.
+    /// \param prefix The prefix of the message.
+    /// \param message The message.
+    static void write(std::ostream &stream, const char *prefix, const std::string &message);
 };
 
 } // namespace Muninn
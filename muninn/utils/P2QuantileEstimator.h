@@ -0,0 +1,175 @@
+// P2QuantileEstimator.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_P2QUANTILEESTIMATOR_H_
+#define MUNINN_P2QUANTILEESTIMATOR_H_
+
+#include <algorithm>
+#include <cassert>
+
+#include "muninn/common.h"
+
+namespace Muninn {
+
+/// A streaming estimator of a quantile, based on the P-square algorithm of
+/// Jain and Chlamtac (Communications of the ACM 28, 1076-1085, 1985). The
+/// estimator uses five markers, whose heights are adjusted by piecewise
+/// parabolic interpolation as observations are added, and accordingly it
+/// uses constant memory and constant time per observation. The estimate is
+/// exact until five observations have been added.
+class P2QuantileEstimator {
+public:
+    /// Constructor.
+    ///
+    /// \param fraction The fraction, \f$ 0<p<1 \f$, of the quantile to estimate.
+    P2QuantileEstimator(double fraction) : fraction(fraction), count(0) {
+        assert(0.0<fraction && fraction<1.0);
+
+        increments[0] = 0.0;
+        increments[1] = fraction/2.0;
+        increments[2] = fraction;
+        increments[3] = (1.0+fraction)/2.0;
+        increments[4] = 1.0;
+    }
+
+    /// Add an observation to the estimator.
+    ///
+    /// \param value The value to add.
+    inline void add(double value) {
+        // The first five observations are stored in the markers
+        if (count < 5) {
+            heights[count++] = value;
+
+            if (count==5) {
+                std::sort(heights, heights+5);
+                for (unsigned int i=0; i<5; ++i) {
+                    positions[i] = i;
+                    desired[i] = 4.0*increments[i];
+                }
+            }
+            return;
+        }
+        ++count;
+
+        // Find the cell of the value, and update the extreme markers
+        unsigned int k;
+        if (value < heights[0]) {
+            heights[0] = value;
+            k = 0;
+        }
+        else if (value >= heights[4]) {
+            heights[4] = value;
+            k = 3;
+        }
+        else {
+            k = 0;
+            while (value >= heights[k+1])
+                ++k;
+        }
+
+        // Update the positions of the markers
+        for (unsigned int i=k+1; i<5; ++i)
+            positions[i] += 1.0;
+        for (unsigned int i=0; i<5; ++i)
+            desired[i] += increments[i];
+
+        // Adjust the heights of the middle markers, if they are off
+        for (unsigned int i=1; i<4; ++i) {
+            double d = desired[i] - positions[i];
+
+            if ((d >= 1.0 && positions[i+1]-positions[i] > 1.0) ||
+                (d <= -1.0 && positions[i-1]-positions[i] < -1.0)) {
+                int sign = (d >= 0.0) ? 1 : -1;
+                double height = parabolic(i, sign);
+
+                if (heights[i-1] < height && height < heights[i+1])
+                    heights[i] = height;
+                else
+                    heights[i] = linear(i, sign);
+
+                positions[i] += sign;
+            }
+        }
+    }
+
+    /// Get the estimate of the quantile. Until five observations have been
+    /// added the estimate is the exact quantile, found as the value with
+    /// index \f$ \lfloor p n \rfloor \f$ among the \f$ n \f$ sorted values.
+    ///
+    /// \return The estimate of the quantile.
+    inline double get_quantile() const {
+        assert(count>0);
+
+        if (count < 5) {
+            double values[5];
+            std::copy(heights, heights+count, values);
+            std::sort(values, values+count);
+            return values[static_cast<unsigned int>(fraction*count)];
+        }
+
+        return heights[2];
+    }
+
+    /// Get the number of observations added to the estimator.
+    ///
+    /// \return The number of observations.
+    inline Count get_count() const {
+        return count;
+    }
+
+private:
+    double fraction;       ///< The fraction of the quantile.
+    Count count;           ///< The number of observations added.
+
+    double heights[5];     ///< The heights of the markers.
+    double positions[5];   ///< The actual positions of the markers.
+    double desired[5];     ///< The desired positions of the markers.
+    double increments[5];  ///< The increments of the desired positions per observation.
+
+    /// Piecewise parabolic prediction of the height of a marker, when it is
+    /// moved one position.
+    ///
+    /// \param i The index of the marker.
+    /// \param d The direction of the move (-1 or 1).
+    /// \return The predicted height.
+    inline double parabolic(unsigned int i, int d) const {
+        return heights[i] + d/(positions[i+1]-positions[i-1]) *
+               ((positions[i]-positions[i-1]+d)*(heights[i+1]-heights[i])/(positions[i+1]-positions[i]) +
+                (positions[i+1]-positions[i]-d)*(heights[i]-heights[i-1])/(positions[i]-positions[i-1]));
+    }
+
+    /// Linear prediction of the height of a marker, when it is moved one
+    /// position.
+    ///
+    /// \param i The index of the marker.
+    /// \param d The direction of the move (-1 or 1).
+    /// \return The predicted height.
+    inline double linear(unsigned int i, int d) const {
+        return heights[i] + d*(heights[i+d]-heights[i])/(positions[i+d]-positions[i]);
+    }
+};
+
+} // namespace Muninn
+
+#endif /* MUNINN_P2QUANTILEESTIMATOR_H_ */
@@ -103,6 +103,9 @@ void StatisticsLogReader::read(std::istream& input) {
                      if (max_hist>0 && x_zeros_string.size()>max_hist)
                          x_zeros_string.pop_front();
                  }
+                else if (name.substr(0,12)=="out_of_range") {
+                    // The out-of-range counters are not used for restoring the history
+                }
                 else {
                     MessageLogger::get().warning("When reading statistics log, found unknown identifier \"" + name + "\" at line " + to_string(line_counter) + ".");
                 }
@@ -180,6 +180,9 @@ public:
     TArray<T> extended(Index add_under_1, Index add_under_2, Index add_over_1, Index add_over_2) const;
     TArray<T> extended(const std::vector<Index> &add_under, const std::vector<Index> &add_over) const;
 
+    void extend(Index add_under, Index add_over);
+    void extend(const std::vector<Index> &add_under, const std::vector<Index> &add_over);
+
     // Iterators
     typedef TArrayFlatIterator<TArray<T>, T> flatiterator;
     typedef TArrayReverseFlatIterator<TArray<T>, T> reverseflatiterator;
@@ -224,8 +227,11 @@ private:
     Index *shape;          ///< The shape of the TArray.
     Index *stride;         ///< The distance between elements in each dimension in the internal array..
     bool array_ownership;  ///< Weather the object owns memory allocated for the internal array.
+    Index padding_under;   ///< The number of unused elements allocated before the internal array (only 1-dimensional arrays).
+    Index padding_over;    ///< The number of unused elements allocated after the internal array (only 1-dimensional arrays).
 
     // Private methods
+    inline void free_array();
     template<typename U> inline void duplicate_shape(const TArray<U> &right);
     template<typename U> void assert_same_size(const TArray<U> &other) const throw(TArrayMismatchSizeException);
 
@@ -239,13 +245,13 @@ private:
 /// \fn TArray<T>::TArray()
 /// Default constructor.
 template<typename T>
-TArray<T>::TArray() : array(NULL), asize(0), ndims(0), shape(NULL), stride(NULL), array_ownership(true) {}
+TArray<T>::TArray() : array(NULL), asize(0), ndims(0), shape(NULL), stride(NULL), array_ownership(true), padding_under(0), padding_over(0) {}
 
 /// Constructor for a 1-dimensional array.
 ///
 /// \param dim1 The size of the first dimension.
 template<typename T>
-TArray<T>::TArray(Index dim1) : array(NULL), asize(dim1), ndims(1), shape(NULL), stride(NULL), array_ownership(true) {
+TArray<T>::TArray(Index dim1) : array(NULL), asize(dim1), ndims(1), shape(NULL), stride(NULL), array_ownership(true), padding_under(0), padding_over(0) {
     //assert(dim1>0);
     try {
         array = new T[asize];
@@ -270,7 +276,7 @@ TArray<T>::TArray(Index dim1) : array(NULL), asize(dim1), ndims(1), shape(NULL),
 /// \param dim1 The size of the first dimension.
 /// \param dim2 The size of the second dimension.
 template<typename T>
-TArray<T>::TArray(Index dim1, Index dim2) : array(NULL), asize(dim1*dim2), ndims(2), shape(NULL), stride(NULL), array_ownership(true) {
+TArray<T>::TArray(Index dim1, Index dim2) : array(NULL), asize(dim1*dim2), ndims(2), shape(NULL), stride(NULL), array_ownership(true), padding_under(0), padding_over(0) {
     //assert(dim1>0 && dim2>0);
     try {
         array = new T[asize];
@@ -297,7 +303,7 @@ TArray<T>::TArray(Index dim1, Index dim2) : array(NULL), asize(dim1*dim2), ndims
 ///
 /// \param newshape The shape of the array.
 template<typename T>
-TArray<T>::TArray(const std::vector<Index> &newshape) : array(NULL), asize(1), ndims(newshape.size()), shape(NULL), stride(NULL), array_ownership(true) {
+TArray<T>::TArray(const std::vector<Index> &newshape) : array(NULL), asize(1), ndims(newshape.size()), shape(NULL), stride(NULL), array_ownership(true), padding_under(0), padding_over(0) {
     assert(newshape.size()>0);
 
     try {
@@ -336,7 +342,7 @@ TArray<T>::TArray(const std::vector<Index> &newshape) : array(NULL), asize(1), n
 /// \param newshape The shape of the array.
 /// \param storage The C-style array that is to be wrapped.
 template<typename T>
-TArray<T>::TArray(const std::vector<Index> &newshape, T *storage) : array(storage), asize(1), ndims(newshape.size()), shape(NULL), stride(NULL), array_ownership(false) {
+TArray<T>::TArray(const std::vector<Index> &newshape, T *storage) : array(storage), asize(1), ndims(newshape.size()), shape(NULL), stride(NULL), array_ownership(false), padding_under(0), padding_over(0) {
     assert(newshape.size()>0);
 
     try {
@@ -360,7 +366,7 @@ TArray<T>::TArray(const std::vector<Index> &newshape, T *storage) : array(storag
 ///
 /// \param right The array to be copied.
 template<typename T>
-TArray<T>::TArray(const TArray<T> &right) : array(NULL), asize(0), ndims(0), shape(NULL), stride(NULL), array_ownership(true) {
+TArray<T>::TArray(const TArray<T> &right) : array(NULL), asize(0), ndims(0), shape(NULL), stride(NULL), array_ownership(true), padding_under(0), padding_over(0) {
     duplicate_shape(right);
     for (Index i = 0; i < asize; i++)
         array[i] = right.array[i];
@@ -371,8 +377,7 @@ TArray<T>::TArray(const TArray<T> &right) : array(NULL), asize(0), ndims(0), sha
 /// the internal array.
 template<typename T>
 TArray<T>::~TArray() {
-    if (array_ownership)
-        delete[] array;
+    free_array();
     delete[] shape;
     delete[] stride;
 }
@@ -475,8 +480,7 @@ inline const TArray<T>& TArray<T>::operator=(const TArray<T> &right) {
         // Check if they have same shape and copy shape if they differ
         if (!same_shape(right)) {
             // Delete the old arrays
-            if (array_ownership)
-                delete[] array;
+            free_array();
             delete[] shape;
             delete[] stride;
 
@@ -1328,6 +1332,76 @@ TArray<T> TArray<T>::extended(const std::vector<Index> &add_under, const std::ve
     }
 }
 
+/// Extend (resize) a 1-dimensional array in place. The new elements are set
+/// to zero. The array is allocated with unused padding on the sides where
+/// it has been extended, so that the array is only reallocated when the
+/// padding is exhausted. When reallocated, the padding on the extended side
+/// is set to the new size of the array, which makes the amortized cost of
+/// repeated extensions proportional to the number of elements added.
+///
+/// \param add_under The number of bins to add below index 0.
+/// \param add_over The number of bins to add above the size of the array.
+template<typename T>
+void TArray<T>::extend(Index add_under, Index add_over) {
+    // Assert that he array is one dimensional
+    assert(ndims==1);
+
+    Index new_size = add_under + asize + add_over;
+
+    // Reallocate the array, if the padding is too small
+    if (add_under > padding_under || add_over > padding_over || !array_ownership) {
+        Index new_padding_under = (add_under > 0) ? new_size : padding_under;
+        Index new_padding_over = (add_over > 0) ? new_size : padding_over;
+
+        T *new_storage = new T[new_padding_under + new_size + new_padding_over];
+        T *new_array = new_storage + new_padding_under;
+
+        for (Index i=0; i<asize; i++) {
+            new_array[add_under+i] = array[i];
+        }
+
+        free_array();
+        array = new_array;
+        padding_under = new_padding_under;
+        padding_over = new_padding_over;
+        array_ownership = true;
+    }
+    // Else, just move the beginning of the array into the padding
+    else {
+        array -= add_under;
+        padding_under -= add_under;
+        padding_over -= add_over;
+    }
+
+    // Set the new elements to zero
+    for (Index i=0; i<add_under; i++) {
+        array[i] = 0;
+    }
+    for (Index i=add_under+asize; i<new_size; i++) {
+        array[i] = 0;
+    }
+
+    asize = new_size;
+    shape[0] = new_size;
+}
+
+/// Extend (resize) a multidimensional array in place. For 1-dimensional
+/// arrays this is done using padding (see extend(Index, Index)), while
+/// arrays with more dimensions are reallocated.
+///
+/// \param add_under The number of bins to add in each dimension below index 0.
+/// \param add_over The number of bins to add in each dimension above the array size in the given dimension.
+template<typename T>
+void TArray<T>::extend(const std::vector<Index> &add_under, const std::vector<Index> &add_over) {
+    assert(add_under.size() == ndims);
+    assert(add_over.size() == ndims);
+
+    if (ndims==1)
+        extend(add_under[0], add_over[0]);
+    else
+        *this = extended(add_under, add_over);
+}
+
 /// Get a flat iterator over the array.
 ///
 /// \return A flat iterator.
@@ -1400,8 +1474,7 @@ template<typename T>
 inline void TArray<T>::reset_shape(const std::vector<Index> &newshape) {
     assert(newshape.size()>0);
 
-    if (array_ownership)
-        delete[] array;
+    free_array();
     delete[] shape;
     delete[] stride;
 
@@ -1441,6 +1514,18 @@ inline void TArray<T>::reset_shape(const std::vector<Index> &newshape) {
     set_all_zero();
 }
 
+/// Free the internal array including the padding, if the array is owned by
+/// the object.
+template<typename T>
+inline void TArray<T>::free_array() {
+    if (array_ownership)
+        delete[] (array-padding_under);
+
+    array = NULL;
+    padding_under = 0;
+    padding_over = 0;
+}
+
 /// Set the shape of the array to be the same as another array.
 ///
 /// Note that the internal array and additional arrays are not freed.
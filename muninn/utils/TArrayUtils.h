@@ -26,54 +26,241 @@
 
 #include <math.h>
 #include <limits>
+#include <vector>
+#include <cassert>
+#include <cstddef>
 
 #include "muninn/common.h"
 #include "muninn/utils/TArray.h"
 
 namespace Muninn {
 
-/// Calculate the log-sum-exp of an array. That is, if you want to
-/// calculate \f$ \ln \sum_i \exp(x_i) \f$, you can rewrite the expression as
+/// An online calculation of the log-sum-exp of a sequence of values. That
+/// is, if you want to calculate \f$ \ln \sum_i \exp(x_i) \f$, you can
+/// rewrite the expression as
 /// \f[
 ///     \ln \sum_i \exp(x_i) = x_\textrm{max} + \ln \sum_i \exp(x_i-x_\textrm{max}),
 /// \f]
 /// where \f$ x_\textrm{max} = \max_i(x_i) \f$. We will call \f$ \{x_i\} \f$
 /// for the summands.
 ///
-/// \param summands The summands to calculate the log-sum-exp of.
-/// \return The log-sum-exp value.
-inline double log_sum_exp(const DArray &summands) {
-    // Determine max of values
-    double max = summands.max();
+/// The summands are processed in blocks of BLOCK_SIZE values. The maximum is
+/// maintained online; whenever a block raises the running maximum, the
+/// partial sum is rescaled accordingly. The inner loops are branch free and
+/// work on contiguous memory, so that they can be vectorized by the compiler.
+/// Summands equal to minus infinity contribute with zero to the sum.
+///
+/// The summands are either given as contiguous blocks using add_block(), or
+/// one at a time using add(), in which case they are gathered in a fixed
+/// size internal buffer. The two ways should not be mixed.
+///
+/// The exponentials are evaluated with the exp of the standard library. The
+/// loops are left for the compiler to vectorize, since the bundled version of
+/// Eigen only has a vectorized exp in single precision.
+class LogSumExpAccumulator {
+public:
+    /// The number of summands in each block.
+    static const unsigned int BLOCK_SIZE = 256;
+
+    /// Constructor for an empty sum.
+    LogSumExpAccumulator() : max(-std::numeric_limits<double>::infinity()), sum(0), buffered(0) {}
+
+    /// Add a single summand.
+    ///
+    /// \param summand The summand to add.
+    inline void add(double summand) {
+        buffer[buffered++] = summand;
+        if (buffered == BLOCK_SIZE)
+            flush();
+    }
+
+    /// Add the summands in a contiguous buffer, which is processed in blocks
+    /// of BLOCK_SIZE values.
+    ///
+    /// \param summands Pointer to the first summand.
+    /// \param size The number of summands.
+    inline void add_block(const double *summands, unsigned int size) {
+        for (unsigned int start=0; start<size; start+=BLOCK_SIZE)
+            add_single_block(summands + start, (size-start < BLOCK_SIZE) ? size-start : BLOCK_SIZE);
+    }
+
+    /// Add the summands formed by adding two contiguous buffers element
+    /// wise, that is values[i]+offsets[i]. The summands are formed in the
+    /// internal buffer one block at a time, so they are never stored in full.
+    ///
+    /// \param values Pointer to the first value.
+    /// \param offsets Pointer to the first offset.
+    /// \param size The number of summands.
+    inline void add_block(const double *values, const double *offsets, unsigned int size) {
+        flush();
+
+        for (unsigned int start=0; start<size; start+=BLOCK_SIZE) {
+            const unsigned int block_size = (size-start < BLOCK_SIZE) ? size-start : BLOCK_SIZE;
+            for (unsigned int i=0; i<block_size; ++i)
+                buffer[i] = values[start+i] + offsets[start+i];
+            add_single_block(buffer, block_size);
+        }
+    }
+
+    /// Get the log-sum-exp of the summands added.
+    ///
+    /// \return The log-sum-exp value, which is minus infinity if there are no
+    ///         summands larger than minus infinity.
+    inline double get_result() {
+        flush();
+
+        if (max == -std::numeric_limits<double>::infinity())
+            return max;
+
+        return max + log(sum);
+    }
+
+private:
+    double max;                 ///< The running maximum of the summands.
+    double sum;                 ///< The partial sum of the exponentials relative to max.
+    double buffer[BLOCK_SIZE];  ///< The buffer for the summands added by add().
+    unsigned int buffered;      ///< The number of summands in the buffer.
+
+    /// Process the summands in the buffer.
+    inline void flush() {
+        if (buffered > 0) {
+            add_single_block(buffer, buffered);
+            buffered = 0;
+        }
+    }
+
+    /// Process a block of summands.
+    ///
+    /// \param block Pointer to the first summand in the block.
+    /// \param block_size The number of summands in the block (at most BLOCK_SIZE).
+    inline void add_single_block(const double *block, unsigned int block_size) {
+        // Determine the max of the block
+        double block_max = -std::numeric_limits<double>::infinity();
+        for (unsigned int i=0; i<block_size; ++i)
+            block_max = (block[i] > block_max) ? block[i] : block_max;
+
+        if (block_max == -std::numeric_limits<double>::infinity())
+            return;
+
+        // Rescale the partial sum if the running max is raised
+        if (block_max > max) {
+            sum *= exp(max - block_max);
+            max = block_max;
+        }
+
+        // Do the summing using four independent partial sums
+        double partial[4] = {0, 0, 0, 0};
+        unsigned int i=0;
+        for (; i+4<=block_size; i+=4) {
+            partial[0] += exp(block[i] - max);
+            partial[1] += exp(block[i+1] - max);
+            partial[2] += exp(block[i+2] - max);
+            partial[3] += exp(block[i+3] - max);
+        }
+        for (; i<block_size; ++i)
+            partial[0] += exp(block[i] - max);
+
+        sum += (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    }
+};
 
-    // Do the summing
-    double sum = 0;
+/// Calculate the log-sum-exp of a contiguous buffer of values (see
+/// LogSumExpAccumulator for details).
+///
+/// \param summands Pointer to the first summand.
+/// \param size The number of summands.
+/// \return The log-sum-exp value, which is minus infinity if there are no
+///         summands larger than minus infinity.
+inline double log_sum_exp(const double *summands, unsigned int size) {
+    LogSumExpAccumulator accumulator;
+    accumulator.add_block(summands, size);
+    return accumulator.get_result();
+}
+
+/// Calculate the log-sum-exp for each row in a row-major matrix stored in a
+/// contiguous buffer. This is equivalent to calling log_sum_exp(const double*,
+/// unsigned int) for each of the rows.
+///
+/// \param summands Pointer to the first element of the matrix; the summands
+///                 of row r is found at summands[r*ncols] to
+///                 summands[(r+1)*ncols-1].
+/// \param nrows The number of rows in the matrix.
+/// \param ncols The number of columns in the matrix.
+/// \param result The log-sum-exp of each row (output). Must point to a
+///               buffer of at least nrows values.
+inline void log_sum_exp_rows(const double *summands, unsigned int nrows, unsigned int ncols, double *result) {
+    for (unsigned int row=0; row<nrows; ++row)
+        result[row] = log_sum_exp(summands + static_cast<size_t>(row)*ncols, ncols);
+}
 
-    for (DArray::constflatiterator it = summands.get_constflatiterator(); it(); ++it)
-        if (*it > -std::numeric_limits<double>::infinity())
-            sum += exp(*it - max);
+/// Calculate the log-sum-exp for each row in a row-major matrix, where a
+/// vector of column offsets is added to every row, that is
+/// \f[
+///     r_i = \ln \sum_{k=b_i}^{e_i-1} \exp(a_{ik} + c_k),
+/// \f]
+/// where the sum for each row only runs over a range of columns. The summands
+/// are formed in blocks by a LogSumExpAccumulator, so no matrix of summands
+/// is stored, and the result for each row is identical to calling
+/// log_sum_exp(const double*, unsigned int) on the summands of the row.
+///
+/// \param matrix Pointer to the first element of the matrix \f$ a \f$; row r
+///               starts at matrix[r*stride].
+/// \param nrows The number of rows in the matrix.
+/// \param stride The distance between two rows.
+/// \param column_offsets The column offsets \f$ c_k \f$.
+/// \param row_begin The first column \f$ b_i \f$ of the sum for each row.
+/// \param row_end One past the last column \f$ e_i \f$ of the sum for each row.
+/// \param result The log-sum-exp of each row (output). Must point to a
+///               buffer of at least nrows values.
+inline void log_sum_exp_rows(const double *matrix, unsigned int nrows, size_t stride, const double *column_offsets,
+                             const unsigned int *row_begin, const unsigned int *row_end, double *result) {
+    for (unsigned int row=0; row<nrows; ++row) {
+        const unsigned int begin = row_begin[row];
+        const unsigned int end = (row_end[row] > begin) ? row_end[row] : begin;
 
-    return max + log(sum);
+        LogSumExpAccumulator accumulator;
+        accumulator.add_block(matrix + row*stride + begin, column_offsets + begin, end-begin);
+        result[row] = accumulator.get_result();
+    }
+}
+
+/// Calculate the log-sum-exp of the values in a vector (see
+/// log_sum_exp(const double*, unsigned int) for details).
+///
+/// \param summands The summands to calculate the log-sum-exp of.
+/// \return The log-sum-exp value.
+inline double log_sum_exp(const std::vector<double> &summands) {
+    return summands.empty() ? -std::numeric_limits<double>::infinity() : log_sum_exp(&summands[0], summands.size());
+}
+
+/// Calculate the log-sum-exp of an array (see log_sum_exp(const double*,
+/// unsigned int) for details).
+///
+/// \param summands The summands to calculate the log-sum-exp of.
+/// \return The log-sum-exp value.
+inline double log_sum_exp(const DArray &summands) {
+    return log_sum_exp(summands.get_array(), summands.get_asize());
 }
 
 /// This function works as log_sum_exp, however the sum only runs over
-/// a limited set of indices.
+/// a limited set of indices. The selected summands are gathered in blocks in
+/// a fixed size buffer, so no memory is allocated.
 ///
 /// \param summands The summands to calculate the log-sum-exp of.
 /// \param where The sum only runs over the indices, where this array is true.
 /// \return The log-sum-exp value.
 inline double log_sum_exp(const DArray &summands, const BArray &where) {
-    // Determine max of values
-    double max = summands.max(where);
+    assert(summands.same_shape(where));
 
-    // Do the summing
-    double sum = 0;
+    const double *values = summands.get_array();
+    const bool *mask = where.get_array();
+    LogSumExpAccumulator accumulator;
 
-    for (BArray::constwheretrueiterator it = where.get_constwheretrueiterator(); it(); ++it)
-        if (summands(it) > -std::numeric_limits<double>::infinity())
-            sum += exp(summands(it) - max);
+    for (unsigned int index=0; index<summands.get_asize(); ++index)
+        if (mask[index])
+            accumulator.add(values[index]);
 
-    return max + log(sum);
+    return accumulator.get_result();
 }
 
 /// Find the index of the maximal element in an array.
@@ -157,10 +344,13 @@ inline std::vector<unsigned int> arg_min(const TArray<T> &array, const BArray &w
 /// \param array The array to find the number of true values in.
 /// \return The number of true elements in the array.
 inline unsigned int number_of_true(const BArray &array) {
+    // Sum the elements directly, which avoids a branch per element
+    const bool *values = array.get_array();
+    const unsigned int size = array.get_asize();
+
     unsigned int count = 0;
-    for(BArray::constflatiterator it = array.get_constflatiterator(); it(); ++it)
-        if(*it)
-            count++;
+    for (unsigned int i=0; i<size; ++i)
+        count += values[i];
     return count;
 }
 
@@ -169,11 +359,7 @@ inline unsigned int number_of_true(const BArray &array) {
 /// \param array The array to find the number of false values in.
 /// \return The number of false elements in the array.
 inline unsigned int number_of_false(const BArray &array) {
-    unsigned int count = 0;
-    for(BArray::constflatiterator it = array.get_constflatiterator(); it(); ++it)
-        if(!*it)
-            count++;
-    return count;
+    return array.get_asize() - number_of_true(array);
 }
 
 /// Convert (by copying) a vector to a 1-dimensional array.
@@ -39,33 +39,21 @@ template<typename TARRAY, typename T>
 class TArrayWhereTrueIterator : public TArrayBaseIterator<TARRAY,T>  {
 public:
 
-    /// Construct an iterator over a given array. Note that the bool values
-    /// of elements in the array is evaluated upon construction of the
-    /// iterator.
+    /// Construct an iterator over a given array. The elements are evaluated
+    /// while iterating, so the array should not be changed before the
+    /// iteration has finished.
     ///
     /// \param array The array to iterator over.
-    TArrayWhereTrueIterator(TARRAY& array) : TArrayBaseIterator<TARRAY,T>(array) {
-        // Store the indicies where array are true
-        for(TArrayFlatIterator<const TARRAY,const T> it = array.get_constflatiterator(); it(); ++it)
-            if(*it)
-                indicies.push_back(it.get_index());
-
-        // Make an iterator over these indicies and set index to the current value
-        it_indicies = indicies.begin();
-        if (it_indicies < indicies.end())
-            this->index = *it_indicies;
+    TArrayWhereTrueIterator(TARRAY& array) : TArrayBaseIterator<TARRAY,T>(array), values(array.get_array()), size(array.get_asize()) {
+        find_true();
     }
 
     /// Incremental prefix operator for the iterator.
     ///
     /// \return A reference to the incremented iterator.
     inline TArrayWhereTrueIterator<TARRAY,T>& operator++() {
-        ++it_indicies;
-        // Update index, if the end hasn't been passed
-        if (it_indicies < indicies.end())
-            this->index = *it_indicies;
-        else
-            this->index = std::numeric_limits<unsigned int>::max();
+        ++this->index;
+        find_true();
         return *this;
     }
 
@@ -73,12 +61,19 @@ public:
     ///
     /// \return Returns false if the end of values has been reached.
     inline bool operator()(void) {
-        return it_indicies < indicies.end();
+        return this->index < size;
     }
 
 protected:
-    std::vector<unsigned int> indicies;               ///< The indices of elements in the array that are true.
-    std::vector<unsigned int>::iterator it_indicies;  ///< An iterator over the indicies.
+    T *values;          ///< The elements of the array.
+    unsigned int size;  ///< The number of elements in the array.
+
+    /// Move the index forward to the first element that evaluates to true,
+    /// starting from the current index.
+    inline void find_true() {
+        while (this->index < size && !values[this->index])
+            ++this->index;
+    }
 };
 
 } // namespace Muninn
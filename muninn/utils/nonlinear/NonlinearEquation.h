@@ -47,6 +47,29 @@ public:
     /// \param F The function value corresponding to F, which must be one dimensional and of shape (n).
     /// \param J The return value of the Jacobian, which must have have shape (n,n).
     virtual void jacobian(const DArray &X, const DArray &F, DArray &J) = 0;
+
+    /// Get a scaling vector d, which symmetrizes the Jacobian by the
+    /// similarity transform diag(d) J diag(d)^-1. If the equations provide
+    /// such a scaling, the Newton equations can be solved using a symmetric
+    /// factorization. The default implementation provides no scaling.
+    ///
+    /// \param D The return value of the scaling, which must have shape (n)
+    ///          and positive elements.
+    /// \return True if the scaling has been set.
+    virtual bool symmetrizing_scaling(DArray &D) const {return false;}
+
+    /// Evaluate a convex potential L, for which the equations are the
+    /// stationarity conditions. The gradient of the potential must be
+    /// diag(d)^2 F, where d is the symmetrizing scaling (or the identity if
+    /// the equations provide no scaling). If the equations provide such a
+    /// potential, the root can be found by minimization (see lbfgs). The
+    /// default implementation provides no potential.
+    ///
+    /// \param X The argument, which must be one dimensional and of shape (n).
+    /// \param F The return function value, which must be one dimensional and of shape (n).
+    /// \param L The return value of the potential.
+    /// \return True if the potential has been evaluated.
+    virtual bool potential(const DArray &X, DArray &F, double &L) {return false;}
 };
 
 } // namespace Muninn
@@ -0,0 +1,119 @@
+// lbfgs.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#include "Eigen/Core"
+
+#include "lbfgs.h"
+#include "lbfgs/LBFGSMinimizer.h"
+
+namespace Muninn {
+
+/// A functor wrapper for the potential method of a NonlinearEquation object,
+/// where the argument is given in the scaled variables u = diag(d) x.
+class PotentialFunctorWrapper {
+public:
+    /// Constructor for the wrapper
+    ///
+    /// \param non_linear_equation The object to be wrapped
+    /// \param scaling The scaling d of the variables.
+    PotentialFunctorWrapper(NonlinearEquation& non_linear_equation, const Eigen::VectorXd &scaling) :
+        non_linear_equation(non_linear_equation), scaling(scaling), x(scaling.size()) {}
+
+    /// The potential operator.
+    ///
+    /// \param u The scaled argument.
+    /// \param gradient The calculated gradient with respect to u.
+    /// \param f The calculated function value, which is used as residual.
+    /// \return The value of the potential.
+    double operator()(const Eigen::VectorXd &u, Eigen::VectorXd &gradient, Eigen::VectorXd &f) {
+        x = u.cwiseQuotient(scaling);
+
+        // Note that the const cast is reasonable, since X is declared const and
+        // the constructor of DArray does not modify the contents of the storage.
+        const DArray X(newvector<Index>(x.size()), const_cast<double*>(x.data()));
+        DArray F(newvector<Index>(f.size()), f.data());
+
+        double L = 0;
+        non_linear_equation.potential(X, F, L);
+
+        // The gradient with respect to x is diag(d)^2 f
+        gradient = scaling.cwiseProduct(f);
+
+        return L;
+    }
+
+private:
+    NonlinearEquation& non_linear_equation;
+    Eigen::VectorXd scaling;
+    Eigen::VectorXd x;
+};
+
+int lbfgs(DArray &X, NonlinearEquation &eqn, unsigned int memory) {
+    // Check that X is one dimensional
+    assert(X.nonempty() && X.get_ndims()==1);
+
+    // Get the number of equations
+    Index n = X.get_shape(0);
+
+    // Check that the equations provide a potential
+    DArray F(n);
+    double L;
+
+    if (!eqn.potential(X, F, L)) {
+        return -1;
+    }
+
+    // Get the scaling of the variables
+    DArray D(n);
+    Eigen::VectorXd scaling = Eigen::VectorXd::Ones(n);
+
+    if (eqn.symmetrizing_scaling(D)) {
+        for (Index i=0; i<n; ++i) {
+            scaling(i) = D(i);
+        }
+    }
+
+    // Make an vector of the scaled variables
+    Eigen::VectorXd u(n);
+
+    for (Index i=0; i<n; ++i) {
+        u(i) = scaling(i) * X(i);
+    }
+
+    // Call the minimizer
+    PotentialFunctorWrapper potential_functor_wrapper(eqn, scaling);
+    LBFGS::LBFGSMinimizer<double, Eigen::VectorXd> minimizer(1.0E-6, memory, 100, 1000, 1E-4, 1.0E-9);
+    LBFGS::LBFGSMinimizer<double, Eigen::VectorXd>::ReturnValue return_value;
+
+    return_value = minimizer.minimize(u, potential_functor_wrapper);
+
+    // Copy the result to X
+    for (Index i=0; i<n; ++i) {
+        X(i) = u(i) / scaling(i);
+    }
+
+    // Return the status of the minimizer
+    return static_cast<int>(return_value);
+}
+
+} // namespace Muninn
@@ -0,0 +1,52 @@
+// lbfgs.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_LBFGS_H_
+#define MUNINN_LBFGS_H_
+
+#include "muninn/common.h"
+#include "muninn/utils/TArray.h"
+#include "muninn/utils/nonlinear/NonlinearEquation.h"
+
+namespace Muninn {
+
+/// Finds a root in a system of 'n' nonlinear functions in 'n' variables by
+/// minimizing the convex potential provided by the equations (see
+/// NonlinearEquation::potential) using the L-BFGS method. In contrast to
+/// newton, only the function and the potential are evaluated, so each
+/// iteration uses O(n) memory in addition to the evaluation of the equations.
+///
+/// The minimization is done in the variables diag(d) X, where d is the
+/// symmetrizing scaling of the equations. In these variables the Hessian of
+/// the potential is the symmetrized Jacobian.
+///
+/// \param X Initial starting point and the return value that has shape (n)
+/// \param eqn The nonlinear equations system of n equations
+/// \param memory The number of correction pairs used by L-BFGS.
+/// \return The return value of the L-BFGS algorithm - 0 if successful and -1
+///         if the equations do not provide a potential.
+int lbfgs(DArray &X, NonlinearEquation &eqn, unsigned int memory=10);
+
+} // namespace Muninn
+
+#endif /* MUNINN_LBFGS_H_ */
@@ -0,0 +1,246 @@
+// LBFGSMinimizer.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_LBFGS_LBFGSMINIMIZER_H_
+#define MUNINN_LBFGS_LBFGSMINIMIZER_H_
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "muninn/utils/nonlinear/newton/LineSearchAlgorithm.h"
+
+/// \namespace Muninn::LBFGS Namespace for the implementation of the limited
+/// memory BFGS method for minimizing smooth functions.
+
+namespace Muninn {
+namespace LBFGS {
+
+/// Wrapper for the potential minimized by the LBFGSMinimizer, which stores
+/// the gradient and the residual of the latest evaluation. The wrapper
+/// implements the function interface used by the line search algorithm.
+///
+/// \tparam Scalar The type used for scalars.
+/// \tparam Vector The type used for vectors.
+/// \tparam Potential The type of the functor used as potential.
+template <typename Scalar, typename Vector, class Potential>
+class PotentialFunction {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /// Constructor.
+    ///
+    /// \param potential The potential functor.
+    /// \param n The dimension of the argument of the potential.
+    PotentialFunction(Potential& potential, unsigned int n) :
+        potential(potential), gradient(n), residual(n), value(0) {}
+
+    /// Evaluate the potential and store the gradient and residual.
+    ///
+    /// \param x The value to evaluate the potential in.
+    /// \return The value of the potential.
+    template <typename Derived>
+    Scalar operator()(const Eigen::MatrixBase<Derived>& x) {
+        value = potential(x, gradient, residual);
+        return value;
+    }
+
+    /// \return The gradient from the latest evaluation.
+    const Vector& get_gradient() const {return gradient;}
+
+    /// \return The residual from the latest evaluation.
+    const Vector& get_residual() const {return residual;}
+
+    /// \return The value from the latest evaluation.
+    Scalar get_value() const {return value;}
+
+private:
+    Potential& potential;  ///< Reference to the potential.
+    Vector gradient;       ///< The latest evaluated gradient.
+    Vector residual;       ///< The latest evaluated residual.
+    Scalar value;          ///< The latest evaluated value.
+};
+
+/// Implements the limited memory BFGS (L-BFGS) method for minimizing a
+/// smooth function. The inverse Hessian is approximated from the latest
+/// pairs of steps and gradient differences using the two-loop recursion, so
+/// each iteration only requires one evaluation of the function and gradient
+/// and O(memory n) operations. The step length is found with the line search
+/// algorithm also used by the Newton root finder.
+///
+/// The potential must be a functor, which for a given x returns the value,
+/// the gradient and a residual. The algorithm has converged when the maximum
+/// norm of the residual is below the tolerance; for root finding the residual
+/// is the function, which root is the minimum of the potential.
+///
+/// \tparam Scalar The type used for scalars in the algorithm.
+/// \tparam Vector The type used for vectors in the algorithm.
+template <typename Scalar, typename Vector>
+class LBFGSMinimizer {
+public:
+
+    /// Constructor for the L-BFGS minimizer.
+    ///
+    /// \param tolerance_residual Tolerance used for testing for convergence in the residual.
+    /// \param memory The number of correction pairs used for approximating the inverse Hessian.
+    /// \param max_step_factor Scaling factor used for setting the maximal step size.
+    /// \param max_iterations Maximal number of iterations used in the algorithm.
+    /// \param alpha Required average rate of decrease used by the line search algorithm.
+    /// \param tolerance_x Tolerance used for testing for convergence in x - if negative initialized to the minimal epsilon for the scalar type.
+    LBFGSMinimizer(const Scalar tolerance_residual = 1E-8,
+                   const unsigned int memory = 10,
+                   const Scalar max_step_factor = 100,
+                   const unsigned int max_iterations = 1000,
+                   const Scalar& alpha=1E-4,
+                   const Scalar tolerance_x = -1) :
+                       tolerance_residual(tolerance_residual),
+                       memory(std::max(memory, 1u)),
+                       max_step_factor(max_step_factor),
+                       max_iterations(max_iterations),
+                       tolerance_x(tolerance_x>=0 ? tolerance_x : std::numeric_limits<Scalar>::epsilon()),
+                       line_search_algorithm(alpha, this->tolerance_x) {}
+
+    /// Return values for the L-BFGS minimizer
+    enum ReturnValue {successful,               ///< The algorithm was successful in finding a minimum.
+                      max_iterations_exceeded,  ///< The maximum number of iterations has bee exceeded without convergences.
+                      line_search_error,        ///< Line search reported an error.
+                      return_value_size         ///< Indicator value.
+    };
+
+    /// Shorthand for the templated line search algorithm
+    typedef Newton::LineSearchAlgorithm<Scalar, Vector> LSA;
+
+    /// The implementation of the L-BFGS minimizer.
+    ///
+    /// \param x The starting point and the returned minimum.
+    /// \param potential The potential to minimize (functor).
+    /// \return A flag indicating the whether the algorithm was successful.
+    ///
+    /// \tparam Potential The type of the potential (must be a functor)
+    template <class Potential>
+    ReturnValue minimize(Vector &x, Potential &potential) {
+        const unsigned int n = x.size();
+        const Vector identity = Vector::Ones(n);
+
+        // Evaluate the potential in the starting point
+        PotentialFunction<Scalar, Vector, Potential> function(potential, n);
+        function.template operator()<Vector>(x);
+
+        if (function.get_residual().cwiseAbs().maxCoeff() < tolerance_residual)
+            return successful;
+
+        // Set the maximal step size based on the step factor and the starting value
+        const Scalar max_step_size = max_step_factor * std::max(x.norm(), static_cast<Scalar>(n));
+
+        // The correction pairs, with the newest pair in front
+        std::deque<Vector> s_pairs;
+        std::deque<Vector> y_pairs;
+        std::deque<Scalar> rho_pairs;
+        std::vector<Scalar> alphas(memory);
+
+        for (unsigned int iteration=0; iteration < max_iterations; ++iteration) {
+            const Vector x_old = x;
+            const Vector gradient_old = function.get_gradient();
+            const Scalar value_old = function.get_value();
+
+            // Calculate the search direction using the two-loop recursion
+            Vector delta = -gradient_old;
+
+            for (unsigned int j=0; j<s_pairs.size(); ++j) {
+                alphas[j] = rho_pairs[j] * s_pairs[j].dot(delta);
+                delta -= alphas[j] * y_pairs[j];
+            }
+
+            if (s_pairs.size() > 0)
+                delta *= s_pairs.front().dot(y_pairs.front()) / y_pairs.front().squaredNorm();
+
+            for (int j=s_pairs.size()-1; j>=0; --j) {
+                Scalar beta = rho_pairs[j] * y_pairs[j].dot(delta);
+                delta += (alphas[j] - beta) * s_pairs[j];
+            }
+
+            // Do the line search along the search direction
+            typename LSA::ReturnValue linesearch_return_value = line_search_algorithm.linesearch(x_old, value_old, gradient_old, delta, x, function, max_step_size);
+
+            if (linesearch_return_value != LSA::successful) {
+                // Restore the starting point of the line search
+                x = x_old;
+                function.template operator()<Vector>(x);
+
+                // Retry along the steepest descent direction, if the approximated inverse Hessian was used
+                if (s_pairs.size() > 0) {
+                    s_pairs.clear();
+                    y_pairs.clear();
+                    rho_pairs.clear();
+                    continue;
+                }
+
+                return (linesearch_return_value == LSA::lambda_to_small) ? successful : line_search_error;
+            }
+
+            // Test for convergence in the residual using the max norm
+            if (function.get_residual().cwiseAbs().maxCoeff() < tolerance_residual)
+                return successful;
+
+            // Test for convergence in x
+            if ( (x_old-x).cwiseAbs().cwiseQuotient(x.cwiseAbs().cwiseMax(identity)).maxCoeff() < tolerance_x )
+                return successful;
+
+            // Update the correction pairs, if the curvature condition is fulfilled
+            Vector s = x - x_old;
+            Vector y = function.get_gradient() - gradient_old;
+            Scalar sy = s.dot(y);
+
+            if (sy > std::numeric_limits<Scalar>::epsilon() * y.squaredNorm()) {
+                s_pairs.push_front(s);
+                y_pairs.push_front(y);
+                rho_pairs.push_front(1/sy);
+
+                if (s_pairs.size() > memory) {
+                    s_pairs.pop_back();
+                    y_pairs.pop_back();
+                    rho_pairs.pop_back();
+                }
+            }
+        }
+
+        return max_iterations_exceeded;
+    }
+
+private:
+    const Scalar tolerance_residual;
+    const unsigned int memory;
+    const Scalar max_step_factor;
+    const unsigned int max_iterations;
+    const Scalar tolerance_x;
+
+    LSA line_search_algorithm;
+};
+
+} // namespace LBFGS
+} // namespace Muninn
+
+#endif /* MUNINN_LBFGS_LBFGSMINIMIZER_H_ */
@@ -80,14 +80,32 @@ private:
     NonlinearEquation& non_linear_equation;
 };
 
-int newton(DArray &X, NonlinearEquation &eqn) {
-    // Check that X is one dimensional
-    assert(X.nonempty() && X.get_ndims()==1);
-
+/// Run the Newton root finder with a given linear solver.
+///
+/// \param x Initial starting point and the return value.
+/// \param eqn The nonlinear equations system.
+/// \param jacobian_update_interval The number of iterations each Jacobian is used for.
+/// \param linear_solver The linear solver used for the Newton equations.
+/// \return The return value of the Newton algorithm - 0 if successful.
+template <typename LinearSolver>
+static int newton_with_solver(Eigen::VectorXd &x, NonlinearEquation &eqn, unsigned int jacobian_update_interval, const LinearSolver &linear_solver) {
     // Setup the functors
     FunctionFunctorWrapper function_functor_wrapper(eqn);
     JacobianFunctorWrapper jacobian_functor_wrapper(eqn);
 
+    // Call newt_hess function
+    typedef Newton::NewtonRootFinder<double, Eigen::VectorXd, Eigen::MatrixXd, LinearSolver> RootFinder;
+    RootFinder root_finder(1.0E-9, 1.0E-6, 1.0E-8, 100, 75, 1E-4, jacobian_update_interval, linear_solver);
+    typename RootFinder::ReturnValue return_value = root_finder.newton(x, x, function_functor_wrapper, jacobian_functor_wrapper);
+
+    // Return the status of the root finder
+    return static_cast<int>(return_value);
+}
+
+int newton(DArray &X, NonlinearEquation &eqn, unsigned int jacobian_update_interval) {
+    // Check that X is one dimensional
+    assert(X.nonempty() && X.get_ndims()==1);
+
     // Get the number of equations
     Index n = X.get_shape(0);
 
@@ -98,11 +116,22 @@ int newton(DArray &X, NonlinearEquation &eqn) {
         x(i) = X(i);
     }
 
-    // Call newt_hess function
-    Newton::NewtonRootFinder<double, Eigen::VectorXd, Eigen::MatrixXd> root_finder(1.0E-9, 1.0E-6, 1.0E-8, 100, 75, 1E-4);
-    Newton::NewtonRootFinder<double, Eigen::VectorXd, Eigen::MatrixXd>::ReturnValue return_value;
+    // Use a symmetric solver if the equations provide a symmetrizing scaling
+    int return_value;
+    DArray D(n);
+
+    if (eqn.symmetrizing_scaling(D)) {
+        Eigen::VectorXd scaling(n);
 
-    return_value = root_finder.newton(x, x, function_functor_wrapper, jacobian_functor_wrapper);
+        for (Index i=0; i<n; ++i) {
+            scaling(i) = D(i);
+        }
+
+        return_value = newton_with_solver(x, eqn, jacobian_update_interval, Newton::SymmetricLinearSolver<double, Eigen::VectorXd, Eigen::MatrixXd>(scaling));
+    }
+    else {
+        return_value = newton_with_solver(x, eqn, jacobian_update_interval, Newton::QRLinearSolver<double, Eigen::VectorXd, Eigen::MatrixXd>());
+    }
 
     // Copy the result to X
     for (Index i=0; i<n; ++i) {
@@ -110,7 +139,7 @@ int newton(DArray &X, NonlinearEquation &eqn) {
     }
 
     // Return the status of the root finder
-    return static_cast<int>(return_value);
+    return return_value;
 }
 
 } // namespace Muninn
@@ -33,10 +33,17 @@ namespace Muninn {
 /// Finds a root in a system of 'n' nonlinear functions in 'n' variables by the
 /// globally convergent Newton routine.
 ///
+/// If the equations provide a symmetrizing scaling of the Jacobian (see
+/// NonlinearEquation::symmetrizing_scaling), the Newton equations are solved
+/// using a symmetric factorization, otherwise a QR decomposition is used.
+///
 /// \param X Initial starting point and the return value that has shape (n)
 /// \param eqn The nonlinear equations system of n equations
+/// \param jacobian_update_interval The number of iterations each Jacobian is
+///                                 used for (one gives the ordinary Newton
+///                                 method, larger values the chord method).
 /// \return The return value of the Newton algorithm - 0 if successful.
-int newton(DArray &X, NonlinearEquation &eqn);
+int newton(DArray &X, NonlinearEquation &eqn, unsigned int jacobian_update_interval=1);
 
 } // namespace Muninn
 
@@ -0,0 +1,179 @@
+// LinearSolver.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_NEWTON_LINEARSOLVER_H_
+#define MUNINN_NEWTON_LINEARSOLVER_H_
+
+#include <cmath>
+#include <limits>
+
+#include "Eigen/Core"
+#include "Eigen/Dense"
+
+namespace Muninn {
+namespace Newton {
+
+/// Linear solver policy for the Newton root finder, which solves the Newton
+/// equations using a QR decomposition with column pivoting. This solver makes
+/// no assumptions on the Jacobian.
+///
+/// A linear solver policy must implement the two functions compute, which
+/// factorizes a Jacobian, and solve, which solves a linear equation using the
+/// latest factorization. Note that a factorization may be reused for several
+/// solves (see NewtonRootFinder).
+///
+/// \tparam Scalar The type used for scalars in the algorithm.
+/// \tparam Vector The type used for vectors in the algorithm.
+/// \tparam Array The type used for arrays in the algorithm.
+template <typename Scalar, typename Vector, typename Array>
+class QRLinearSolver {
+public:
+    /// Factorize the Jacobian.
+    ///
+    /// \param jacobian The Jacobian to factorize.
+    void compute(const Array &jacobian) {
+        qr.compute(jacobian);
+    }
+
+    /// Solve the linear equation jacobian * x = rhs, where jacobian is the
+    /// latest factorized Jacobian.
+    ///
+    /// \param rhs The right hand side of the equation.
+    /// \return The solution x.
+    Vector solve(const Vector &rhs) const {
+        return qr.solve(rhs);
+    }
+
+private:
+    Eigen::ColPivHouseholderQR<Array> qr; ///< The QR decomposition of the latest Jacobian.
+};
+
+/// Linear solver policy for the Newton root finder, which exploits that the
+/// Jacobian can be symmetrized by a diagonal similarity transform. That is,
+/// for a given scaling vector \f$ d \f$ the matrix
+/// \f[
+///     A = \mathrm{diag}(d) J \mathrm{diag}(d)^{-1}
+/// \f]
+/// is symmetric, or equivalently \f$ d_i^2 J_{ij} = d_j^2 J_{ji} \f$. The
+/// symmetrized matrix \f$ (A+A^T)/2 \f$ is factorized using a Cholesky (LLT)
+/// decomposition. If the matrix is not positive definite, a LDLT decomposition
+/// is used instead, and if the LDLT solution is inaccurate the solver falls
+/// back to a QR decomposition of the unsymmetrized Jacobian.
+///
+/// Since the transform is a similarity transform, \f$ A \f$ has the same
+/// eigenvalues as the Jacobian, which keeps the condition number of the
+/// factorized matrix unchanged.
+///
+/// \tparam Scalar The type used for scalars in the algorithm.
+/// \tparam Vector The type used for vectors in the algorithm.
+/// \tparam Array The type used for arrays in the algorithm.
+template <typename Scalar, typename Vector, typename Array>
+class SymmetricLinearSolver {
+public:
+    /// Constructor.
+    ///
+    /// \param scaling The scaling vector \f$ d \f$ of the similarity
+    ///                transform. All elements must be positive. If empty,
+    ///                the Jacobian is assumed to be symmetric.
+    SymmetricLinearSolver(const Vector &scaling=Vector()) :
+        scaling(scaling), method(QR) {}
+
+    /// Factorize the Jacobian.
+    ///
+    /// \param jacobian The Jacobian to factorize.
+    void compute(const Array &jacobian) {
+        this->jacobian = jacobian;
+
+        // Symmetrize the Jacobian
+        if (scaling.size()>0)
+            symmetrized = scaling.asDiagonal() * jacobian * scaling.cwiseInverse().asDiagonal();
+        else
+            symmetrized = jacobian;
+
+        symmetrized = 0.5 * (symmetrized + symmetrized.transpose());
+
+        // Try a Cholesky decomposition, then a LDLT decomposition
+        llt.compute(symmetrized);
+
+        if (llt.info()==Eigen::Success) {
+            method = LLT;
+        }
+        else {
+            ldlt.compute(symmetrized);
+            method = LDLT;
+        }
+    }
+
+    /// Solve the linear equation jacobian * x = rhs, where jacobian is the
+    /// latest factorized Jacobian.
+    ///
+    /// \param rhs The right hand side of the equation.
+    /// \return The solution x.
+    Vector solve(const Vector &rhs) {
+        // Transform the right hand side
+        Vector scaled_rhs = (scaling.size()>0) ? Vector(scaling.cwiseProduct(rhs)) : rhs;
+        Vector y;
+
+        if (method==LLT) {
+            y = llt.solve(scaled_rhs);
+        }
+        else if (method==LDLT) {
+            y = ldlt.solve(scaled_rhs);
+
+            // Check the accuracy of the LDLT solution, since the decomposition
+            // is not stable for indefinite matrices
+            Scalar tolerance = std::sqrt(std::numeric_limits<Scalar>::epsilon()) * scaled_rhs.norm();
+            Scalar residual = (symmetrized*y - scaled_rhs).norm();
+
+            if (!(residual <= tolerance)) {
+                qr.compute(jacobian);
+                method = QR;
+            }
+        }
+
+        if (method==QR)
+            return qr.solve(rhs);
+
+        // Transform the solution back
+        return (scaling.size()>0) ? Vector(y.cwiseQuotient(scaling)) : y;
+    }
+
+private:
+    /// The possible factorizations used by the solver
+    enum Method {LLT, LDLT, QR};
+
+    Vector scaling;                        ///< The scaling vector of the similarity transform.
+    Method method;                         ///< The factorization used for the latest Jacobian.
+
+    Array jacobian;                        ///< The latest Jacobian.
+    Array symmetrized;                     ///< The symmetrized latest Jacobian.
+
+    Eigen::LLT<Array> llt;                 ///< The Cholesky decomposition of the symmetrized Jacobian.
+    Eigen::LDLT<Array> ldlt;               ///< The LDLT decomposition of the symmetrized Jacobian.
+    Eigen::ColPivHouseholderQR<Array> qr;  ///< The QR decomposition of the Jacobian (fall back).
+};
+
+} // namespace Newton
+} // namespace Muninn
+
+#endif /* MUNINN_NEWTON_LINEARSOLVER_H_ */
@@ -24,6 +24,7 @@
 #ifndef MUNINN_NEWTON_NEWTONROOTFINDER_H_
 #define MUNINN_NEWTON_NEWTONROOTFINDER_H_
 
+#include <algorithm>
 #include <limits>
 
 #include "Eigen/Core"
@@ -31,6 +32,7 @@
 
 #include "LineSearchAlgorithm.h"
 #include "ErrorFunction.h"
+#include "LinearSolver.h"
 
 /// \namespace Muninn::Newton Namespace for the implementation of Newtons
 /// method for solving sets of nonlinear equations.
@@ -45,10 +47,18 @@ namespace Newton {
 /// where \f$\mathbf{x}\f$ is a vector and \f$\mathbf{F}\f$ is a nonlinear
 /// vector function. The algorithm is described in "Numerical Recipes in C++".
 ///
+/// The Newton equations are solved using a linear solver policy (see
+/// QRLinearSolver and SymmetricLinearSolver). The root finder can also be
+/// used in a chord (Shamanskii) mode, where the Jacobian and its
+/// factorization is reused for several iterations. If a step based on a
+/// reused Jacobian fails in the line search, the Jacobian is reevaluated
+/// and the step is retried.
+///
 /// \tparam Scalar The type used for scalars in the algorithm.
 /// \tparam Vector The type used for vectors in the algorithm.
 /// \tparam Array The type used for arrays in the algorithm.
-template <typename Scalar, typename Vector, typename Array>
+/// \tparam LinearSolver The linear solver policy used for solving the Newton equations.
+template <typename Scalar, typename Vector, typename Array, typename LinearSolver=QRLinearSolver<Scalar, Vector, Array> >
 class NewtonRootFinder {
 public:
 
@@ -60,18 +70,25 @@ public:
     /// \param max_step_factor Scaling factor used for setting the maximal step size.
     /// \param max_iterations Maximal number of iterations used in the algorithm.
     /// \param alpha Required average rate of decrease in f used by the line search algorithm.
+    /// \param jacobian_update_interval The number of iterations each Jacobian is used for. The value one gives
+    ///                                 the ordinary Newton method and larger values gives the chord (Shamanskii) method.
+    /// \param linear_solver The linear solver used for solving the Newton equations.
     NewtonRootFinder(const Scalar tolerance_x = -1,
                      const Scalar tolerance_function = 1E-8,
                      const Scalar tolerance_gradient = 1E-12,
                      const Scalar max_step_factor = 100,
                      const unsigned int max_iterations = 200,
-                     const Scalar& alpha=1E-4) :
+                     const Scalar& alpha=1E-4,
+                     const unsigned int jacobian_update_interval = 1,
+                     const LinearSolver &linear_solver = LinearSolver()) :
                          tolerance_x(tolerance_x>=0 ? tolerance_x : std::numeric_limits<Scalar>::epsilon()),
                          tolerance_function(tolerance_function),
                          tolerance_gradient(tolerance_gradient),
                          max_step_factor(max_step_factor),
                          max_iterations(max_iterations),
-                         line_search_algorithm(alpha, this->tolerance_x) {}
+                         jacobian_update_interval(std::max(jacobian_update_interval, 1u)),
+                         line_search_algorithm(alpha, this->tolerance_x),
+                         linear_solver(linear_solver) {}
 
     /// Return values for the Newton root finding algorithm
     enum ReturnValue {successful,               ///< The algorithm was successful in finding a root.
@@ -126,10 +143,21 @@ public:
             // Set the initial value of x
             Vector x = x_start;
 
+            // The Jacobian and the number of iterations it has been used for
+            Array jacobian_value(x_start.size(), x_start.size());
+            unsigned int jacobian_age = jacobian_update_interval;
+
             for (unsigned int iteration=0; iteration < max_iterations; ++iteration) {
-                // Calculate the Jacobian in x
-                Array jacobian_value(x_start.size(), x_start.size());
-                jacobian(x, *error_function.get_function_value(), jacobian_value);
+                // Calculate and factorize the Jacobian in x, unless the previous Jacobian is reused
+                const bool reused_jacobian = jacobian_age < jacobian_update_interval;
+
+                if (!reused_jacobian) {
+                    jacobian(x, *error_function.get_function_value(), jacobian_value);
+                    linear_solver.compute(jacobian_value);
+                    jacobian_age = 0;
+                }
+
+                ++jacobian_age;
 
                 // Calculate the gradient of the error function
                 Vector gradient = jacobian_value.transpose() * (*error_function.get_function_value());
@@ -143,11 +171,19 @@ public:
                 //    jacobian * delta = -function,
                 //
                 // in order to find the delta direction.
-                Vector delta = jacobian_value.colPivHouseholderQr().solve(-(*error_function.get_function_value()));
+                Vector delta = linear_solver.solve(-(*error_function.get_function_value()));
 
                 // Do the line search to find the "optimal" delta
                 typename LSA::ReturnValue linesearch_return_value = line_search_algorithm.linesearch(x_old, error_old, gradient, delta, x, error_function, max_step_size);
 
+                // If the step based on a reused Jacobian failed, restore x and retry with a new Jacobian
+                if (reused_jacobian && linesearch_return_value != LSA::successful) {
+                    x = x_old;
+                    error_function.template operator()<Vector>(x);
+                    jacobian_age = jacobian_update_interval;
+                    continue;
+                }
+
                 // Check if line search was successful
                 if (linesearch_return_value > LSA::successful && linesearch_return_value != LSA::lambda_to_small) {
                     return_value = line_search_error;
@@ -193,8 +229,10 @@ private:
     const Scalar tolerance_gradient;
     const Scalar max_step_factor;
     const unsigned int max_iterations;
+    const unsigned int jacobian_update_interval;
 
     LSA line_search_algorithm;
+    LinearSolver linear_solver;
 };
 
 
@@ -30,6 +30,7 @@
 #include "muninn/utils/TArray.h"
 #include "muninn/utils/polation/AverageSlope.h"
 #include "muninn/utils/polation/SupportBoundaries.h"
+#include "muninn/SupportIndex.h"
 
 namespace Muninn {
 namespace MLEutils {
@@ -50,8 +51,11 @@ public:
     /// \param N The counts for each value
     /// \param bin_centers The values of the center of the bins.
     /// \param min_obs_bins_per_std The minimal observations per standard deviations in the Gaussian kernel
-    LinearPolator1d(DArray &S, const BArray &support, const CArray &N, const BINNINGARRAY &bin_centers, unsigned int min_obs_bins_per_std) :
-        AverageSlope1d<BINNINGARRAY>(S, support, N, bin_centers, min_obs_bins_per_std), S(S) {};
+    /// \param support_index The index of the support. If given, the bounds of
+    ///                      the support are taken from the index instead of
+    ///                      scanning the support.
+    LinearPolator1d(DArray &S, const BArray &support, const CArray &N, const BINNINGARRAY &bin_centers, unsigned int min_obs_bins_per_std, const SupportIndex *support_index=NULL) :
+        AverageSlope1d<BINNINGARRAY>(S, support, N, bin_centers, min_obs_bins_per_std), S(S), support_index(support_index) {};
 
     /// Default destructor
     virtual ~LinearPolator1d() {};
@@ -104,7 +108,7 @@ public:
     ///         first bin with support) and the value of the slope used.
     std::pair<unsigned int, double> extrapolate_left(const double slope_factor_up, const double slope_factor_down, double min_slope, double max_slope) {
         // Find the left side of the support
-        unsigned int bin0 = SupportBoundaries1D::find_left_bound(this->support);
+        unsigned int bin0 = support_index ? support_index->get_left_bound() : SupportBoundaries1D::find_left_bound(this->support);
 
         // Find the average slope in bin_0
         double average_alpha = this->get_slope(bin0);
@@ -137,7 +141,7 @@ public:
     ///         last bin with support) and the value of the slope used.
     std::pair<unsigned int, double> extrapolate_right(const double slope_factor_up, const double slope_factor_down, double min_slope, double max_slope) {
         // Find the right side of the support
-        unsigned int bin0 = SupportBoundaries1D::find_right_bound(this->support);
+        unsigned int bin0 = support_index ? support_index->get_right_bound() : SupportBoundaries1D::find_right_bound(this->support);
 
         // Find the average slope in bin_0
         double average_alpha = this->get_slope(bin0);
@@ -157,11 +161,16 @@ public:
     /// regions where the function does not have support.
     void interpolate() {
         // Find the bin bounds of the internal parts without support
-        std::vector<std::pair<unsigned int,unsigned int> > bounds;
-        SupportBoundaries1D::find_internal_unsupported(this->support, bounds);
+        std::vector<std::pair<unsigned int,unsigned int> > found_bounds;
+        const std::vector<std::pair<unsigned int,unsigned int> > *bounds = &found_bounds;
+
+        if (support_index)
+            bounds = &support_index->get_internal_unsupported();
+        else
+            SupportBoundaries1D::find_internal_unsupported(this->support, found_bounds);
 
         // Do the interpolation
-        for (std::vector<std::pair<unsigned int,unsigned int> >::iterator it = bounds.begin(); it != bounds.end(); ++it) {
+        for (std::vector<std::pair<unsigned int,unsigned int> >::const_iterator it = bounds->begin(); it != bounds->end(); ++it) {
             // Get the left and right bound
             unsigned int bin_left = it->first;
             unsigned int bin_right = it->second;
@@ -205,7 +214,8 @@ public:
     }
 
 private:
-    DArray &S;  ///< The function values to do linear inter- and extrapolation of (non-constant reference).
+    DArray &S;                          ///< The function values to do linear inter- and extrapolation of (non-constant reference).
+    const SupportIndex *support_index;  ///< The index of the support, or NULL if the support should be scanned.
 };
 
 } // namespace Muninn
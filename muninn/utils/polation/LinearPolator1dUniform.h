@@ -44,8 +44,9 @@ public:
     /// \param support The support of the values
     /// \param N The counts for each value
     /// \param min_obs_bins_per_std then minimal observations per standard deviations in the Gaussian kernel
-    LinearPolator1dUniform(DArray &S, const BArray &support, const CArray &N, unsigned int min_obs_bins_per_std) :
-        LinearPolator1d<Identity>(S, support, N, identity, min_obs_bins_per_std) {}
+    /// \param support_index The index of the support (see LinearPolator1d).
+    LinearPolator1dUniform(DArray &S, const BArray &support, const CArray &N, unsigned int min_obs_bins_per_std, const SupportIndex *support_index=NULL) :
+        LinearPolator1d<Identity>(S, support, N, identity, min_obs_bins_per_std, support_index) {}
 
     virtual ~LinearPolator1dUniform() {}
 
@@ -0,0 +1,150 @@
+// threads.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+#ifndef MUNINN_THREADS_H_
+#define MUNINN_THREADS_H_
+
+#include <pthread.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "muninn/common.h"
+
+// The atomic operations and locks below are used by the parts of Muninn that
+// are accessed by several threads, and they do not depend on whether Muninn
+// or the client is compiled with OpenMP (which is only used for the threads
+// of the estimators). This keeps the layout of the classes and the
+// synchronization the same in Muninn and in client code.
+#ifndef __ATOMIC_ACQUIRE
+#error "Muninn requires a compiler with the __atomic builtins (GCC 4.7 or later, or Clang)."
+#endif
+
+namespace Muninn {
+
+/// Check if Muninn is compiled with support for multithreading. The threads
+/// of the estimators are implemented using OpenMP, and thread counts larger
+/// than one are ignored, if the Muninn library is compiled without OpenMP.
+/// The function is defined in the library, so the result does not depend on
+/// whether the calling code is compiled with OpenMP.
+///
+/// \return True if the Muninn library is compiled with OpenMP.
+bool multithreading_supported();
+
+/// Get the number of the calling thread within its team of threads. Outside
+/// parallel regions (or without OpenMP) the number is zero.
+///
+/// \return The thread number, which is between 0 and the number of threads
+///         in the team minus one.
+inline unsigned int get_thread_number() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/// Atomically read a counter shared between threads. Writes made by another
+/// thread before it wrote the counter (see atomic_write()) are visible after
+/// the read.
+///
+/// \param counter The counter to read.
+/// \return The value of the counter.
+inline unsigned int atomic_read(const unsigned int &counter) {
+    return __atomic_load_n(&counter, __ATOMIC_ACQUIRE);
+}
+
+/// Atomically write a counter shared between threads. Writes made before the
+/// counter is written are visible to threads reading the counter (see
+/// atomic_read()).
+///
+/// \param counter The counter to write.
+/// \param value The new value of the counter.
+inline void atomic_write(unsigned int &counter, unsigned int value) {
+    __atomic_store_n(&counter, value, __ATOMIC_RELEASE);
+}
+
+/// Atomically increment a counter shared between threads.
+///
+/// \param counter The counter to increment.
+inline void atomic_increment(unsigned int &counter) {
+    __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+}
+
+/// Atomically increment a counter shared between threads and get the value
+/// before the increment.
+///
+/// \param counter The counter to increment.
+/// \return The value of the counter before the increment.
+inline Count atomic_fetch_increment(Count &counter) {
+    return __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+}
+
+/// Atomically decrement a counter shared between threads.
+///
+/// \param counter The counter to decrement.
+/// \return The value of the counter after the decrement.
+inline unsigned int atomic_decrement(unsigned int &counter) {
+    return __atomic_sub_fetch(&counter, 1, __ATOMIC_ACQ_REL);
+}
+
+/// A mutual exclusion lock, which is implemented using a POSIX threads
+/// mutex.
+class Mutex {
+public:
+    /// Constructor.
+    Mutex() {
+        if (pthread_mutex_init(&mutex, NULL) != 0)
+            throw MessageException("Failed to initialize a mutex.");
+    }
+
+    /// Destructor.
+    ~Mutex() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    /// Acquire the lock, waiting until it is available.
+    inline void lock() {
+        if (pthread_mutex_lock(&mutex) != 0)
+            throw MessageException("Failed to lock a mutex.");
+    }
+
+    /// Release the lock.
+    inline void unlock() {
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    pthread_mutex_t mutex;  ///< The underlying POSIX threads mutex.
+
+    /// The lock cannot be copied.
+    Mutex(const Mutex &);
+
+    /// The lock cannot be assigned.
+    Mutex& operator=(const Mutex &);
+};
+
+} // namespace Muninn
+
+#endif // MUNINN_THREADS_H_
@@ -0,0 +1,87 @@
+// check.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_TESTS_CHECK_H_
+#define MUNINN_TESTS_CHECK_H_
+
+#include <cmath>
+#include <iostream>
+
+namespace Muninn {
+namespace Tests {
+
+/// Get the number of failed checks in the test program.
+///
+/// \return A reference to the number of failed checks.
+inline unsigned int &failures() {
+    static unsigned int count = 0;
+    return count;
+}
+
+/// Register the result of a check, and write a message if it failed.
+///
+/// \param passed Whether the check passed.
+/// \param expression The expression that was checked.
+/// \param file The file of the check.
+/// \param line The line of the check.
+/// \return The value of passed.
+inline bool check(bool passed, const char *expression, const char *file, int line) {
+    if (!passed) {
+        ++failures();
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+    return passed;
+}
+
+/// Check whether two values agree within an absolute tolerance.
+///
+/// \param a The first value.
+/// \param b The second value.
+/// \param tolerance The tolerance.
+/// \return True if the values agree.
+inline bool close(double a, double b, double tolerance) {
+    return std::abs(a-b) <= tolerance;
+}
+
+/// Write a summary of the checks and get the exit status of the test program.
+///
+/// \param name The name of the test program.
+/// \return Zero if all checks passed and one otherwise.
+inline int report(const char *name) {
+    if (failures() > 0) {
+        std::cerr << name << ": " << failures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << name << ": all checks passed" << std::endl;
+    return 0;
+}
+
+} // namespace Tests
+} // namespace Muninn
+
+/// Check a condition, and register a failure if it is false.
+#define MUNINN_CHECK(condition) Muninn::Tests::check((condition), #condition, __FILE__, __LINE__)
+
+#endif /* MUNINN_TESTS_CHECK_H_ */
@@ -0,0 +1,112 @@
+// histograms.h
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#ifndef MUNINN_TESTS_HISTOGRAMS_H_
+#define MUNINN_TESTS_HISTOGRAMS_H_
+
+#include <cmath>
+
+#include "tests/check.h"
+#include "muninn/common.h"
+#include "muninn/Estimate.h"
+#include "muninn/Histogram.h"
+
+namespace Muninn {
+namespace Tests {
+
+/// The exact entropy used for generating histograms.
+///
+/// \param bin The bin.
+/// \return The entropy in the bin.
+inline double exact_lnG(unsigned int bin) {
+    return 3.0*std::sin(bin/7.0) + 0.08*bin;
+}
+
+/// Make a one dimensional histogram with the counts expected for a set of
+/// weights, which give a Gaussian distribution of the counts around a center
+/// bin. The counts are rounded, and the total number of counts is exactly n.
+///
+/// \param nbins The number of bins.
+/// \param center The center of the distribution.
+/// \param n The total number of counts.
+/// \return A new histogram.
+inline Histogram *make_histogram(unsigned int nbins, double center, Count n) {
+    DArray lnw(nbins);
+    DArray p(nbins);
+    double sum_p = 0.0;
+
+    for (unsigned int bin=0; bin<nbins; ++bin) {
+        double z = (bin-center)/5.0;
+        lnw(bin) = -exact_lnG(bin) - 0.5*z*z;
+        p(bin) = std::exp(-0.5*z*z);
+        sum_p += p(bin);
+    }
+
+    CArray N(nbins);
+    Count total = 0;
+    unsigned int peak = 0;
+
+    for (unsigned int bin=0; bin<nbins; ++bin) {
+        N(bin) = static_cast<Count>(n*p(bin)/sum_p + 0.5);
+        total += N(bin);
+        if (p(bin) > p(peak))
+            peak = bin;
+    }
+
+    N(peak) = N(peak) + n - total;
+    return new Histogram(N, lnw);
+}
+
+/// Compare two one dimensional entropies in the bins where both have
+/// support. The entropies are only determined up to a constant, so they are
+/// compared relative to a reference bin.
+///
+/// \param a The first estimate.
+/// \param b The second estimate.
+/// \param reference The reference bin.
+/// \param tolerance The tolerance.
+/// \return True if the estimates have the same support and agree.
+inline bool same_lnG(const Estimate &a, const Estimate &b, unsigned int reference, double tolerance) {
+    if (!a.get_lnG_support()(reference) || !b.get_lnG_support()(reference))
+        return false;
+
+    bool same = true;
+    for (unsigned int bin=0; bin<a.get_lnG().get_asize(); ++bin) {
+        if (a.get_lnG_support()(bin) != b.get_lnG_support()(bin))
+            return false;
+
+        if (a.get_lnG_support()(bin)) {
+            double da = a.get_lnG()(bin) - a.get_lnG()(reference);
+            double db = b.get_lnG()(bin) - b.get_lnG()(reference);
+            same = same && close(da, db, tolerance);
+        }
+    }
+
+    return same;
+}
+
+} // namespace Tests
+} // namespace Muninn
+
+#endif /* MUNINN_TESTS_HISTOGRAMS_H_ */
@@ -0,0 +1,129 @@
+// test_binlookupindex.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/utils/BinLookupIndex.h"
+
+using namespace Muninn;
+
+// Get a uniform random number in [0,1]
+static double uniform() {
+    return static_cast<double>(rand())/RAND_MAX;
+}
+
+// Get the bin of a value by a binary search
+static int reference_bin(const DArray &binning, double value) {
+    const double *edges = binning.get_array();
+    return static_cast<int>(std::upper_bound(edges, edges+binning.get_asize(), value)-edges) - 1;
+}
+
+// Compare the index with the binary search for random values, the edges and
+// their neighbouring values and a set of special values
+static void check_binning(const DArray &binning) {
+    BinLookupIndex index;
+    index.build(binning);
+
+    const double *edges = binning.get_array();
+    unsigned int nedges = binning.get_asize();
+    std::vector<double> values;
+
+    for (unsigned int i=0; i<nedges; ++i) {
+        values.push_back(edges[i]);
+        values.push_back(nextafter(edges[i], -std::numeric_limits<double>::infinity()));
+        values.push_back(nextafter(edges[i], std::numeric_limits<double>::infinity()));
+    }
+
+    double lower = edges[0];
+    double upper = edges[nedges-1];
+    double width = std::max(upper-lower, 1.0);
+
+    for (unsigned int i=0; i<10000; ++i)
+        values.push_back(lower - 0.1*width + 1.2*width*uniform());
+
+    values.push_back(std::numeric_limits<double>::infinity());
+    values.push_back(-std::numeric_limits<double>::infinity());
+    values.push_back(std::numeric_limits<double>::quiet_NaN());
+
+    unsigned int mismatches = 0;
+    for (std::vector<double>::const_iterator it=values.begin(); it!=values.end(); ++it) {
+        if (index.lookup(edges, *it) != reference_bin(binning, *it))
+            ++mismatches;
+    }
+
+    MUNINN_CHECK(mismatches == 0);
+}
+
+int main() {
+    srand(1);
+
+    // A uniform binning
+    DArray uniform_binning(101);
+    for (unsigned int i=0; i<uniform_binning.get_asize(); ++i)
+        uniform_binning(i) = -5.0 + 0.1*i;
+    check_binning(uniform_binning);
+
+    // A binning with random widths
+    DArray random_binning(500);
+    random_binning(0) = -100.0;
+    for (unsigned int i=1; i<random_binning.get_asize(); ++i)
+        random_binning(i) = random_binning(i-1) + 0.01 + uniform();
+    check_binning(random_binning);
+
+    // A binning with geometrically growing widths, which puts many bins in
+    // the first buckets
+    DArray geometric_binning(200);
+    for (unsigned int i=0; i<geometric_binning.get_asize(); ++i)
+        geometric_binning(i) = std::pow(1.05, static_cast<double>(i));
+    check_binning(geometric_binning);
+
+    // A binning with repeated edges
+    DArray repeated_binning(50);
+    for (unsigned int i=0; i<repeated_binning.get_asize(); ++i)
+        repeated_binning(i) = static_cast<double>(i/3);
+    check_binning(repeated_binning);
+
+    // Binnings that are too small for the index
+    DArray single_edge(1);
+    single_edge(0) = 1.0;
+    check_binning(single_edge);
+
+    DArray single_bin(2);
+    single_bin(0) = 1.0;
+    single_bin(1) = 2.0;
+    check_binning(single_bin);
+
+    // Rebuilding the index for changed edges
+    BinLookupIndex index;
+    index.build(uniform_binning);
+    index.build(random_binning);
+    MUNINN_CHECK(index.lookup(random_binning.get_array(), random_binning(10)) == 10);
+
+    return Tests::report("test_binlookupindex");
+}
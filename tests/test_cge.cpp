@@ -0,0 +1,673 @@
+// test_cge.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+#include <pthread.h>
+
+#include "tests/check.h"
+#include "muninn/CGE.h"
+#include "muninn/SpecializedCGE.h"
+#include "muninn/MLE/MLE.h"
+#include "muninn/UpdateSchemes/IncreaseFactorScheme.h"
+#include "muninn/WeightSchemes/LinearPolatedMulticanonical.h"
+#include "muninn/WeightSchemes/Multicanonical.h"
+#include "muninn/Binners/UniformBinner.h"
+#include "muninn/Binners/NonUniformDynamicBinner.h"
+#include "muninn/utils/MessageLogger.h"
+
+using namespace Muninn;
+
+// A system of 100 two-state units, where the energy is the number of units
+// in the upper state (plus one half), which is sampled with the weights of a
+// CGE object. The system uses its own random number generator, such that
+// systems with the same seed are identical.
+class System {
+public:
+    System(unsigned int seed) : units(100, false), nup(0), state(seed) {}
+
+    static double energy(int nup) {
+        return nup + 0.5;
+    }
+
+    // Make a Metropolis-Hastings step with the weights of the CGE object,
+    // and get the energy of the new state. If a walker is given, the weights
+    // of the walker are used.
+    double step(CGE &cge, int walker=-1) {
+        unsigned int unit = static_cast<unsigned int>(units.size()*random());
+        int nup_new = units[unit] ? nup-1 : nup+1;
+        double delta = lnweights(cge, energy(nup_new), walker) - lnweights(cge, energy(nup), walker);
+        if (delta >= 0 || random() < std::exp(delta)) {
+            units[unit] = !units[unit];
+            nup = nup_new;
+        }
+        return energy(nup);
+    }
+
+private:
+    std::vector<bool> units;
+    int nup;
+    unsigned int state;
+
+    double random() {
+        state = 1103515245u*state + 12345u;
+        return (state >> 8) / 16777216.0;
+    }
+
+    static double lnweights(CGE &cge, double energy, int walker) {
+        return (walker < 0) ? cge.get_lnweights(energy) : cge.get_walker_lnweights(energy, walker);
+    }
+};
+
+// Make a CGE object with a weight scheme that extrapolates linearly
+static CGE *make_cge() {
+    return new CGE(new MLE(), new IncreaseFactorScheme(2000, 1.07), new LinearPolatedMulticanonical(),
+                   new UniformBinner(1.0), NULL, 0.0, true);
+}
+
+// Check that two estimates are identical in the bins with support
+static bool identical(const Estimate &a, const Estimate &b) {
+    if (a.get_lnG().get_asize() != b.get_lnG().get_asize())
+        return false;
+
+    for (unsigned int bin=0; bin<a.get_lnG().get_asize(); ++bin) {
+        bool support = a.get_lnG_support()(bin);
+        if (support != b.get_lnG_support()(bin) || (support && a.get_lnG()(bin) != b.get_lnG()(bin)))
+            return false;
+    }
+    return true;
+}
+
+// Check that two arrays of counts are identical
+static bool identical(const CArray &a, const CArray &b) {
+    if (a.get_asize() != b.get_asize())
+        return false;
+
+    for (unsigned int bin=0; bin<a.get_asize(); ++bin) {
+        if (a(bin) != b(bin))
+            return false;
+    }
+    return true;
+}
+
+// Make a grid of energies covering the binned area and ten bins on each
+// side. The energies are away from the bin edges, where the bins may differ
+// by rounding between the binner and the weight tables.
+static std::vector<double> energy_grid(const CGE &cge) {
+    DArray binning = cge.get_binner().get_binning();
+    double width = binning(1)-binning(0);
+    std::vector<double> energies;
+
+    for (double energy=binning(0)-9.875*width; energy<binning(binning.get_asize()-1)+10.0*width; energy+=0.25*width)
+        energies.push_back(energy);
+    return energies;
+}
+
+// Sample until new weights should be estimated
+static void sample_until_update(CGE &cge, System &system) {
+    while (!cge.add_observation(system.step(cge))) {}
+}
+
+// Check that estimating the weights in three steps without observations in
+// between gives the same estimates as estimate_new_weights()
+static void check_sequential_estimation() {
+    CGE *synchronous = make_cge();
+    CGE *asynchronous = make_cge();
+    System synchronous_system(1);
+    System asynchronous_system(1);
+
+    for (unsigned int i=0; i<8; ++i) {
+        sample_until_update(*synchronous, synchronous_system);
+        sample_until_update(*asynchronous, asynchronous_system);
+
+        synchronous->estimate_new_weights();
+        asynchronous->begin_estimate_new_weights();
+        asynchronous->compute_new_weights();
+        MUNINN_CHECK(asynchronous->new_weights_computed());
+        asynchronous->finish_estimate_new_weights();
+
+        MUNINN_CHECK(identical(synchronous->get_ge().get_estimate(), asynchronous->get_ge().get_estimate()));
+    }
+
+    delete synchronous;
+    delete asynchronous;
+}
+
+static void *compute_new_weights(void *cge) {
+    static_cast<CGE*>(cge)->compute_new_weights();
+    return NULL;
+}
+
+// Check that an estimate computed on another thread, while the sampling
+// continues with the old weights, equals the estimate of
+// estimate_new_weights() from the same observations. While the estimate is
+// computed, the weights (also outside the binned area) and the old estimate
+// must be unchanged, and no new weights are required.
+static void check_concurrent_estimation() {
+    CGE *synchronous = make_cge();
+    CGE *asynchronous = make_cge();
+    System synchronous_system(2);
+    System asynchronous_system(2);
+
+    // The initial collection is always estimated synchronously
+    sample_until_update(*synchronous, synchronous_system);
+    sample_until_update(*asynchronous, asynchronous_system);
+    synchronous->estimate_new_weights();
+    asynchronous->estimate_new_weights();
+
+    for (unsigned int i=0; i<6; ++i) {
+        sample_until_update(*synchronous, synchronous_system);
+        sample_until_update(*asynchronous, asynchronous_system);
+        synchronous->estimate_new_weights();
+
+        // The weights inside and on both sides of the binned area
+        DArray binning = asynchronous->get_binner().get_binning();
+        double energies[3] = {binning(0)-10.0, 0.5*(binning(0)+binning(binning.get_asize()-1)), binning(binning.get_asize()-1)+10.0};
+        double lnw[3];
+        for (unsigned int j=0; j<3; ++j)
+            lnw[j] = asynchronous->get_lnweights(energies[j]);
+        Estimate *old_estimate = asynchronous->get_ge().get_estimate().clone();
+
+        asynchronous->begin_estimate_new_weights();
+
+        pthread_t thread;
+        MUNINN_CHECK(pthread_create(&thread, NULL, compute_new_weights, asynchronous) == 0);
+
+        bool unchanged = true;
+        bool required = false;
+        for (unsigned int step=0; step<5000 || !asynchronous->new_weights_computed(); ++step) {
+            required = required || asynchronous->add_observation(asynchronous_system.step(*asynchronous));
+            for (unsigned int j=0; j<3; ++j)
+                unchanged = unchanged && asynchronous->get_lnweights(energies[j]) == lnw[j];
+        }
+        pthread_join(thread, NULL);
+
+        MUNINN_CHECK(unchanged);
+        MUNINN_CHECK(!required && !asynchronous->new_weights());
+        MUNINN_CHECK(identical(*old_estimate, asynchronous->get_ge().get_estimate()));
+
+        asynchronous->finish_estimate_new_weights();
+        MUNINN_CHECK(identical(synchronous->get_ge().get_estimate(), asynchronous->get_ge().get_estimate()));
+
+        // Continue from the same state as the synchronous system
+        delete old_estimate;
+        delete asynchronous;
+        asynchronous = make_cge();
+        asynchronous_system = System(2);
+        for (unsigned int j=0; j<=i+1; ++j) {
+            sample_until_update(*asynchronous, asynchronous_system);
+            asynchronous->estimate_new_weights();
+        }
+    }
+
+    delete synchronous;
+    delete asynchronous;
+}
+
+// Sample and estimate new weights a number of times
+static void estimate_weights(CGE &cge, System &system, unsigned int nestimates) {
+    for (unsigned int i=0; i<nestimates; ++i) {
+        sample_until_update(cge, system);
+        cge.estimate_new_weights();
+    }
+}
+
+// Check that the block functions for adding observations and getting
+// weights agree with the functions for single energies
+static void check_block_functions() {
+    CGE *block = make_cge();
+    CGE *single = make_cge();
+    System block_system(3);
+    System single_system(3);
+
+    estimate_weights(*block, block_system, 3);
+    estimate_weights(*single, single_system, 3);
+
+    // Energies inside and on both sides of the binned area
+    DArray binning = block->get_binner().get_binning();
+    double min = binning(0);
+    double max = binning(binning.get_asize()-1);
+    std::vector<double> energies;
+    for (double energy=min-20.0; energy<max+20.0; energy+=0.37)
+        energies.push_back(energy);
+
+    std::vector<double> lnw(energies.size());
+    block->get_lnweights(&energies[0], &lnw[0], energies.size());
+
+    bool same = true;
+    for (unsigned int i=0; i<energies.size(); ++i)
+        same = same && lnw[i] == single->get_lnweights(energies[i]);
+    MUNINN_CHECK(same);
+
+    // Add the same observations inside the binned area as a block and one by one
+    std::vector<double> observations;
+    for (unsigned int i=0; i<energies.size(); ++i) {
+        if (min<energies[i] && energies[i]<max)
+            observations.push_back(energies[i]);
+    }
+
+    bool block_new_weights = block->add_observations(&observations[0], observations.size());
+    bool single_new_weights = false;
+    for (unsigned int i=0; i<observations.size(); ++i)
+        single_new_weights = single->add_observation(observations[i]);
+
+    MUNINN_CHECK(block_new_weights == single_new_weights);
+    MUNINN_CHECK(identical(block->get_ge().get_current_histogram().get_N(), single->get_ge().get_current_histogram().get_N()));
+
+    delete block;
+    delete single;
+}
+
+// Check that the observations of the walkers in the multi-walker mode end up
+// in the right bins when the shards are merged, also if the binning has been
+// extended by the main thread in the meantime, and that the walkers are given
+// the current weights by the merge
+static void check_walkers() {
+    const unsigned int nwalkers = 4;
+    CGE *cge = make_cge();
+    cge->set_number_of_walkers(nwalkers);
+
+    std::vector<System> systems;
+    for (unsigned int walker=0; walker<nwalkers; ++walker)
+        systems.push_back(System(10+walker));
+
+    // The energies added since the weights were last estimated
+    std::vector<double> energies;
+    bool estimated = false;
+    bool merged = true;
+    bool same_weights = true;
+
+    for (unsigned int round=0; round<60; ++round) {
+        for (unsigned int step=0; step<250; ++step) {
+            for (unsigned int walker=0; walker<nwalkers; ++walker) {
+                double energy = systems[walker].step(*cge, walker);
+                cge->add_walker_observation(energy, walker);
+                energies.push_back(energy);
+            }
+        }
+
+        // Extend the binning on both sides while the walkers use the old binning
+        if (estimated && round%4==0) {
+            DArray binning = cge->get_binner().get_binning();
+            double outside[2] = {binning(0)-3.0, binning(binning.get_asize()-1)+3.0};
+            for (unsigned int i=0; i<2; ++i) {
+                cge->add_observation(outside[i]);
+                energies.push_back(outside[i]);
+            }
+        }
+
+        bool update = cge->merge_walkers();
+
+        if (estimated) {
+            CArray expected(cge->get_binner().get_nbins());
+            for (std::vector<double>::const_iterator it=energies.begin(); it!=energies.end(); ++it)
+                expected(cge->get_binner().calc_bin(*it))++;
+            merged = merged && identical(expected, cge->get_ge().get_current_histogram().get_N());
+
+            std::vector<double> grid = energy_grid(*cge);
+            for (std::vector<double>::const_iterator it=grid.begin(); it!=grid.end(); ++it) {
+                for (unsigned int walker=0; walker<nwalkers; ++walker)
+                    same_weights = same_weights && cge->get_walker_lnweights(*it, walker) == cge->get_lnweights(*it);
+            }
+        }
+
+        if (update) {
+            cge->estimate_new_weights();
+            energies.clear();
+            estimated = true;
+        }
+    }
+
+    MUNINN_CHECK(estimated);
+    MUNINN_CHECK(merged);
+    MUNINN_CHECK(same_weights);
+
+    delete cge;
+}
+
+// Check that the weight table gives the same weights as get_lnweights(),
+// also after the binning has been extended, and that a step can be evaluated
+// with the cached bin of the current state
+static void check_weight_table() {
+    CGE *cge = make_cge();
+    System system(4);
+
+    bool same = true;
+    bool same_delta = true;
+    unsigned int version = cge->get_weight_table().get_version();
+
+    for (unsigned int i=0; i<6; ++i) {
+        estimate_weights(*cge, system, 1);
+
+        // Extend the binning below
+        if (i%2==1) {
+            DArray binning = cge->get_binner().get_binning();
+            cge->add_observation(binning(0)-3.0);
+        }
+
+        const WeightTable &table = cge->get_weight_table();
+        MUNINN_CHECK(table.get_version() > version);
+        version = table.get_version();
+
+        std::vector<double> grid = energy_grid(*cge);
+        for (unsigned int j=0; j<grid.size(); ++j) {
+            same = same && table.get_lnweights(grid[j]) == cge->get_lnweights(grid[j]);
+
+            unsigned int k = (7*j) % grid.size();
+            int bin_new;
+            double delta = table.delta(grid[j], grid[k], table.calc_bin(grid[k]), bin_new);
+            same_delta = same_delta && bin_new == table.calc_bin(grid[j]) && delta == cge->get_lnweights(grid[j]) - cge->get_lnweights(grid[k]);
+        }
+    }
+
+    MUNINN_CHECK(same);
+    MUNINN_CHECK(same_delta);
+
+    // Without extrapolation the table rejects moves out of the binned area
+    CGE *binned = new CGE(new MLE(), new IncreaseFactorScheme(2000, 1.07), new Multicanonical(),
+                          new UniformBinner(1.0), NULL, 0.0, true);
+    estimate_weights(*binned, system, 2);
+
+    const WeightTable &table = binned->get_weight_table();
+    DArray binning = binned->get_binner().get_binning();
+    bool rejected = true;
+    same = true;
+
+    std::vector<double> grid = energy_grid(*binned);
+    for (std::vector<double>::const_iterator it=grid.begin(); it!=grid.end(); ++it) {
+        if (binning(0) < *it && *it < binning(binning.get_asize()-1))
+            same = same && table.get_lnweights(*it) == binned->get_lnweights(*it);
+        else
+            rejected = rejected && table.get_lnweights(*it) == -std::numeric_limits<double>::infinity();
+    }
+
+    MUNINN_CHECK(same);
+    MUNINN_CHECK(rejected);
+
+    delete cge;
+    delete binned;
+}
+
+// A thread reading weights from the published snapshots. For each version of
+// the snapshots the reader sees, the weights of a set of energies are stored.
+struct SnapshotReaderThread {
+    const WeightSnapshotPublisher *publisher;
+    const std::vector<double> *energies;
+    unsigned int stop;                                   // Set (atomically) to stop the thread
+    bool consistent;                                     // Whether a snapshot changed while it was used
+    std::map<unsigned int, std::vector<double> > seen;   // The weights seen for each version
+};
+
+static void *read_snapshots(void *argument) {
+    SnapshotReaderThread &thread = *static_cast<SnapshotReaderThread*>(argument);
+    WeightSnapshotReader reader(*thread.publisher);
+
+    while (!atomic_read(thread.stop)) {
+        reader.refresh();
+        const WeightSnapshot &snapshot = reader.get_snapshot();
+
+        std::vector<double> lnw(thread.energies->size());
+        for (unsigned int i=0; i<lnw.size(); ++i)
+            lnw[i] = snapshot.get_lnweights((*thread.energies)[i]);
+
+        std::map<unsigned int, std::vector<double> >::const_iterator it = thread.seen.find(snapshot.get_version());
+        if (it == thread.seen.end())
+            thread.seen[snapshot.get_version()] = lnw;
+        else
+            thread.consistent = thread.consistent && it->second == lnw;
+    }
+    return NULL;
+}
+
+// Check that readers on other threads get the weights of the CGE object from
+// the snapshots, while new weights are estimated and the binning is extended
+static void check_weight_snapshots() {
+    const unsigned int nreaders = 3;
+    CGE *cge = make_cge();
+    System system(5);
+
+    // The readers see the Boltzmann weights of the initial collection
+    cge->enable_weight_snapshots();
+    WeightSnapshotReader initial_reader(cge->get_weight_snapshots());
+    MUNINN_CHECK(initial_reader.get_lnweights(12.5) == cge->get_lnweights(12.5));
+
+    estimate_weights(*cge, system, 1);
+
+    // Energies inside the binned area, where the weights are not changed by
+    // extending the binning
+    std::vector<double> energies;
+    DArray centers = cge->get_binner().get_binning_centered();
+    for (unsigned int bin=0; bin<centers.get_asize(); ++bin)
+        energies.push_back(centers(bin));
+
+    // The weights of the energies for the version published by each estimate
+    std::map<unsigned int, std::vector<double> > estimated;
+    std::vector<double> lnw(energies.size());
+    for (unsigned int i=0; i<energies.size(); ++i)
+        lnw[i] = cge->get_lnweights(energies[i]);
+    estimated[cge->get_weight_snapshots().get_version()] = lnw;
+
+    std::vector<SnapshotReaderThread> threads(nreaders);
+    std::vector<pthread_t> ids(nreaders);
+    for (unsigned int r=0; r<nreaders; ++r) {
+        threads[r].publisher = &cge->get_weight_snapshots();
+        threads[r].energies = &energies;
+        threads[r].stop = 0;
+        threads[r].consistent = true;
+        MUNINN_CHECK(pthread_create(&ids[r], NULL, read_snapshots, &threads[r]) == 0);
+    }
+
+    for (unsigned int i=0; i<8; ++i) {
+        estimate_weights(*cge, system, 1);
+
+        for (unsigned int j=0; j<energies.size(); ++j)
+            lnw[j] = cge->get_lnweights(energies[j]);
+        estimated[cge->get_weight_snapshots().get_version()] = lnw;
+
+        // Extend the binning above
+        DArray binning = cge->get_binner().get_binning();
+        cge->add_observation(binning(binning.get_asize()-1)+3.0);
+    }
+
+    for (unsigned int r=0; r<nreaders; ++r) {
+        atomic_write(threads[r].stop, 1);
+        pthread_join(ids[r], NULL);
+    }
+
+    // The weights of each version must be those of the latest estimate
+    // before the version was published
+    bool consistent = true;
+    bool same = true;
+    for (unsigned int r=0; r<nreaders; ++r) {
+        consistent = consistent && threads[r].consistent;
+
+        std::map<unsigned int, std::vector<double> >::const_iterator it;
+        for (it=threads[r].seen.begin(); it!=threads[r].seen.end(); ++it) {
+            std::map<unsigned int, std::vector<double> >::const_iterator reference = estimated.upper_bound(it->first);
+            --reference;
+            same = same && it->second == reference->second;
+        }
+    }
+
+    MUNINN_CHECK(consistent);
+    MUNINN_CHECK(same);
+
+    // A reader switches to the latest weights
+    MUNINN_CHECK(initial_reader.get_lnweights(energies[0]) == cge->get_lnweights(energies[0]));
+
+    delete cge;
+}
+
+// Check that observations outside a binned region, which cannot be extended
+// further, are rejected or added to the edge bins according to the
+// out-of-range policy, both one at a time and in blocks
+static void check_out_of_range_policies() {
+    for (unsigned int policy=0; policy<CGE::OUT_OF_RANGE_SIZE; ++policy) {
+        CGE *cge = new CGE(new MLE(), new IncreaseFactorScheme(2000, 1.07), new Multicanonical(),
+                           new NonUniformDynamicBinner(0.2, true, false, 1000), NULL, 0.0, true);
+        cge->set_out_of_range_policy(static_cast<CGE::OutOfRangePolicy>(policy));
+        MUNINN_CHECK(cge->get_out_of_range_policy() == policy);
+
+        System system(5);
+        estimate_weights(*cge, system, 2);
+
+        // The extension to these energies exceeds the maximal number of bins
+        double energies[] = {-1E6, 1E6, -2E6};
+        unsigned int nbins = cge->get_binner().get_nbins();
+        unsigned int last = nbins-1;
+        CArray N = cge->get_ge().get_current_histogram().get_N();
+        DArray current_lnw = cge->get_ge().get_current_histogram().get_lnw();
+
+        double lnw[3];
+        cge->get_lnweights(energies, lnw, 3);
+        bool clamp = (policy == CGE::OUT_OF_RANGE_CLAMP);
+
+        for (unsigned int i=0; i<3; ++i) {
+            double expected = !clamp ? -std::numeric_limits<double>::infinity() :
+                                       current_lnw((energies[i] < 0) ? 0 : last);
+            MUNINN_CHECK(cge->get_lnweights(energies[i]) == expected);
+            MUNINN_CHECK(lnw[i] == expected);
+        }
+
+        cge->add_observation(energies[0]);
+        cge->add_observation(energies[1]);
+        cge->add_observations(energies, 3);
+
+        MUNINN_CHECK(cge->get_binner().get_nbins() == nbins);
+        MUNINN_CHECK(cge->get_underflow_count() == 3);
+        MUNINN_CHECK(cge->get_overflow_count() == 2);
+
+        if (clamp) {
+            N(0) += 3;
+            N(last) += 2;
+        }
+        MUNINN_CHECK(identical(cge->get_ge().get_current_histogram().get_N(), N));
+
+        delete cge;
+    }
+}
+
+// Check that the observation countdown signals new weights at the same
+// observations as consulting the update scheme for every observation, both
+// for the general and the specialized CGE class
+template <class CGEType>
+static void check_update_countdown(CGEType &cge, IncreaseFactorScheme &scheme) {
+    System system(6);
+    bool same = true;
+    unsigned int nupdates = 0;
+
+    for (unsigned int i=0; i<20000; ++i) {
+        bool new_weights = cge.add_observation(system.step(cge));
+
+        // The first update ends the initial collection, which does not use the update scheme
+        if (nupdates > 0)
+            same = same && new_weights == scheme.update_required(cge.get_ge().get_current_histogram(), cge.get_ge().get_history());
+
+        if (new_weights) {
+            cge.estimate_new_weights();
+            nupdates++;
+        }
+    }
+
+    MUNINN_CHECK(same);
+    MUNINN_CHECK(nupdates > 3);
+}
+
+static void check_update_countdown() {
+    IncreaseFactorScheme *scheme = new IncreaseFactorScheme(1000, 1.07);
+    CGE cge(new MLE(), scheme, new LinearPolatedMulticanonical(), new UniformBinner(1.0), NULL, 0.0, true);
+    check_update_countdown(cge, *scheme);
+
+    IncreaseFactorScheme *specialized_scheme = new IncreaseFactorScheme(1000, 1.07);
+    SpecializedCGE<UniformBinner, IncreaseFactorScheme> specialized(new MLE(), specialized_scheme, new LinearPolatedMulticanonical(),
+                                                                   new UniformBinner(1.0), NULL, 0.0, true);
+    check_update_countdown(specialized, *specialized_scheme);
+}
+
+// Check that the weights set in the bins added by an extension continue the
+// extrapolation used before the extension, that the remaining weights are
+// unchanged, and that the weights in the support agree with recalculating
+// all weights with get_weights()
+static void check_extend_weights(Binner *binner) {
+    CGE *cge = new CGE(new MLE(), new IncreaseFactorScheme(2000, 1.07), new LinearPolatedMulticanonical(),
+                       binner, NULL, 0.0, true);
+    System system(7);
+    estimate_weights(*cge, system, 4);
+
+    WeightTable before(cge->get_weight_table());
+    DArray lnw_before = cge->get_ge().get_current_histogram().get_lnw();
+    DArray binning = cge->get_binner().get_binning();
+
+    // Extend the binning on both sides
+    cge->add_observation(binning(0)-5.0);
+    unsigned int add_under = cge->get_binner().get_nbins() - lnw_before.get_asize();
+    cge->add_observation(binning(binning.get_asize()-1)+5.0);
+    unsigned int add_over = cge->get_binner().get_nbins() - lnw_before.get_asize() - add_under;
+    MUNINN_CHECK(add_under > 0 && add_over > 0);
+
+    const DArray &lnw = cge->get_ge().get_current_histogram().get_lnw();
+    LinearPolatedMulticanonical weightscheme;
+    DArray full = weightscheme.get_weights(cge->get_ge().get_estimate(), cge->get_ge().get_history(), &cge->get_binner());
+    const BArray &support = cge->get_ge().get_estimate().get_lnG_support();
+
+    bool unchanged = true;
+    bool extrapolated = true;
+    bool same_support = true;
+
+    for (unsigned int bin=0; bin<lnw.get_asize(); ++bin) {
+        if (bin < add_under || bin >= add_under+lnw_before.get_asize())
+            extrapolated = extrapolated && Tests::close(lnw(bin), before.get_lnweights(cge->get_binner().get_bin_center(bin)), 1E-9);
+        else
+            unchanged = unchanged && lnw(bin) == lnw_before(bin-add_under);
+
+        if (support(bin))
+            same_support = same_support && lnw(bin) == full(bin);
+    }
+
+    MUNINN_CHECK(unchanged);
+    MUNINN_CHECK(extrapolated);
+    MUNINN_CHECK(same_support);
+
+    delete cge;
+}
+
+int main() {
+    MessageLogger::get().set_verbose(0);
+
+    check_sequential_estimation();
+    check_concurrent_estimation();
+    check_block_functions();
+    check_walkers();
+    check_weight_table();
+    check_weight_snapshots();
+    check_out_of_range_policies();
+    check_update_countdown();
+    check_extend_weights(new UniformBinner(1.0));
+    check_extend_weights(new NonUniformDynamicBinner());
+
+    return Tests::report("test_cge");
+}
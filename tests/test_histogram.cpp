@@ -0,0 +1,119 @@
+// test_histogram.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/Histogram.h"
+
+using namespace Muninn;
+
+// Check that each histogram has its own id, also when it is copied
+static void check_ids() {
+    CArray N(10);
+    DArray lnw(10);
+    N(3) = 5;
+
+    Histogram first(N, lnw);
+    Histogram second(lnw);
+    MUNINN_CHECK(first.get_id() != second.get_id());
+
+    Histogram copy(first);
+    MUNINN_CHECK(copy.get_id() != first.get_id());
+    MUNINN_CHECK(copy.get_id() != second.get_id());
+    MUNINN_CHECK(copy.get_n() == first.get_n());
+
+    Count id = second.get_id();
+    second = first;
+    MUNINN_CHECK(second.get_id() == id);
+    MUNINN_CHECK(second.get_n() == first.get_n());
+}
+
+// Check that the window of a histogram is the smallest window containing
+// the counts, by scanning the counts
+static bool minimal_window(const Histogram &histogram) {
+    const Count *N = histogram.get_N().get_array();
+    unsigned int begin = 0;
+    unsigned int end = histogram.get_N().get_asize();
+
+    while (begin < end && N[begin] == 0)
+        ++begin;
+    while (end > begin && N[end-1] == 0)
+        --end;
+    if (begin == end)
+        begin = end = 0;
+
+    return histogram.get_window_begin() == begin && histogram.get_window_end() == end;
+}
+
+// Check the window when counts are added and the histogram is extended in
+// two dimensions, where the window is mapped without scanning the counts
+static void check_window() {
+    std::vector<unsigned int> shape(2);
+    shape[0] = 5;
+    shape[1] = 4;
+
+    Histogram histogram(shape);
+    MUNINN_CHECK(minimal_window(histogram));
+
+    histogram.add_observation(2, 1);
+    histogram.add_observation(4, 2);
+    MUNINN_CHECK(minimal_window(histogram));
+
+    std::vector<unsigned int> add_under(2), add_over(2);
+    add_under[0] = 2;
+    add_over[0] = 1;
+    add_under[1] = 1;
+    add_over[1] = 3;
+
+    histogram.extend(add_under, add_over);
+    MUNINN_CHECK(minimal_window(histogram));
+    MUNINN_CHECK(histogram.get_N()(4, 2) == 1 && histogram.get_N()(6, 3) == 1);
+
+    // Add counts from an array and from another histogram
+    CArray counts(histogram.get_shape());
+    counts(0, 7) = 3;
+    histogram.add_counts(counts);
+    MUNINN_CHECK(minimal_window(histogram));
+    MUNINN_CHECK(histogram.get_n() == 5);
+
+    Histogram other(histogram.get_shape());
+    other.add_observation(7, 0);
+    histogram.add_counts(other);
+    MUNINN_CHECK(minimal_window(histogram));
+    MUNINN_CHECK(histogram.get_n() == 6);
+
+    // Clearing empties the window and gives a new id
+    Count id = histogram.get_id();
+    histogram.clear();
+    MUNINN_CHECK(minimal_window(histogram));
+    MUNINN_CHECK(histogram.get_n() == 0 && histogram.get_id() != id);
+}
+
+int main() {
+    check_ids();
+    check_window();
+
+    return Tests::report("test_histogram");
+}
@@ -0,0 +1,167 @@
+// test_initialobservations.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/InitialObservations.h"
+
+using namespace Muninn;
+
+// Get a uniform random number in (0,1)
+static double uniform() {
+    return (rand()+1.0)/(RAND_MAX+2.0);
+}
+
+// Get a standard normal random number (Box-Muller transform)
+static double normal() {
+    return std::sqrt(-2.0*std::log(uniform())) * std::cos(2.0*M_PI*uniform());
+}
+
+// Get the exact fractile of a list of values, as the value with index
+// floor(p*n) among the sorted values
+static double exact_fractile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(fraction*values.size())];
+}
+
+// Get the total number of counts in the grid of a collection
+static Count grid_total(const InitialObservations &observations) {
+    Count total = 0;
+    for (size_t i=0; i<observations.get_grid_size(); ++i)
+        total += observations.get_grid_count(i);
+    return total;
+}
+
+// Check that the collection agrees with the exact values; the fractiles are
+// compared within a tolerance relative to the spread of the values
+static void check_collection(InitialObservations &observations, const std::vector<double> &values, double tolerance) {
+    double exact_lower = exact_fractile(values, 0.1586553);
+    double exact_upper = exact_fractile(values, 0.8413447);
+    double spread = exact_upper - exact_lower;
+
+    MUNINN_CHECK(observations.get_min() == *std::min_element(values.begin(), values.end()));
+    MUNINN_CHECK(observations.get_max() == *std::max_element(values.begin(), values.end()));
+
+    double lower, upper;
+    observations.get_fractiles(lower, upper);
+    MUNINN_CHECK(Tests::close(lower, exact_lower, tolerance*spread));
+    MUNINN_CHECK(Tests::close(upper, exact_upper, tolerance*spread));
+}
+
+int main() {
+    srand(1);
+
+    const unsigned int n = 100000;
+    std::vector<double> values;
+    for (unsigned int i=0; i<n; ++i)
+        values.push_back(-50.0 + 3.0*normal());
+
+    // Buffered mode, which is exact
+    InitialObservations buffered(n);
+    for (std::vector<double>::const_iterator it=values.begin(); it!=values.end(); ++it)
+        buffered.add(*it);
+
+    MUNINN_CHECK(buffered.is_buffered());
+    MUNINN_CHECK(buffered.get_n() == n);
+    MUNINN_CHECK(buffered.get_buffer().size() == n);
+    check_collection(buffered, values, 0.0);
+
+    // Grid mode, where the buffer overflows and the fractiles are estimated
+    InitialObservations gridded(1000, 4096);
+    for (std::vector<double>::const_iterator it=values.begin(); it!=values.end(); ++it)
+        gridded.add(*it);
+
+    MUNINN_CHECK(!gridded.is_buffered());
+    MUNINN_CHECK(gridded.get_n() == n);
+    MUNINN_CHECK(gridded.get_grid_size() <= 4096);
+    MUNINN_CHECK(grid_total(gridded) == n);
+    check_collection(gridded, values, 0.01);
+
+    // Merging buffered collections, which is equivalent to adding the values
+    // to a single collection
+    const unsigned int nshards = 4;
+    InitialObservations merged_buffered(n);
+    for (unsigned int shard=0; shard<nshards; ++shard) {
+        InitialObservations shard_observations(n);
+        for (unsigned int i=shard; i<n; i+=nshards)
+            shard_observations.add(values[i]);
+        merged_buffered.merge(shard_observations);
+    }
+
+    MUNINN_CHECK(merged_buffered.is_buffered());
+    MUNINN_CHECK(merged_buffered.get_n() == n);
+    check_collection(merged_buffered, values, 0.0);
+
+    // Merging collections in grid mode, where the fractiles are found from
+    // the merged grid
+    InitialObservations merged_gridded(1000, 4096);
+    for (unsigned int shard=0; shard<nshards; ++shard) {
+        InitialObservations shard_observations(1000, 4096);
+        for (unsigned int i=shard; i<n; i+=nshards)
+            shard_observations.add(values[i]);
+        MUNINN_CHECK(!shard_observations.is_buffered());
+        merged_gridded.merge(shard_observations);
+    }
+
+    MUNINN_CHECK(!merged_gridded.is_buffered());
+    MUNINN_CHECK(merged_gridded.get_n() == n);
+    MUNINN_CHECK(grid_total(merged_gridded) == n);
+    check_collection(merged_gridded, values, 0.01);
+
+    // Energies far outside the grid coarsen it, while the counts are kept
+    InitialObservations coarsened(100, 16);
+    std::vector<double> wide_values;
+    for (unsigned int i=0; i<10000; ++i)
+        wide_values.push_back(std::pow(10.0, 6.0*uniform()) * (uniform() < 0.5 ? -1.0 : 1.0));
+    for (std::vector<double>::const_iterator it=wide_values.begin(); it!=wide_values.end(); ++it)
+        coarsened.add(*it);
+
+    MUNINN_CHECK(coarsened.get_grid_size() <= 16);
+    MUNINN_CHECK(grid_total(coarsened) == wide_values.size());
+    MUNINN_CHECK(coarsened.get_min() == *std::min_element(wide_values.begin(), wide_values.end()));
+    MUNINN_CHECK(coarsened.get_max() == *std::max_element(wide_values.begin(), wide_values.end()));
+
+    // Non finite energies are counted, but do not affect the fractiles
+    InitialObservations with_nonfinite(n);
+    with_nonfinite.add(std::numeric_limits<double>::infinity());
+    for (std::vector<double>::const_iterator it=values.begin(); it!=values.end(); ++it)
+        with_nonfinite.add(*it);
+    with_nonfinite.add(std::numeric_limits<double>::quiet_NaN());
+
+    MUNINN_CHECK(with_nonfinite.has_nonfinite());
+    MUNINN_CHECK(with_nonfinite.get_n() == n+2);
+    check_collection(with_nonfinite, values, 0.0);
+
+    // Clearing the collection
+    gridded.clear();
+    MUNINN_CHECK(gridded.get_n() == 0);
+    MUNINN_CHECK(gridded.is_buffered());
+
+    return Tests::report("test_initialobservations");
+}
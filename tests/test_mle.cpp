@@ -0,0 +1,321 @@
+// test_mle.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <cmath>
+#include <vector>
+
+#include "tests/check.h"
+#include "tests/histograms.h"
+#include "muninn/Histogram.h"
+#include "muninn/Histories/MultiHistogramHistory.h"
+#include "muninn/MLE/MLE.h"
+#include "muninn/MLE/MLEestimate.h"
+#include "muninn/MLE/WHAM.h"
+#include "muninn/MLE/utils/GMHequations.h"
+#include "muninn/MLE/utils/GMHequationsAccumulated.h"
+#include "muninn/utils/TArrayUtils.h"
+#include "muninn/utils/MessageLogger.h"
+
+using namespace Muninn;
+
+// The number of bins used in the tests
+static const unsigned int nbins = 60;
+
+// Solve the same sequence of histories with Newton's method and with L-BFGS,
+// and check that the estimates agree with each other and with the exact
+// entropy. The solvers agree within the convergence tolerance of L-BFGS.
+static void check_solvers(bool restricted_individual_support) {
+    const std::vector<unsigned int> shape(1, nbins);
+    MLE newton(5, 20, restricted_individual_support, MultiHistogramHistory::DROP_OLDEST, 20, 1, MLE::NEWTON);
+    MLE lbfgs(5, 20, restricted_individual_support, MultiHistogramHistory::DROP_OLDEST, 20, 1, MLE::LBFGS);
+
+    History *newton_history = newton.new_history(shape);
+    History *lbfgs_history = lbfgs.new_history(shape);
+    Estimate *newton_estimate = newton.new_estimate(shape);
+    Estimate *lbfgs_estimate = lbfgs.new_estimate(shape);
+
+    for (unsigned int i=0; i<6; ++i) {
+        double center = 8.0 + 9.0*i;
+        newton_history->add_histogram(Tests::make_histogram(nbins, center, 20000));
+        lbfgs_history->add_histogram(Tests::make_histogram(nbins, center, 20000));
+
+        newton.estimate(*newton_history, *newton_estimate);
+        lbfgs.estimate(*lbfgs_history, *lbfgs_estimate);
+
+        unsigned int reference = newton_estimate->get_x0()[0];
+        MUNINN_CHECK(Tests::same_lnG(*newton_estimate, *lbfgs_estimate, reference, 1E-4));
+    }
+
+    // Compare with the exact entropy in the bins with many counts
+    const CArray &sum_N = MultiHistogramHistory::cast_from_base(*newton_history).get_sum_N();
+    unsigned int reference = newton_estimate->get_x0()[0];
+    bool exact = true;
+
+    for (unsigned int bin=0; bin<nbins; ++bin) {
+        if (sum_N(bin) >= 100) {
+            double estimated = newton_estimate->get_lnG()(bin) - newton_estimate->get_lnG()(reference);
+            exact = exact && Tests::close(estimated, Tests::exact_lnG(bin)-Tests::exact_lnG(reference), 0.02);
+        }
+    }
+
+    MUNINN_CHECK(exact);
+
+    delete newton_history;
+    delete lbfgs_history;
+    delete newton_estimate;
+    delete lbfgs_estimate;
+}
+
+// Check that the cached values of the estimator are not reused for a new
+// histogram that is stored in the slot of a dropped histogram, and
+// has the same number of counts. The estimate is compared with the estimate
+// of a new estimator, which has no cached values.
+static void check_address_reuse() {
+    const std::vector<unsigned int> shape(1, nbins);
+    const Count n = 20000;
+    MLE cached(5, 2, false, MultiHistogramHistory::DROP_OLDEST);
+
+    History *history = cached.new_history(shape);
+    Estimate *estimate = cached.new_estimate(shape);
+    unsigned int reused = 0;
+
+    history->add_histogram(Tests::make_histogram(nbins, 10.0, n));
+
+    for (unsigned int round=0; round<4; ++round) {
+        double center = 10.0 + 10.0*round;
+        history->add_histogram(Tests::make_histogram(nbins, center+5.0, n));
+        cached.estimate(*history, *estimate);
+
+        // Once the history is full, adding a histogram drops the oldest
+        // histogram, which was used in the previous estimate, and its slot
+        // is reused for the next histogram
+        const MultiHistogramHistory &mhh = MultiHistogramHistory::cast_from_base(*history);
+        const WindowedHistogram *oldest = &mhh[mhh.get_size()-1];
+        history->add_histogram(Tests::make_histogram(nbins, center+10.0, n));
+        history->add_histogram(Tests::make_histogram(nbins, center+15.0, n));
+        if (&mhh[0] == oldest)
+            ++reused;
+
+        cached.estimate(*history, *estimate);
+
+        // Estimate from copies of the histograms with a new estimator
+        MLE fresh(5, 2, false, MultiHistogramHistory::DROP_OLDEST);
+        History *fresh_history = fresh.new_history(shape);
+        Estimate *fresh_estimate = fresh.new_estimate(shape);
+
+        for (int i=static_cast<int>(mhh.get_size())-1; i>=0; --i)
+            fresh_history->add_histogram(new Histogram(mhh[i].get_dense_N(), mhh[i].get_dense_lnw()));
+        fresh.estimate(*fresh_history, *fresh_estimate);
+
+        MUNINN_CHECK(Tests::same_lnG(*estimate, *fresh_estimate, fresh_estimate->get_x0()[0], 1E-6));
+
+        delete fresh_history;
+        delete fresh_estimate;
+    }
+
+    MUNINN_CHECK(reused > 0);
+
+    delete history;
+    delete estimate;
+}
+
+// Check that the estimates do not depend on the number of threads used by
+// the estimator, for both solvers and both kinds of support
+static void check_threads(MLE::Solver solver, bool restricted_individual_support) {
+    const std::vector<unsigned int> shape(1, nbins);
+    const unsigned int nthreads[] = {1, 2, 3, 4};
+    const unsigned int nestimators = sizeof(nthreads)/sizeof(nthreads[0]);
+
+    std::vector<MLE*> estimators;
+    std::vector<History*> histories;
+    std::vector<Estimate*> estimates;
+
+    for (unsigned int e=0; e<nestimators; ++e) {
+        estimators.push_back(new MLE(5, 20, restricted_individual_support, MultiHistogramHistory::DROP_OLDEST, 20, nthreads[e], solver));
+        histories.push_back(estimators[e]->new_history(shape));
+        estimates.push_back(estimators[e]->new_estimate(shape));
+    }
+
+    for (unsigned int i=0; i<8; ++i) {
+        bool identical = true;
+
+        for (unsigned int e=0; e<nestimators; ++e) {
+            histories[e]->add_histogram(Tests::make_histogram(nbins, 5.0 + 7.0*i, 10000 + 1000*i));
+            estimators[e]->estimate(*histories[e], *estimates[e]);
+
+            const DArray &lnG = estimates[e]->get_lnG();
+            const DArray &reference = estimates[0]->get_lnG();
+            for (unsigned int bin=0; bin<nbins; ++bin) {
+                bool support = estimates[e]->get_lnG_support()(bin);
+                identical = identical && support == estimates[0]->get_lnG_support()(bin) && (!support || lnG(bin) == reference(bin));
+            }
+        }
+
+        MUNINN_CHECK(identical);
+    }
+
+    for (unsigned int e=0; e<nestimators; ++e) {
+        delete histories[e];
+        delete estimates[e];
+        delete estimators[e];
+    }
+}
+
+// Calculate the Jacobian of the GMH equations by a log-sum-exp over the bins
+// for each pair of histograms, directly from equation (A.10) in [JFB02]
+static void log_sum_exp_jacobian(const PackedHistory &packed, unsigned int x0_bin, const CArray &support_n, const DArray &X, const DArray &F, DArray &H) {
+    const unsigned int n = packed.get_nhistograms();
+    const unsigned int nbins = packed.get_nbins();
+    std::vector<double> lnD(nbins);
+    std::vector<double> summands(std::max(n, nbins));
+
+    for (unsigned int k=0; k<nbins; ++k) {
+        for (unsigned int i=0; i<n; ++i)
+            summands[i] = std::log(static_cast<double>(support_n(i))) + X(i) + packed.get_lnw(i)[k];
+        lnD[k] = log_sum_exp(&summands[0], n);
+    }
+
+    for (unsigned int i=0; i<n; ++i) {
+        for (unsigned int j=0; j<n; ++j) {
+            for (unsigned int k=0; k<nbins; ++k) {
+                double ln_sum_N = (k==x0_bin) ? -std::numeric_limits<double>::infinity() : packed.get_ln_sum_N()[k];
+                summands[k] = packed.get_lnw(i)[k] + packed.get_lnw(j)[k] + ln_sum_N - 2*lnD[k];
+            }
+            H(i,j) = -static_cast<double>(support_n(j)) * std::exp(X(i) + X(j) + log_sum_exp(&summands[0], nbins));
+
+            if (i==j)
+                H(i,j) += F(i) + 1.0;
+        }
+    }
+}
+
+// Check that the Jacobian calculated as a Gram matrix agrees with the
+// log-sum-exp Jacobian, for both kinds of individual support
+template <class Equations>
+static void check_gram_jacobian(unsigned int threads) {
+    const std::vector<unsigned int> shape(1, nbins);
+    MLE mle;
+    History *history = mle.new_history(shape);
+
+    for (unsigned int i=0; i<7; ++i)
+        history->add_histogram(Tests::make_histogram(nbins, 6.0 + 8.0*i, 5000 + 500*i));
+
+    const MultiHistogramHistory &mhh = MultiHistogramHistory::cast_from_base(*history);
+    const CArray &sum_N = mhh.get_sum_N();
+    BArray support(shape);
+    CArray support_n(mhh.get_size());
+
+    for (unsigned int bin=0; bin<nbins; ++bin)
+        support(bin) = sum_N(bin) > 0;
+    for (unsigned int i=0; i<mhh.get_size(); ++i) {
+        for (unsigned int bin=0; bin<nbins; ++bin)
+            support_n(i) += support(bin) ? mhh[i].get_N(bin) : 0;
+    }
+
+    std::vector<unsigned int> x0 = arg_max(sum_N);
+    Equations equations(mhh, sum_N, support, support_n, x0, 0.0, threads);
+
+    // Evaluate the Jacobian away from the solution
+    const unsigned int n = mhh.get_size();
+    DArray X(n);
+    for (unsigned int i=0; i<n; ++i)
+        X(i) = -std::log(static_cast<double>(support_n(i))) + 2.0*std::sin(i+1.0);
+
+    DArray F(n);
+    DArray H(n, n);
+    DArray reference(n, n);
+    equations.function(X, F);
+    equations.jacobian(X, F, H);
+
+    const PackedHistory &packed = equations.get_packed_history();
+    log_sum_exp_jacobian(packed, packed.find_bin(x0[0]), support_n, X, F, reference);
+
+    bool same = true;
+    for (unsigned int i=0; i<n; ++i) {
+        for (unsigned int j=0; j<n; ++j)
+            same = same && Tests::close(H(i,j), reference(i,j), 1E-10*std::max(1.0, std::abs(reference(i,j))));
+    }
+
+    MUNINN_CHECK(same);
+
+    delete history;
+}
+
+// Check that the WHAM estimator, with and without Anderson mixing, gives the
+// same estimates as solving the GMH equations with Newton's method, and that
+// a time budget, which stops the iteration early, still gives an estimate
+static void check_wham(unsigned int mixing_depth, double time_budget) {
+    const std::vector<unsigned int> shape(1, nbins);
+    MLE newton(5, 20, false, MultiHistogramHistory::DROP_OLDEST, 20, 1, MLE::NEWTON);
+    WHAM wham(5, 20, false, MultiHistogramHistory::DROP_OLDEST, 20, 1, mixing_depth, time_budget, 100000, 1E-11);
+
+    History *newton_history = newton.new_history(shape);
+    History *wham_history = wham.new_history(shape);
+    Estimate *newton_estimate = newton.new_estimate(shape);
+    Estimate *wham_estimate = wham.new_estimate(shape);
+
+    for (unsigned int i=0; i<6; ++i) {
+        double center = 8.0 + 9.0*i;
+        newton_history->add_histogram(Tests::make_histogram(nbins, center, 20000));
+        wham_history->add_histogram(Tests::make_histogram(nbins, center, 20000));
+
+        newton.estimate(*newton_history, *newton_estimate);
+        wham.estimate(*wham_history, *wham_estimate);
+
+        unsigned int reference = newton_estimate->get_x0()[0];
+        if (time_budget > 0) {
+            bool finite = true;
+            for (unsigned int bin=0; bin<nbins; ++bin)
+                finite = finite && (!wham_estimate->get_lnG_support()(bin) || std::isfinite(wham_estimate->get_lnG()(bin)));
+            MUNINN_CHECK(finite);
+        }
+        else {
+            MUNINN_CHECK(Tests::same_lnG(*newton_estimate, *wham_estimate, reference, 1E-6));
+        }
+    }
+
+    delete newton_history;
+    delete wham_history;
+    delete newton_estimate;
+    delete wham_estimate;
+}
+
+int main() {
+    MessageLogger::get().set_verbose(0);
+
+    check_address_reuse();
+    check_solvers(false);
+    check_solvers(true);
+    check_threads(MLE::NEWTON, false);
+    check_threads(MLE::NEWTON, true);
+    check_threads(MLE::LBFGS, false);
+    check_wham(0, 0);
+    check_wham(5, 0);
+    check_wham(5, 1E-9);
+    check_gram_jacobian<GMHequations>(1);
+    check_gram_jacobian<GMHequations>(3);
+    check_gram_jacobian<GMHequationsAccumulated>(1);
+
+    return Tests::report("test_mle");
+}
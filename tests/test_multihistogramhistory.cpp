@@ -0,0 +1,190 @@
+// test_multihistogramhistory.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <cstdlib>
+#include <vector>
+#include <map>
+
+#include "tests/check.h"
+#include "muninn/Histogram.h"
+#include "muninn/Histories/MultiHistogramHistory.h"
+#include "muninn/utils/MessageLogger.h"
+
+using namespace Muninn;
+
+// Get a random integer in [0,n)
+static unsigned int random_index(unsigned int n) {
+    return static_cast<unsigned int>(rand() % n);
+}
+
+// Make a histogram with random counts in a random box of bins. Some of the
+// histograms are empty.
+static Histogram *random_histogram(const std::vector<unsigned int> &shape) {
+    CArray N(shape);
+    DArray lnw(shape);
+
+    std::vector<unsigned int> lower(shape.size()), upper(shape.size());
+    for (unsigned int d=0; d<shape.size(); ++d) {
+        lower[d] = random_index(shape[d]);
+        upper[d] = lower[d] + random_index(shape[d]-lower[d]) + 1;
+    }
+
+    bool empty = (random_index(8) == 0);
+
+    for (CArray::flatiteratorcoord it=N.get_flatiteratorcoord(); it(); ++it) {
+        bool inside = !empty;
+        for (unsigned int d=0; d<shape.size(); ++d)
+            inside = inside && lower[d] <= it.get_coord()[d] && it.get_coord()[d] < upper[d];
+
+        if (inside)
+            *it = random_index(5);
+        lnw.get_array()[it.get_index()] = 0.1*random_index(10);
+    }
+
+    return new Histogram(N, lnw);
+}
+
+// Check that two arrays of counts are identical
+static bool identical(const CArray &a, const CArray &b) {
+    if (!a.same_shape(b))
+        return false;
+    for (unsigned int i=0; i<a.get_asize(); ++i)
+        if (a.get_array()[i] != b.get_array()[i])
+            return false;
+    return true;
+}
+
+// Dense copies of the added histograms, found by their id
+typedef std::map<Count, Histogram> References;
+
+// Compare the accumulated counts and the sum of counts in the history with a
+// brute force sum over the histograms, and compare the stored windows of each
+// histogram with a dense copy of the added histogram
+static void check_history(const MultiHistogramHistory &history, const References &references) {
+    const CArray &sum_N = history.get_sum_N();
+    unsigned int nbins = sum_N.get_asize();
+    unsigned int mismatches = 0;
+
+    for (unsigned int index=0; index<nbins; ++index) {
+        Count accumulated = 0;
+
+        for (int i=static_cast<int>(history.get_size())-1; i>=0; --i) {
+            accumulated += history[i].get_N(index);
+
+            if (history.get_accumulated_N(i, index) != accumulated)
+                ++mismatches;
+        }
+
+        if (sum_N.get_array()[index] != accumulated)
+            ++mismatches;
+    }
+
+    MUNINN_CHECK(mismatches == 0);
+
+    for (unsigned int i=0; i<history.get_size(); ++i) {
+        const WindowedHistogram &histogram = history[i];
+        References::const_iterator reference = references.find(histogram.get_id());
+        MUNINN_CHECK(reference != references.end());
+        if (reference == references.end())
+            continue;
+
+        const Count *N = reference->second.get_N().get_array();
+        const double *lnw = reference->second.get_lnw().get_array();
+        bool same = histogram.get_n() == reference->second.get_n();
+
+        for (unsigned int index=0; index<nbins; ++index)
+            same = same && histogram.get_N(index) == N[index];
+        for (unsigned int index=histogram.get_accumulated_begin(); index<histogram.get_accumulated_end(); ++index)
+            same = same && histogram.get_lnw(index) == lnw[index];
+
+        MUNINN_CHECK(same);
+
+        // The accumulated window contains the windows of the older histograms
+        for (unsigned int j=i; j<history.get_size(); ++j) {
+            if (history[j].get_window_begin() < history[j].get_window_end())
+                MUNINN_CHECK(histogram.get_accumulated_begin() <= history[j].get_window_begin() &&
+                             history[j].get_window_end() <= histogram.get_accumulated_end());
+        }
+    }
+}
+
+// Add, remove and extend histograms in a history with the given mode, and
+// compare the history with the brute force sums after each change
+static void check_mode(MultiHistogramHistory::HistoryMode mode, std::vector<unsigned int> shape) {
+    MultiHistogramHistory history(shape, 3, 1, mode);
+    References references;
+    check_history(history, references);
+
+    for (unsigned int step=0; step<60; ++step) {
+        Histogram *histogram = random_histogram(shape);
+        references.insert(std::make_pair(histogram->get_id(), *histogram));
+        history.add_histogram(histogram);
+        check_history(history, references);
+
+        // Occasionally remove the newest histogram
+        if (step%7 == 3 && history.get_size() > 0) {
+            const Histogram &reference = references.find(history[0].get_id())->second;
+            Histogram *newest = history.remove_newest();
+            MUNINN_CHECK(identical(newest->get_N(), reference.get_N()));
+            MUNINN_CHECK(newest->get_n() == reference.get_n());
+            delete newest;
+            check_history(history, references);
+        }
+
+        // Occasionally extend the history
+        if (step%10 == 5) {
+            std::vector<unsigned int> add_under(shape.size()), add_over(shape.size());
+            for (unsigned int d=0; d<shape.size(); ++d) {
+                add_under[d] = random_index(3);
+                add_over[d] = random_index(3);
+                shape[d] += add_under[d] + add_over[d];
+            }
+
+            history.extend(add_under, add_over);
+            for (References::iterator it=references.begin(); it!=references.end(); ++it)
+                it->second.extend(add_under, add_over);
+            check_history(history, references);
+        }
+
+        if (mode == MultiHistogramHistory::DROP_OLDEST)
+            MUNINN_CHECK(history.get_size() <= 3);
+    }
+}
+
+int main() {
+    srand(1);
+
+    // Dropping histograms that cannot be removed writes warnings
+    MessageLogger::get().set_verbose(0);
+
+    const MultiHistogramHistory::HistoryMode modes[] = {MultiHistogramHistory::DROP_NONE, MultiHistogramHistory::DROP_OLDEST,
+                                                        MultiHistogramHistory::DROP_OLDEST_POSSIBLE, MultiHistogramHistory::DROP_ANY_POSSIBLE};
+
+    for (unsigned int m=0; m<sizeof(modes)/sizeof(modes[0]); ++m) {
+        check_mode(modes[m], std::vector<unsigned int>(1, 20));
+        check_mode(modes[m], std::vector<unsigned int>(2, 6));
+    }
+
+    return Tests::report("test_multihistogramhistory");
+}
@@ -0,0 +1,102 @@
+// test_p2quantileestimator.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/utils/P2QuantileEstimator.h"
+
+using namespace Muninn;
+
+// Get a uniform random number in (0,1)
+static double uniform() {
+    return (rand()+1.0)/(RAND_MAX+2.0);
+}
+
+// Get a standard normal random number (Box-Muller transform)
+static double normal() {
+    return std::sqrt(-2.0*std::log(uniform())) * std::cos(2.0*M_PI*uniform());
+}
+
+// Get the exact fractile of a list of values, as the value with index
+// floor(p*n) among the sorted values
+static double exact_fractile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(fraction*values.size())];
+}
+
+// Compare the estimated quantiles with the exact fractiles. The tolerance is
+// relative to the spread of the central part of the values.
+static void check_values(const std::vector<double> &values, double tolerance) {
+    const double fractions[] = {0.05, 0.1586553, 0.5, 0.8413447, 0.95};
+    double spread = exact_fractile(values, 0.75) - exact_fractile(values, 0.25);
+
+    for (unsigned int f=0; f<sizeof(fractions)/sizeof(fractions[0]); ++f) {
+        P2QuantileEstimator estimator(fractions[f]);
+        for (std::vector<double>::const_iterator it=values.begin(); it!=values.end(); ++it)
+            estimator.add(*it);
+
+        MUNINN_CHECK(estimator.get_count() == values.size());
+        MUNINN_CHECK(Tests::close(estimator.get_quantile(), exact_fractile(values, fractions[f]), tolerance*spread));
+    }
+}
+
+int main() {
+    srand(1);
+
+    // The estimate is exact for less than five values
+    std::vector<double> few;
+    for (unsigned int n=1; n<5; ++n) {
+        few.push_back(uniform());
+
+        for (unsigned int i=1; i<10; ++i) {
+            double fraction = 0.1*i;
+            P2QuantileEstimator estimator(fraction);
+            for (std::vector<double>::const_iterator it=few.begin(); it!=few.end(); ++it)
+                estimator.add(*it);
+            MUNINN_CHECK(estimator.get_quantile() == exact_fractile(few, fraction));
+        }
+    }
+
+    // Large samples from different distributions
+    const unsigned int n = 100000;
+    std::vector<double> uniform_values, normal_values, exponential_values, shifted_values;
+
+    for (unsigned int i=0; i<n; ++i) {
+        uniform_values.push_back(uniform());
+        normal_values.push_back(normal());
+        exponential_values.push_back(-std::log(uniform()));
+        shifted_values.push_back(1E6 + 0.01*normal());
+    }
+
+    check_values(uniform_values, 0.01);
+    check_values(normal_values, 0.01);
+    check_values(exponential_values, 0.01);
+    check_values(shifted_values, 0.01);
+
+    return Tests::report("test_p2quantileestimator");
+}
@@ -0,0 +1,133 @@
+// test_supportindex.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/SupportIndex.h"
+#include "muninn/Estimate.h"
+
+using namespace Muninn;
+
+// Make a random support mask, where runs of bins have the same support
+static BArray random_support(unsigned int nbins) {
+    BArray support(nbins);
+    bool value = false;
+
+    for (unsigned int i=0; i<nbins; ++i) {
+        if (rand()%4 == 0)
+            value = !value;
+        support(i) = value;
+    }
+    return support;
+}
+
+// Check that an index agrees with a scan of the support mask
+static bool matches(const SupportIndex &index, const BArray &support) {
+    std::vector<unsigned int> indices;
+    std::vector<std::pair<unsigned int,unsigned int> > gaps;
+
+    for (unsigned int i=0; i<support.get_asize(); ++i) {
+        if (support(i)) {
+            if (!indices.empty() && indices.back()+1 != i)
+                gaps.push_back(std::make_pair(indices.back(), i));
+            indices.push_back(i);
+        }
+    }
+
+    if (index.get_indices() != indices || index.get_internal_unsupported() != gaps)
+        return false;
+    if (index.size() != indices.size() || index.empty() != indices.empty())
+        return false;
+    return indices.empty() || (index.get_left_bound() == indices.front() && index.get_right_bound() == indices.back());
+}
+
+// Check the index of random masks, and that shifting the index gives the
+// index of the extended mask
+static void check_index() {
+    bool same = true;
+    bool same_shifted = true;
+
+    for (unsigned int i=0; i<200; ++i) {
+        BArray support = random_support(1 + rand()%50);
+        SupportIndex index(support);
+        same = same && matches(index, support);
+
+        unsigned int add_under = rand()%5;
+        index.shift(add_under);
+        same_shifted = same_shifted && matches(index, support.extended(add_under, rand()%5));
+    }
+
+    MUNINN_CHECK(same);
+    MUNINN_CHECK(same_shifted);
+
+    // The bounds of an empty support are undefined
+    SupportIndex empty(BArray(10));
+    bool thrown = false;
+    try {
+        empty.get_left_bound();
+    }
+    catch (MessageException &exception) {
+        thrown = true;
+    }
+    MUNINN_CHECK(empty.empty() && thrown);
+}
+
+// Check that the index of an estimate follows its support, when the support
+// is set and when the estimate is extended, and that the version changes
+static void check_estimate() {
+    Estimate estimate(std::vector<unsigned int>(1, 30));
+    unsigned int version = estimate.get_lnG_support_version();
+    bool same = true;
+    bool changed = true;
+
+    for (unsigned int i=0; i<20; ++i) {
+        if (i%2==0) {
+            estimate.set_lnG_support(random_support(estimate.get_lnG().get_asize()));
+        }
+        else {
+            std::vector<unsigned int> add_under(1, rand()%4);
+            std::vector<unsigned int> add_over(1, rand()%4);
+            estimate.extend(add_under, add_over);
+        }
+
+        same = same && matches(estimate.get_lnG_support_index(), estimate.get_lnG_support());
+        changed = changed && estimate.get_lnG_support_version() != version;
+        version = estimate.get_lnG_support_version();
+    }
+
+    MUNINN_CHECK(same);
+    MUNINN_CHECK(changed);
+}
+
+int main() {
+    srand(3);
+
+    check_index();
+    check_estimate();
+
+    return Tests::report("test_supportindex");
+}
@@ -0,0 +1,82 @@
+// test_tarray.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include "tests/check.h"
+#include "muninn/utils/TArray.h"
+
+using namespace Muninn;
+
+// Check that extending an array in place gives the same array as
+// extended(), also when the extensions alternate between the two sides
+static void check_extend() {
+    DArray reference(4);
+    for (unsigned int i=0; i<4; ++i)
+        reference(i) = i+1.0;
+
+    DArray array(reference);
+    bool same = true;
+
+    for (unsigned int i=1; i<40; ++i) {
+        unsigned int add_under = (i%3==0) ? i : 0;
+        unsigned int add_over = (i%2==0) ? i%7 : 0;
+
+        reference = reference.extended(add_under, add_over);
+        array.extend(add_under, add_over);
+        array(0) += i;
+        reference(0) += i;
+
+        same = same && array.get_asize() == reference.get_asize() && array.get_shape(0) == reference.get_asize();
+        for (unsigned int j=0; same && j<reference.get_asize(); ++j)
+            same = same && array(j) == reference(j);
+    }
+
+    MUNINN_CHECK(same);
+}
+
+// Check that an extension, which fits in the padding left by a previous
+// extension, does not reallocate the array
+static void check_padding() {
+    CArray array(10);
+    array(9) = 7;
+
+    array.extend(0, 5);
+    Count *end = &array(14);
+
+    array.extend(0, 5);
+    MUNINN_CHECK(&array(14) == end);
+    MUNINN_CHECK(array(9) == 7 && array(19) == 0);
+
+    // A copy does not share the padding of the original
+    CArray copy(array);
+    copy.extend(2, 0);
+    MUNINN_CHECK(copy(11) == 7 && array(9) == 7);
+    MUNINN_CHECK(copy.get_asize() == 22 && array.get_asize() == 20);
+}
+
+int main() {
+    check_extend();
+    check_padding();
+
+    return Tests::report("test_tarray");
+}
@@ -0,0 +1,175 @@
+// test_tarrayutils.cpp
+// Copyright (c) 2010-2012 Jes Frellsen
+//
+// This file is part of Muninn.
+//
+// Muninn is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 3 as
+// published by the Free Software Foundation.
+//
+// Muninn is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Muninn.  If not, see <http://www.gnu.org/licenses/>.
+//
+// The following additional terms apply to the Muninn software:
+// Neither the names of its contributors nor the names of the
+// organizations they are, or have been, associated with may be used
+// to endorse or promote products derived from this software without
+// specific prior written permission.
+
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "tests/check.h"
+#include "muninn/utils/TArrayUtils.h"
+
+using namespace Muninn;
+
+// Calculate the log-sum-exp one summand at a time
+static double scalar_log_sum_exp(const double *summands, unsigned int size) {
+    double max = -std::numeric_limits<double>::infinity();
+    for (unsigned int i=0; i<size; ++i)
+        max = std::max(max, summands[i]);
+
+    if (max == -std::numeric_limits<double>::infinity())
+        return max;
+
+    double sum = 0.0;
+    for (unsigned int i=0; i<size; ++i)
+        sum += std::exp(summands[i] - max);
+    return max + std::log(sum);
+}
+
+// Make random summands with a large spread, where some are minus infinity
+static std::vector<double> random_summands(unsigned int size) {
+    std::vector<double> summands(size);
+    for (unsigned int i=0; i<size; ++i) {
+        if (rand()%10 == 0)
+            summands[i] = -std::numeric_limits<double>::infinity();
+        else
+            summands[i] = 1000.0*(static_cast<double>(rand())/RAND_MAX - 0.5);
+    }
+    return summands;
+}
+
+// Check the accumulator against the scalar calculation for sizes around the
+// block size, and that adding the summands one at a time, in blocks and with
+// offsets gives identical results
+static void check_accumulator() {
+    const unsigned int sizes[] = {0, 1, 3, 255, 256, 257, 1000};
+    bool close = true;
+    bool identical = true;
+
+    for (unsigned int s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s) {
+        std::vector<double> summands = random_summands(sizes[s]);
+        std::vector<double> offsets(sizes[s]);
+        for (unsigned int i=0; i<sizes[s]; ++i)
+            offsets[i] = (i%2==0) ? 0.0 : -std::numeric_limits<double>::infinity();
+
+        double reference = scalar_log_sum_exp(summands.empty() ? NULL : &summands[0], sizes[s]);
+        double result = log_sum_exp(summands);
+
+        LogSumExpAccumulator single;
+        for (unsigned int i=0; i<sizes[s]; ++i)
+            single.add(summands[i]);
+
+        if (reference == -std::numeric_limits<double>::infinity())
+            close = close && result == reference;
+        else
+            close = close && Tests::close(result, reference, 1E-12*std::max(1.0, std::abs(reference)));
+        identical = identical && single.get_result() == result;
+
+        // The offsets mask out every second summand
+        std::vector<double> masked;
+        for (unsigned int i=0; i<sizes[s]; i+=2)
+            masked.push_back(summands[i]);
+
+        LogSumExpAccumulator with_offsets;
+        if (sizes[s] > 0)
+            with_offsets.add_block(&summands[0], &offsets[0], sizes[s]);
+        double masked_reference = scalar_log_sum_exp(masked.empty() ? NULL : &masked[0], masked.size());
+        double masked_result = with_offsets.get_result();
+        close = close && (masked_result == masked_reference || Tests::close(masked_result, masked_reference, 1E-12*std::max(1.0, std::abs(masked_reference))));
+    }
+
+    MUNINN_CHECK(close);
+    MUNINN_CHECK(identical);
+
+    // Large summands do not overflow
+    double large[] = {800.0, 800.0};
+    MUNINN_CHECK(Tests::close(log_sum_exp(large, 2), 800.0 + std::log(2.0), 1E-12));
+}
+
+// Check that the masked log-sum-exp agrees with the scalar calculation of
+// the selected summands
+static void check_masked() {
+    std::vector<double> summands = random_summands(700);
+    DArray values(700);
+    BArray where(700);
+    std::vector<double> selected;
+
+    for (unsigned int i=0; i<700; ++i) {
+        values(i) = summands[i];
+        where(i) = (rand()%3 != 0);
+        if (where(i))
+            selected.push_back(summands[i]);
+    }
+
+    double reference = scalar_log_sum_exp(&selected[0], selected.size());
+    MUNINN_CHECK(Tests::close(log_sum_exp(values, where), reference, 1E-12*std::abs(reference)));
+}
+
+// Check that the row-wise log-sum-exp, with and without column offsets and
+// ranges, gives the same result as log_sum_exp() for each row
+static void check_rows() {
+    const unsigned int nrows = 7;
+    const unsigned int ncols = 300;
+    const unsigned int stride = 304;
+
+    std::vector<double> matrix = random_summands(nrows*stride);
+    std::vector<double> offsets = random_summands(stride);
+    std::vector<unsigned int> row_begin(nrows);
+    std::vector<unsigned int> row_end(nrows);
+    std::vector<double> result(nrows);
+    std::vector<double> ranged(nrows);
+
+    for (unsigned int r=0; r<nrows; ++r) {
+        row_begin[r] = rand()%ncols;
+        row_end[r] = row_begin[r] + rand()%(ncols-row_begin[r]+1);
+    }
+
+    log_sum_exp_rows(&matrix[0], nrows, stride, &result[0]);
+    log_sum_exp_rows(&matrix[0], nrows, stride, &offsets[0], &row_begin[0], &row_end[0], &ranged[0]);
+
+    bool identical = true;
+    bool identical_ranged = true;
+
+    for (unsigned int r=0; r<nrows; ++r) {
+        identical = identical && result[r] == log_sum_exp(&matrix[r*stride], stride);
+
+        std::vector<double> summands;
+        for (unsigned int k=row_begin[r]; k<row_end[r]; ++k)
+            summands.push_back(matrix[r*stride+k] + offsets[k]);
+        identical_ranged = identical_ranged && ranged[r] == log_sum_exp(summands);
+    }
+
+    MUNINN_CHECK(identical);
+    MUNINN_CHECK(identical_ranged);
+}
+
+int main() {
+    srand(5);
+
+    check_accumulator();
+    check_masked();
+    check_rows();
+
+    return Tests::report("test_tarrayutils");
+}